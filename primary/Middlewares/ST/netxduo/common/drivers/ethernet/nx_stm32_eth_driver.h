@@ -66,6 +66,7 @@ extern   "C" {
 #define NX_DRIVER_DEFERRED_PACKET_RECEIVED      1
 #define NX_DRIVER_DEFERRED_DEVICE_RESET         2
 #define NX_DRIVER_DEFERRED_PACKET_TRANSMITTED   4
+#define NX_DRIVER_DEFERRED_DMA_ERROR            8
 
 #define NX_DRIVER_STATE_NOT_INITIALIZED         1
 #define NX_DRIVER_STATE_INITIALIZE_FAILED       2
@@ -199,6 +200,20 @@ typedef struct NX_DRIVER_INFORMATION_STRUCT
 #endif
 
 
+/* Define the error counters kept by the driver. Each DMA or MAC error interrupt increments the counter for every cause it
+   reports, and the recovery counters track how often the driver brought reception back without a link restart.  */
+typedef struct NX_DRIVER_ERROR_COUNTERS_STRUCT
+{
+    ULONG               nx_driver_error_rx_buffer_unavailable;
+    ULONG               nx_driver_error_rx_watchdog_timeout;
+    ULONG               nx_driver_error_early_transmit;
+    ULONG               nx_driver_error_context_descriptor;
+    ULONG               nx_driver_error_fatal_bus;
+    ULONG               nx_driver_error_mac;
+    ULONG               nx_driver_error_recoveries;
+    ULONG               nx_driver_error_recovery_failures;
+}   NX_DRIVER_ERROR_COUNTERS;
+
 /****** DRIVER SPECIFIC ****** Start of part/vendor specific external function prototypes.  A typical NetX Ethernet driver
                                should expose its entry function as well as its interrupt handling function(s) here. All other
                                functions in the driver should have local scope, i.e., defined as static.  */
@@ -207,6 +222,14 @@ typedef struct NX_DRIVER_INFORMATION_STRUCT
 
 VOID  nx_stm32_eth_driver(NX_IP_DRIVER *driver_req_ptr);
 
+/* Define the function to select a dedicated receive packet pool. */
+
+UINT  nx_stm32_eth_driver_rx_pool_set(NX_PACKET_POOL *pool_ptr);
+
+/* Define the function to read the driver's error counters. */
+
+UINT  nx_stm32_eth_driver_error_counters_get(NX_DRIVER_ERROR_COUNTERS *counters_ptr);
+
 /****** DRIVER SPECIFIC ****** End of part/vendor specific external function prototypes.  */
 
 
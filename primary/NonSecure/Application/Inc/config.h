@@ -51,7 +51,16 @@ extern "C" {
 #define DEVICE_NAME                      "switch-v4"
 
 #define NX_APP_DEFAULT_TIMEOUT           (10000)                                           /* Generic timeout for nx events (e.g. TCP send) in ms */
-#define NX_APP_PACKET_POOL_SIZE          ((DEFAULT_PAYLOAD_SIZE + sizeof(NX_PACKET)) * 32) /* Enough space for 32 max size packets */
+#define NX_APP_PACKET_POOL_SIZE          ((DEFAULT_PAYLOAD_SIZE + sizeof(NX_PACKET)) * 9)  /* Default pool used by NetX itself for transmitting (DHCP, TCP data, etc) */
+#define NX_APP_RX_PACKET_POOL_SIZE       ((DEFAULT_PAYLOAD_SIZE + sizeof(NX_PACKET)) * NX_APP_RX_PACKETS)
+#define NX_APP_ZENOH_PACKET_POOL_SIZE    ((DEFAULT_PAYLOAD_SIZE + sizeof(NX_PACKET)) * 8)  /* Zenoh Pico transmit packets. A full batch (Z_BATCH_UNICAST_SIZE) takes 2 packets */
+#define NX_APP_SMALL_PAYLOAD_SIZE        (192)                                             /* Enough for the headers plus a PTP, BPDU, ARP or heartbeat message */
+#define NX_APP_SMALL_PACKET_POOL_SIZE    ((NX_APP_SMALL_PAYLOAD_SIZE + sizeof(NX_PACKET)) * 16)
+#define NX_DRIVER_RX_BUDGET              (8)                                               /* Max packets the driver passes to NetX per deferred processing call before yielding */
+#define NX_DRIVER_RX_RESERVE             (2)                                               /* Receive packets the driver holds back to restart reception after the RX pool runs dry */
+#define NX_DRIVER_RX_RECOVERY_INTERVAL   (10)                                              /* ms between attempts to restart reception while the RX pool is empty */
+#define NX_APP_RX_QUEUED_PACKETS         (6)                                               /* Received packets NetX can hold at once while they wait to be read (TCP window, UDP socket queues, ARP, etc). The RX pool covers these, the RX descriptors and the reserve. The driver's refill stash only holds packets on their way into descriptors so needs nothing extra */
+#define NX_APP_RX_PACKETS                (ETH_RX_DESC_CNT + NX_DRIVER_RX_RESERVE + NX_APP_RX_QUEUED_PACKETS)
 
 #define NX_DEFAULT_IP_ADDRESS            (0)                                               /* TODO: Set this */
 #define NX_DEFAULT_NET_MASK              (0)                                               /* TODO: Set this */
@@ -88,8 +97,7 @@ extern "C" {
 #define NX_LINK_THREAD_STACK_SIZE                 (2 * 1024)
 #define NX_LINK_THREAD_PRIORITY                   (9)
 
-#define NX_APP_CABLE_CONNECTION_CHECK_UP_PERIOD   (300)  /* Interval between link checks in ms when the link is down */
-#define NX_APP_CABLE_CONNECTION_CHECK_DOWN_PERIOD (1000) /* Interval between link checks in ms when the link is up */
+#define NX_LINK_FALLBACK_CHECK_PERIOD             (10000) /* Interval between link checks in ms when no link events arrive. Link changes are normally picked up from PHY events */
 
 /* ---------------------------------------------------------------------------- */
 /* PTP Config */
@@ -101,15 +109,24 @@ extern "C" {
 #define PTP_THREAD_STACK_SIZE             (1024)
 #define PTP_THREAD_PRIORITY               (4)
 #define PTP_TX_QUEUE_SIZE                 (10)
-#define PTP_PRINT_TIME_INTERVAL           (1000) /* Time interval between printing the PTP time in ms. Must be >= 100ms. Set to UINT32_MAX to disable printing */
+#define PTP_PRINT_TIME_INTERVAL           (UINT32_MAX) /* Time interval between logging the PTP time in ms. Must be >= 100ms. Set to UINT32_MAX to disable logging */
 
 #define PTP_CLIENT_MASTER_SUB_PRIORITY    (248)  /* The subpriority of this device for BMCA. Default for an end instance is 248 */
 
+#define PTP_SERVO_KP                      (0.7f)      /* Fraction of the offset from the master slewed out over each sample interval */
+#define PTP_SERVO_KI                      (0.3f)      /* Fraction of the offset added to the frequency error estimate each sample */
+#define PTP_SERVO_MAX_FREQUENCY           (500000.0f) /* Limit on the clock frequency correction in ppb */
+#define PTP_SERVO_STEP_THRESHOLD          (20000)     /* Offsets larger than this in ns step the clock instead of slewing it */
+#define PTP_SERVO_STATS_WINDOW            (16)        /* Number of samples summarised in each set of servo offset/frequency/delay stats */
+#define PTP_SERVO_PRINT_INTERVAL          (10000)     /* Time between logging the servo stats in ms. Set to UINT32_MAX to disable logging */
+#define PTP_SERVO_TRACE                   (false)     /* Log every servo sample in the trace format replayed by Tests/ptp_servo */
+
 /* ---------------------------------------------------------------------------- */
 /* Switch Config */
 /* ---------------------------------------------------------------------------- */
 
 #define SWITCH_TIMEOUT_MS                 (100)  /* Default timeout for switch operations in ms */
+#define SWITCH_SPI_IT_MIN_SIZE            (8)    /* SPI transfers of at least this many words are interrupt driven and the calling thread sleeps. Shorter ones are polled since they finish faster than a context switch */
 #define SWITCH_MANAGMENT_ROUTE_TIMEOUT_MS (1000) /* The time after allocating a management route when that route can be freed if not used */
 
 #define SWITCH_THREAD_STACK_SIZE          (4 * 1024)
@@ -117,7 +134,10 @@ extern "C" {
 #define SWITCH_THREAD_PREMPTION_PRIORITY  (15)
 
 #define SWITCH_MAINTENANCE_INTERVAL       (500)                     /* Time between performing switch maintenance operations in ms */
+#define SWITCH_TABLE_VERIFY_INTERVAL      (10000)                   /* Time between re-reading all tables when nothing has been written to the switch in ms */
+#define SWITCH_TEMPERATURE_INTERVAL       (1000)                    /* Time between reading the switch temperature in ms */
 #define SWITCH_PUBLISH_STATS_INTERVAL     (1000)                    /* Time between publishing switch statistic in ms */
+#define SWITCH_STATS_KEYFRAME_INTERVAL    (10)                      /* Delta publishes of switch statistics between full keyframes */
 
 #define SWITCH_MEM_POOL_SIZE              (1024 * sizeof(uint32_t)) /* 1024 Words should be enough for most variable length tables. TODO: Check */
 
@@ -125,13 +145,23 @@ extern "C" {
 /* PHY Config */
 /* ---------------------------------------------------------------------------- */
 
-#define NUM_PHYS                      (4)
-#define PHY_TIMEOUT_MS                (100) /* Default timeout for PHY operations in ms */
+#define NUM_PHYS                       (4)
+#define PHY_TIMEOUT_MS                 (100)    /* Default timeout for PHY operations in ms */
+
+#define PHY_THREAD_STACK_SIZE          (1024)
+#define PHY_THREAD_PRIORITY            (15)
+#define PHY_THREAD_PREMPTION_PRIORITY  (15)
+#define PHY_LINK_WATCHDOG_INTERVAL     (5000)   /* Time between polling each PHY's link state and faults in case an interrupt is missed in ms */
+#define PHY_LINK_POLL_INTERVAL         (300)    /* Time between polling the link state of PHYs without interrupts (the LAN8671) in ms */
+#define PHY_TEMPERATURE_INTERVAL       (1000)   /* Time between reading each PHY temperature in ms */
+#define PHY_LINK_MAX_SUBSCRIBERS       (4)      /* Maximum number of event flag groups notified of link changes */
+#define PHY_MDIO_SPIN_US               (20)     /* Time to busy wait for an MDIO frame before sleeping in us */
 
-#define PHY_THREAD_STACK_SIZE         (1024)
-#define PHY_THREAD_PRIORITY           (15)
-#define PHY_THREAD_PREMPTION_PRIORITY (15)
-#define PHY_THREAD_INTERVAL           (300) /* TODO: Execute once per second (1000) when PHY interrupts work  */
+#define PHY_NUM_88Q211X                (3)      /* PHYs 0 to PHY_NUM_88Q211X - 1 are 88Q2112s */
+#define PHY_CABLE_TEST_INTERVAL        (500)    /* Time between checking whether a cable test should be started or collected in ms */
+#define PHY_CABLE_TEST_DURATION        (500)    /* Time a cable test takes in ms */
+#define PHY_CABLE_TEST_LINK_DOWN_TIME  (10000)  /* Time a port must have had no link before it is cable tested in ms */
+#define PHY_CABLE_TEST_REPEAT_INTERVAL (300000) /* Minimum time between cable tests of the same port in ms */
 
 /* ---------------------------------------------------------------------------- */
 /* STP Config */
@@ -154,6 +184,19 @@ extern "C" {
 #define ZENOH_MEM_POOL_SIZE                 (1024 * 32)
 #define ZENOH_OPEN_SESSION_INTERVAL         (200) /* ms, ime between attempts to open a session */
 #define ZENOH_MAX_RETRIES_BEFORE_LONG_PAUSE (5)   /* After this number of failed attempts to open a session pause for Z_TRANSPORT_LEASE to reset any leases on remote devices */
+#define ZENOH_DIRECT_RECONNECT_ATTEMPTS     (3)   /* After an open session drops, open the next sessions straight to the same router this many times before scouting again. 0 disables */
+#define ZENOH_DIRECT_RECONNECT_INTERVAL     (20)  /* ms, time between direct reconnection attempts */
+
+#define ZENOH_MEM_BLOCK_CLASSES             (5)                       /* Fixed size block pools in front of the byte pool. Their memory is taken from ZENOH_MEM_POOL_SIZE */
+#define ZENOH_MEM_BLOCK_SIZES               {16, 32, 64, 128, 256}    /* Bytes, ascending */
+#define ZENOH_MEM_BLOCK_COUNTS              {32, 32, 24, 16, 8}       /* See zenoh_memory_stats for the high watermarks when resizing */
+#define ZENOH_MEM_TRACE                     (false)                   /* Log every allocation and release in the trace format replayed by Tests/zenoh_memory */
+#define ZENOH_MEM_TRACE_SIZE                (1024)                    /* Records held until the comms thread logs them, any more are counted as lost */
+
+#define ZENOH_UDP_BUFFERS                   (4)    /* Transport buffers placed directly in NX_PACKETs so sending doesn't copy (TX and RX for unicast and multicast) */
+#define ZENOH_UDP_BUFFER_RETURN_TIMEOUT     (10)   /* ms to wait for NetX to hand a sent transport buffer back before the send fails */
+#define ZENOH_TCP_WINDOW_SIZE               ((NX_APP_RX_QUEUED_PACKETS - 2) * 1460) /* Receive window. Each queued segment holds an RX pool packet until it is read, so the window is 2 segments smaller than the NetX share of the RX pool to leave room for ARP, PTP and other UDP traffic */
+#define ZENOH_TCP_CONNECT_TIMEOUT           (1000)                                  /* ms */
 
 #define ZENOH_MODE                          Z_CONFIG_MODE_CLIENT
 #define ZENOH_LOCATOR                       "" /* Empty means it will scout. Otherwise: "udp/192.168.50.2:7447" */
@@ -174,7 +217,9 @@ extern "C" {
 #define BACKGROUND_THREAD_PRIORITY           (15)
 #define BACKGROUND_THREAD_PREMPTION_PRIORITY (15)
 
-#define BACKGROUND_THREAD_INTERVAL           (1000) /* ms, how often to run */
+#define BACKGROUND_THREAD_INTERVAL           (1000) /* ms, how often to run the secure background task */
+#define BACKGROUND_POOL_STATS_INTERVAL       (1000) /* ms, how often to sample the packet pool usage */
+#define BACKGROUND_CYCLES_INTERVAL           (5000) /* ms, how often to extend the cycle counter. Must be less than a CYCCNT wrap (~17s at 250MHz) */
 
 
 #ifdef __cplusplus
@@ -134,12 +134,33 @@ typedef enum {
 } nx_ip_status_t;
 
 
-extern NX_IP          nx_ip_instance;
-extern NX_PACKET_POOL nx_packet_pool;
-extern NX_DHCP        dhcp_client;
+typedef enum {
+    NX_POOL_TX    = 0, /* nx_packet_pool, the IP instance's default pool */
+    NX_POOL_RX    = 1, /* nx_rx_packet_pool */
+    NX_POOL_ZENOH = 2, /* nx_zenoh_packet_pool */
+    NX_POOL_SMALL = 3, /* nx_small_packet_pool, also the IP instance's auxiliary pool */
+    NX_NUM_POOLS,
+} nx_pool_index_t;
+
+typedef struct {
+    ULONG available;      /* Free packets at the last sample */
+    ULONG low_watermark;  /* Fewest free packets seen since boot, zero once the pool has run dry */
+    ULONG empty_requests; /* Allocations that found the pool empty */
+} nx_pool_stats_t;
+
+
+extern NX_IP           nx_ip_instance;
+extern NX_PACKET_POOL  nx_packet_pool;
+extern NX_PACKET_POOL  nx_rx_packet_pool;
+extern NX_PACKET_POOL  nx_zenoh_packet_pool;
+extern NX_PACKET_POOL  nx_small_packet_pool;
+extern NX_DHCP         dhcp_client;
+extern nx_pool_stats_t nx_pool_stats[NX_NUM_POOLS];
 
 
 nx_status_t nx_setup(TX_BYTE_POOL *byte_pool);
+void        nx_pool_stats_update(void);
+void        nx_pool_stats_get(nx_pool_stats_t stats[NX_NUM_POOLS]);
 
 
 #ifdef __cplusplus
@@ -19,8 +19,14 @@ extern "C" {
 #include "config.h"
 
 
-extern TX_THREAD nx_link_thread_handle;
-extern uint8_t   nx_link_thread_stack[NX_LINK_THREAD_STACK_SIZE];
+#define NX_LINK_ALL_EVENTS   ((ULONG) 0xffffffff)
+#define NX_LINK_PHY_EVENT    ((ULONG) 1 << 0) /* A PHY link went up or down */
+#define NX_LINK_SWITCH_EVENT ((ULONG) 1 << 1) /* The switch was initialised or lost its initialisation */
+
+
+extern TX_THREAD            nx_link_thread_handle;
+extern uint8_t              nx_link_thread_stack[NX_LINK_THREAD_STACK_SIZE];
+extern TX_EVENT_FLAGS_GROUP nx_link_events_handle;
 
 
 void nx_link_thread_entry(uint32_t thread_input);
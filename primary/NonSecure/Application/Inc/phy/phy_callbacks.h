@@ -13,6 +13,11 @@ extern "C" {
 #endif
 
 
+#include "stdint.h"
+#include "stdbool.h"
+#include "tx_api.h"
+
+#include "config.h"
 #include "88q211x.h"
 #include "lan867x.h"
 
@@ -23,6 +28,12 @@ extern "C" {
 #define PHY_PHY2_EVENT ((ULONG) 1 << 2)
 #define PHY_PHY3_EVENT ((ULONG) 1 << 3)
 
+#define PHY_PHY0_LINK_EVENT ((ULONG) 1 << 4)
+#define PHY_PHY1_LINK_EVENT ((ULONG) 1 << 5)
+#define PHY_PHY2_LINK_EVENT ((ULONG) 1 << 6)
+#define PHY_PHY3_LINK_EVENT ((ULONG) 1 << 7)
+#define PHY_LINK_EVENTS     (PHY_PHY0_LINK_EVENT | PHY_PHY1_LINK_EVENT | PHY_PHY2_LINK_EVENT | PHY_PHY3_LINK_EVENT)
+
 
 extern const phy_callbacks_t phy_callbacks_88q2112;
 extern const phy_callbacks_t phy_callbacks_lan8671;
@@ -31,6 +42,13 @@ extern TX_MUTEX phy_mutex_handle;
 
 extern TX_EVENT_FLAGS_GROUP phy_events_handle;
 
+extern bool     phy_link_up[NUM_PHYS];
+extern uint32_t phy_link_changes[NUM_PHYS];
+
+
+void         phy_link_subscribe(TX_EVENT_FLAGS_GROUP *events, const ULONG flags[NUM_PHYS]);
+phy_status_t phy_link_report(uint32_t index, bool link_up);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,45 @@
+/*
+ * phy_mdio.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+#ifndef INC_PHY_PHY_MDIO_H_
+#define INC_PHY_PHY_MDIO_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#include "88q211x.h"
+
+
+typedef struct {
+    uint32_t frames;                 /* Read and write operations started */
+    uint32_t address_frames_skipped; /* Clause 45 operations that reused the address already latched in the PHY */
+    uint32_t posted_writes;          /* Writes that returned without waiting for the frame to finish */
+    uint32_t sleeps;                 /* Ticks a waiting thread slept for */
+    uint32_t timeouts;
+} phy_mdio_stats_t;
+
+
+extern phy_mdio_stats_t phy_mdio_stats;
+
+
+void         phy_mdio_invalidate(void);
+phy_status_t phy_mdio_read_c45(uint8_t phy_addr, uint8_t mmd_addr, uint16_t reg_addr, uint16_t *data, uint32_t timeout, bool preamble_suppression, uint32_t clock_range);
+phy_status_t phy_mdio_write_c45(uint8_t phy_addr, uint8_t mmd_addr, uint16_t reg_addr, uint16_t data, uint32_t timeout, bool preamble_suppression, uint32_t clock_range);
+phy_status_t phy_mdio_read_c22(uint8_t phy_addr, uint16_t reg_addr, uint16_t *data, uint32_t timeout, uint32_t clock_range);
+phy_status_t phy_mdio_write_c22(uint8_t phy_addr, uint16_t reg_addr, uint16_t data, uint32_t timeout, uint32_t clock_range);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_PHY_PHY_MDIO_H_ */
@@ -14,6 +14,7 @@ extern "C" {
 
 
 #include "stdint.h"
+#include "stdbool.h"
 #include "tx_api.h"
 
 #include "config.h"
@@ -29,13 +30,25 @@ extern phy_handle_88q211x_t hphy1;
 extern phy_handle_88q211x_t hphy2;
 extern phy_handle_lan867x_t hphy3;
 
-extern void *phy_handles[NUM_PHYS];
-extern float phy_temperatures[NUM_PHYS];
-extern bool  phy_temperatures_valid[NUM_PHYS];
+/* Result of the last cable test on a port */
+typedef struct {
+    bool                      valid;
+    phy_cable_state_88q211x_t state;
+    uint32_t                  peak_distance; /* Distance to the largest reflection, as reported by the PHY */
+    uint32_t                  time;          /* Uptime in ms when the test finished */
+} phy_cable_result_t;
+
+
+extern void              *phy_handles[NUM_PHYS];
+extern float              phy_temperatures[NUM_PHYS];
+extern bool               phy_temperatures_valid[NUM_PHYS];
+extern phy_cable_result_t phy_cable_results[NUM_PHYS];
 
 
 /* Exported functions*/
 phy_status_t phys_init(void);
+phy_status_t phy_88q211x_reinit(uint32_t index);
+void         phy_cable_result_get(uint32_t index, phy_cable_result_t *result);
 void         phy_thread_entry(uint32_t initial_input);
 
 
@@ -0,0 +1,61 @@
+/* Automatically generated nanopb header */
+/* Generated by nanopb-1.0.0-dev */
+
+#ifndef PB_POOL_PB_H_INCLUDED
+#define PB_POOL_PB_H_INCLUDED
+#include <pb.h>
+
+#if PB_PROTO_HEADER_VERSION != 40
+#error Regenerate this file with the current version of nanopb generator.
+#endif
+
+/* Struct definitions */
+typedef struct _PoolDiag {
+    bool has_index;
+    uint32_t index; /* nx_pool_index_t, needed since delta messages skip unchanged pools */
+    bool has_available;
+    uint32_t available; /* free packets when the message was built */
+    bool has_low_watermark;
+    uint32_t low_watermark; /* fewest free packets since boot, 0 once the pool has run dry */
+    bool has_empty_requests;
+    uint32_t empty_requests; /* allocations that found the pool empty */
+} PoolDiag;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Initializer values for message structs */
+#define PoolDiag_init_default                    {false, 0, false, 0, false, 0, false, 0}
+#define PoolDiag_init_zero                       {false, 0, false, 0, false, 0, false, 0}
+
+/* Field tags (for use in manual encoding/decoding) */
+#define PoolDiag_index_tag                       1
+#define PoolDiag_available_tag                   2
+#define PoolDiag_low_watermark_tag               3
+#define PoolDiag_empty_requests_tag              4
+
+/* Struct field encoding specification for nanopb */
+#define PoolDiag_FIELDLIST(X, a) \
+X(a, STATIC,   OPTIONAL, UINT32,   index,             1) \
+X(a, STATIC,   OPTIONAL, UINT32,   available,         2) \
+X(a, STATIC,   OPTIONAL, UINT32,   low_watermark,     3) \
+X(a, STATIC,   OPTIONAL, UINT32,   empty_requests,    4)
+#define PoolDiag_CALLBACK NULL
+#define PoolDiag_DEFAULT NULL
+
+extern const pb_msgdesc_t PoolDiag_msg;
+
+/* Defines for backwards compatibility with code written before nanopb-0.4.0 */
+#define PoolDiag_fields &PoolDiag_msg
+
+/* Maximum encoded size of messages (where known) */
+#define POOL_PB_H_MAX_SIZE                       PoolDiag_size
+#define PoolDiag_size                            24
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif
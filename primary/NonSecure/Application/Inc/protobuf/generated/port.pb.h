@@ -26,6 +26,14 @@ typedef struct _PortDiag {
     uint32_t dropped_frames;
     bool has_phy_temp;
     float phy_temp;
+    bool has_index;
+    uint32_t index; /* port number, needed since delta messages skip unchanged ports */
+    bool has_cable_state;
+    uint32_t cable_state; /* phy_cable_state_88q211x_t from the last cable test */
+    bool has_cable_peak_distance;
+    uint32_t cable_peak_distance; /* distance to the largest reflection seen by the last cable test */
+    bool has_cable_test_time;
+    uint32_t cable_test_time; /* uptime in ms when the last cable test finished */
 } PortDiag;
 
 
@@ -42,8 +50,8 @@ extern "C" {
 
 
 /* Initializer values for message structs */
-#define PortDiag_init_default                    {_PortState_MIN, false, 0, false, 0, false, 0, false, 0}
-#define PortDiag_init_zero                       {_PortState_MIN, false, 0, false, 0, false, 0, false, 0}
+#define PortDiag_init_default                    {_PortState_MIN, false, 0, false, 0, false, 0, false, 0, false, 0, false, 0, false, 0, false, 0}
+#define PortDiag_init_zero                       {_PortState_MIN, false, 0, false, 0, false, 0, false, 0, false, 0, false, 0, false, 0, false, 0}
 
 /* Field tags (for use in manual encoding/decoding) */
 #define PortDiag_state_tag                       1
@@ -51,6 +59,10 @@ extern "C" {
 #define PortDiag_tx_bytes_tag                    3
 #define PortDiag_dropped_frames_tag              4
 #define PortDiag_phy_temp_tag                    5
+#define PortDiag_index_tag                       6
+#define PortDiag_cable_state_tag                 7
+#define PortDiag_cable_peak_distance_tag         8
+#define PortDiag_cable_test_time_tag             9
 
 /* Struct field encoding specification for nanopb */
 #define PortDiag_FIELDLIST(X, a) \
@@ -58,7 +70,11 @@ X(a, STATIC,   REQUIRED, UENUM,    state,             1) \
 X(a, STATIC,   OPTIONAL, UINT64,   rx_bytes,          2) \
 X(a, STATIC,   OPTIONAL, UINT64,   tx_bytes,          3) \
 X(a, STATIC,   OPTIONAL, UINT32,   dropped_frames,    4) \
-X(a, STATIC,   OPTIONAL, FLOAT,    phy_temp,          5)
+X(a, STATIC,   OPTIONAL, FLOAT,    phy_temp,          5) \
+X(a, STATIC,   OPTIONAL, UINT32,   index,             6) \
+X(a, STATIC,   OPTIONAL, UINT32,   cable_state,       7) \
+X(a, STATIC,   OPTIONAL, UINT32,   cable_peak_distance, 8) \
+X(a, STATIC,   OPTIONAL, UINT32,   cable_test_time,   9)
 #define PortDiag_CALLBACK NULL
 #define PortDiag_DEFAULT NULL
 
@@ -69,7 +85,7 @@ extern const pb_msgdesc_t PortDiag_msg;
 
 /* Maximum encoded size of messages (where known) */
 #define PORT_PB_H_MAX_SIZE                       PortDiag_size
-#define PortDiag_size                            35
+#define PortDiag_size                            59
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -6,6 +6,7 @@
 #include <pb.h>
 #include "time.pb.h"
 #include "port.pb.h"
+#include "pool.pb.h"
 
 #if PB_PROTO_HEADER_VERSION != 40
 #error Regenerate this file with the current version of nanopb generator.
@@ -18,6 +19,11 @@ typedef struct _SwitchDiag {
     bool has_temp;
     float temp;
     pb_callback_t ports; /* variable number of ports */
+    bool has_keyframe;
+    bool keyframe; /* true if every port and field is present, otherwise only those that changed since the previous message */
+    bool has_sequence;
+    uint32_t sequence; /* incremented on every message so a receiver can spot a missed delta and wait for the next keyframe */
+    pb_callback_t pools; /* NetX packet pool usage, only the pools that changed in a delta */
 } SwitchDiag;
 
 
@@ -26,23 +32,30 @@ extern "C" {
 #endif
 
 /* Initializer values for message structs */
-#define SwitchDiag_init_default                  {false, Timestamp_init_default, false, 0, {{NULL}, NULL}}
-#define SwitchDiag_init_zero                     {false, Timestamp_init_zero, false, 0, {{NULL}, NULL}}
+#define SwitchDiag_init_default                  {false, Timestamp_init_default, false, 0, {{NULL}, NULL}, false, 0, false, 0, {{NULL}, NULL}}
+#define SwitchDiag_init_zero                     {false, Timestamp_init_zero, false, 0, {{NULL}, NULL}, false, 0, false, 0, {{NULL}, NULL}}
 
 /* Field tags (for use in manual encoding/decoding) */
 #define SwitchDiag_timestamp_tag                 1
 #define SwitchDiag_temp_tag                      2
 #define SwitchDiag_ports_tag                     3
+#define SwitchDiag_keyframe_tag                  4
+#define SwitchDiag_sequence_tag                  5
+#define SwitchDiag_pools_tag                     6
 
 /* Struct field encoding specification for nanopb */
 #define SwitchDiag_FIELDLIST(X, a) \
 X(a, STATIC,   OPTIONAL, MESSAGE,  timestamp,         1) \
 X(a, STATIC,   OPTIONAL, FLOAT,    temp,              2) \
-X(a, CALLBACK, REPEATED, MESSAGE,  ports,             3)
+X(a, CALLBACK, REPEATED, MESSAGE,  ports,             3) \
+X(a, STATIC,   OPTIONAL, BOOL,     keyframe,          4) \
+X(a, STATIC,   OPTIONAL, UINT32,   sequence,          5) \
+X(a, CALLBACK, REPEATED, MESSAGE,  pools,             6)
 #define SwitchDiag_CALLBACK pb_default_field_callback
 #define SwitchDiag_DEFAULT NULL
 #define SwitchDiag_timestamp_MSGTYPE Timestamp
 #define SwitchDiag_ports_MSGTYPE PortDiag
+#define SwitchDiag_pools_MSGTYPE PoolDiag
 
 extern const pb_msgdesc_t SwitchDiag_msg;
 
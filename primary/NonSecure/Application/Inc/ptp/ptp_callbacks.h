@@ -20,6 +20,7 @@ extern "C" {
 #include "nxd_ptp_client.h"
 
 #include "ptp_thread.h"
+#include "ptp_servo.h"
 
 
 typedef struct {
@@ -31,13 +32,17 @@ typedef struct {
     atomic_uint_fast32_t timestamps_extracted;
     atomic_uint_fast32_t clock_get;
     atomic_uint_fast32_t clock_adjusted;
+    atomic_uint_fast32_t clock_stepped;           /* Adjustments the servo handled by stepping rather than slewing */
+    atomic_uint_fast32_t frequency_update_missed; /* Addend updates dropped because the previous one was still pending */
     atomic_uint_fast32_t timestamps_sent;
 } ptp_event_counters_t;
 
 
 extern ptp_event_counters_t ptp_event_counters;
+extern ptp_servo_t          ptp_servo;
 
 
+void ptp_servo_stats_get(ptp_servo_stats_t *stats);
 UINT ptp_clock_callback(NX_PTP_CLIENT *client_ptr, UINT operation, NX_PTP_TIME *time_ptr, NX_PACKET *packet_ptr, VOID *callback_data);
 void HAL_ETH_TxPtpCallback(uint32_t *buff, ETH_TimeStampTypeDef *timestamp);
 UINT ptp_event_callback(NX_PTP_CLIENT *ptp_client_ptr, UINT event, VOID *event_data, VOID *callback_data);
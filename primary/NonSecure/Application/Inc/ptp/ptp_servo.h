@@ -0,0 +1,83 @@
+/*
+ * ptp_servo.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+#ifndef INC_PTP_SERVO_H_
+#define INC_PTP_SERVO_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "stdint.h"
+#include "stdbool.h"
+
+
+typedef enum {
+    PTP_SERVO_UNLOCKED = 0, /* Waiting for the first sample */
+    PTP_SERVO_MEASURING,    /* Have one sample, the next one gives the initial frequency error */
+    PTP_SERVO_LOCKED        /* Tracking the master with the PI loop */
+} ptp_servo_state_t;
+
+typedef enum {
+    PTP_SERVO_ACTION_NONE = 0, /* Leave the clock alone */
+    PTP_SERVO_ACTION_ADJUST,   /* Apply the new frequency */
+    PTP_SERVO_ACTION_STEP      /* Step the clock by the offset, then apply the new frequency */
+} ptp_servo_action_t;
+
+/* Published once every window of samples, plus the latest raw values */
+typedef struct {
+    ptp_servo_state_t state;
+    int32_t           offset;            /* Latest offset from the master in ns */
+    float             frequency;         /* Latest frequency correction in ppb */
+    int32_t           path_delay;        /* Latest mean path delay in ns */
+    float             offset_rms;        /* RMS offset over the last window in ns */
+    int32_t           offset_max;        /* Largest absolute offset over the last window in ns */
+    float             frequency_mean;    /* Mean frequency correction over the last window in ppb */
+    int32_t           path_delay_mean;   /* Mean path delay over the last window in ns */
+    uint32_t          samples;           /* Total samples processed */
+    uint32_t          steps;             /* Number of times the clock was stepped */
+    uint32_t          resets;            /* Number of times the servo lost lock, e.g. master changes and clock sets */
+} ptp_servo_stats_t;
+
+typedef struct {
+
+    /* Config */
+    float    kp;             /* Proportional gain, fraction of the offset removed per sample interval */
+    float    ki;             /* Integral gain, fraction of the offset folded into the frequency each sample */
+    float    max_frequency;  /* Limit on the frequency correction in ppb */
+    int32_t  step_threshold; /* Offsets larger than this in ns are stepped out rather than slewed */
+    uint32_t stats_window;   /* Number of samples summarised in each stats update */
+
+    /* State */
+    ptp_servo_state_t state;
+    float             drift;       /* Integral term, the estimated frequency error of the local oscillator in ppb */
+    int64_t           last_time;   /* Local time of the previous sample in ns */
+    int32_t           last_offset;
+
+    /* Stats accumulated over the current window */
+    float    window_offset_sq;
+    int32_t  window_offset_max;
+    float    window_frequency;
+    int64_t  window_path_delay;
+    uint32_t window_count;
+
+    ptp_servo_stats_t stats;
+} ptp_servo_t;
+
+
+void               ptp_servo_init(ptp_servo_t *servo, float kp, float ki, float max_frequency, int32_t step_threshold, uint32_t stats_window);
+void               ptp_servo_reset(ptp_servo_t *servo);
+ptp_servo_action_t ptp_servo_sample(ptp_servo_t *servo, int32_t offset, int64_t local_time, int32_t path_delay, float *frequency);
+uint32_t           ptp_servo_addend(uint32_t base_addend, float frequency);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_PTP_SERVO_H_ */
@@ -0,0 +1,52 @@
+/*
+ * scheduler.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+#ifndef INC_SCHEDULER_H_
+#define INC_SCHEDULER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "stdint.h"
+#include "stdbool.h"
+
+
+typedef struct {
+    const char *name;
+    void (*function)(void *arg);
+    void    *arg;
+    uint32_t period;   /* ms between runs */
+    uint32_t phase;    /* ms after the scheduler starts of the first run. Jobs sharing a bus should be given different phases so they don't all run at once */
+    uint32_t next_run; /* Managed by the scheduler */
+} periodic_job_t;
+
+/* A min-heap of jobs ordered by their next deadline */
+typedef struct {
+    periodic_job_t **heap;
+    uint32_t         capacity;
+    uint32_t         count;
+    uint32_t         overruns; /* Number of times a job was so late that runs were skipped */
+} scheduler_t;
+
+
+/* Wrap safe comparison of two times in ms */
+#define SCHEDULER_TIME_BEFORE(a, b) (((int32_t) ((a) - (b))) < 0)
+
+
+void     scheduler_init(scheduler_t *scheduler, periodic_job_t **heap, uint32_t capacity);
+void     scheduler_add(scheduler_t *scheduler, periodic_job_t *job, uint32_t now);
+void     scheduler_run(scheduler_t *scheduler, uint32_t now);
+uint32_t scheduler_delay(const scheduler_t *scheduler, uint32_t now);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_SCHEDULER_H_ */
@@ -13,6 +13,7 @@ extern "C" {
 #endif
 
 
+#include "stdatomic.h"
 #include "sja1105.h"
 
 
@@ -27,9 +28,14 @@ extern CRC_HandleTypeDef SWCH_CRC;
 
 /* Exported variables */
 extern TX_MUTEX                  sja1105_mutex_handle;
+extern TX_SEMAPHORE              sja1105_spi_semaphore_handle;
 extern const sja1105_callbacks_t sja1105_callbacks;
+extern atomic_uint_fast32_t      sja1105_spi_words;    /* Total 32-bit words transferred over the switch SPI */
+extern atomic_bool               sja1105_tables_dirty; /* Set by SPI writes to the switch tables, cleared when the local tables are re-read */
 
 sja1105_status_t switch_byte_pool_init(void);
+void             switch_spi_untracked_begin(void);
+void             switch_spi_untracked_end(void);
 
 
 #ifdef __cplusplus
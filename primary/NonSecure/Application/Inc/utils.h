@@ -22,6 +22,7 @@ extern "C" {
 /* Because of the multiply, care should be taken when putting large values into these functions (>4,000,000) to make sure the don't overflow */
 #define TICKS_TO_MS(ticks)        (((ticks) * 1000) / TX_TIMER_TICKS_PER_SECOND)
 #define MS_TO_TICKS(ms)           (((ms) * TX_TIMER_TICKS_PER_SECOND) / 1000)
+#define CYCLES_PER_US             (SystemCoreClock / 1000000)
 
 #define MIN(a, b)                 ((a) < (b) ? (a) : (b))
 #define MAX(a, b)                 ((a) > (b) ? (a) : (b))
@@ -32,6 +33,10 @@ bool compare_mac_addrs_with_mask(const uint8_t* addr1, const uint8_t* addr2, con
 
 uint32_t tx_thread_sleep_ms(uint32_t ms);
 uint32_t tx_time_get_ms();
+void     tx_thread_sleep_us(uint32_t us);
+
+uint64_t cycles_get(void);
+uint64_t time_get_us(void);
 
 void delay_ns(uint32_t ns);
 
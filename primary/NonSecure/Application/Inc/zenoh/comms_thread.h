@@ -22,6 +22,7 @@ extern "C" {
 #include "config.h"
 #include "tx_app.h"
 #include "state_machine.h"
+#include "zenoh_publication.h"
 
 
 typedef struct {
@@ -36,6 +37,13 @@ typedef struct {
     uint64_t             bytes_received; /* No 64-bit atomics so accesses should use TX_DISABLE */
 } zenoh_event_counters_t;
 
+/* The remote end of the last unicast link opened by Zenoh Pico */
+typedef struct {
+    const char *protocol; /* "tcp" or "udp", NULL if none has been opened */
+    ULONG       ip_address;
+    UINT        port;
+} zenoh_locator_t;
+
 
 /* Exported variables */
 extern uint8_t      comms_thread_stack[COMMS_THREAD_STACK_SIZE];
@@ -44,8 +52,10 @@ extern uint8_t      zenoh_byte_pool_buffer[ZENOH_MEM_POOL_SIZE];
 extern TX_BYTE_POOL zenoh_byte_pool;
 
 extern zenoh_event_counters_t zenoh_events;
+extern zenoh_locator_t        zenoh_last_locator;
+extern atomic_uint_fast32_t   zenoh_session_generation; /* Incremented every time a session is opened */
 
-extern z_owned_publisher_t stats_pub;
+extern zenoh_publication_t stats_publication;
 
 
 tx_status_t zenoh_connected(bool update_state_machine);
@@ -30,7 +30,7 @@ extern "C" {
 #define Z_FEATURE_LIVELINESS             1
 #define Z_FEATURE_RAWETH_TRANSPORT       0
 #define Z_FEATURE_INTEREST               1
-#define Z_FEATURE_LINK_TCP               0
+#define Z_FEATURE_LINK_TCP               1
 #define Z_FEATURE_LINK_BLUETOOTH         0
 #define Z_FEATURE_LINK_WS                0
 #define Z_FEATURE_LINK_SERIAL            0
@@ -59,9 +59,8 @@ typedef void *z_task_attr_t; // Not used
 typedef TX_MUTEX _z_mutex_rec_t;
 typedef TX_MUTEX _z_mutex_t;
 typedef struct {
-    TX_MUTEX     mutex;
     TX_SEMAPHORE sem;
-    UINT         waiters;
+    UINT         waiters; /* Only accessed with interrupts disabled */
 } _z_condvar_t;
 
 typedef NX_PTP_TIME z_clock_t;
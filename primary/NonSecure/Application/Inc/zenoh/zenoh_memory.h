@@ -0,0 +1,54 @@
+/*
+ * zenoh_memory.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+#ifndef INC_ZENOH_ZENOH_MEMORY_H_
+#define INC_ZENOH_ZENOH_MEMORY_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stddef.h"
+#include "tx_api.h"
+
+#include "config.h"
+
+
+typedef struct {
+    ULONG block_size;     /* Largest allocation served by this class */
+    ULONG total;          /* Blocks in the pool */
+    ULONG high_watermark; /* Most blocks in use at once, kept across session restarts */
+    ULONG failures;       /* Allocations that fitted this class but found it empty */
+} zenoh_memory_class_stats_t;
+
+typedef struct {
+    zenoh_memory_class_stats_t classes[ZENOH_MEM_BLOCK_CLASSES];
+    ULONG                      byte_pool_allocations;  /* Allocations too big for any class, or spilled from full classes */
+    ULONG                      byte_pool_low_watermark; /* Fewest free bytes seen in zenoh_byte_pool */
+} zenoh_memory_stats_t;
+
+
+extern zenoh_memory_stats_t zenoh_memory_stats;
+
+
+void   zenoh_memory_init(void);
+void   zenoh_memory_deinit(void);
+void  *zenoh_memory_allocate(size_t size);
+void   zenoh_memory_release(void *ptr);
+size_t zenoh_memory_usable_size(const void *ptr);
+bool   zenoh_memory_resize(void *ptr, size_t size);
+void   zenoh_memory_trace_log(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_ZENOH_ZENOH_MEMORY_H_ */
@@ -0,0 +1,39 @@
+/*
+ * zenoh_publication.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+#ifndef INC_ZENOH_ZENOH_PUBLICATION_H_
+#define INC_ZENOH_ZENOH_PUBLICATION_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "stdint.h"
+#include "stddef.h"
+#include "zenoh-pico.h"
+
+
+/* A publisher whose key expression, encoding and QoS are fixed when it is declared, so each publish only needs the
+ * payload. The encoding is attached to the publisher rather than to every put */
+typedef struct {
+    const char                  *keyexpr;
+    const char                  *encoding;
+    const z_publisher_options_t *options;   /* QoS, NULL for the defaults. The encoding field is ignored */
+    z_owned_publisher_t          publisher; /* Valid while the session that declared it is open */
+} zenoh_publication_t;
+
+
+z_result_t zenoh_publication_declare(const z_loaned_session_t *session, zenoh_publication_t *publication);
+z_result_t zenoh_publication_put(zenoh_publication_t *publication, const uint8_t *buf, size_t len);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_ZENOH_ZENOH_PUBLICATION_H_ */
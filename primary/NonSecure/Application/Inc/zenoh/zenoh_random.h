@@ -0,0 +1,28 @@
+/*
+ * zenoh_random.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+#ifndef INC_ZENOH_ZENOH_RANDOM_H_
+#define INC_ZENOH_ZENOH_RANDOM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "stdint.h"
+#include "stddef.h"
+
+
+void zenoh_random_seed(void);
+void zenoh_random_fill(void *buf, size_t len);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_ZENOH_ZENOH_RANDOM_H_ */
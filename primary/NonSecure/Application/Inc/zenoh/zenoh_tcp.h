@@ -0,0 +1,37 @@
+/*
+ * zenoh_tcp.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+#ifndef INC_ZENOH_ZENOH_TCP_H_
+#define INC_ZENOH_ZENOH_TCP_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stddef.h"
+#include "nx_api.h"
+
+
+/* A Zenoh Pico TCP socket. As with zenoh_udp_socket_t the NetX socket must be the first member */
+typedef struct {
+    NX_TCP_SOCKET socket;
+    NX_PACKET    *rx_packet; /* Segment being read, kept until all of it has been consumed */
+    ULONG         rx_offset; /* Bytes of rx_packet already consumed */
+} zenoh_tcp_socket_t;
+
+
+void zenoh_tcp_socket_rx_flush(zenoh_tcp_socket_t *socket_ptr);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_ZENOH_ZENOH_TCP_H_ */
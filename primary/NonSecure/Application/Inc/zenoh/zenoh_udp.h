@@ -0,0 +1,46 @@
+/*
+ * zenoh_udp.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+#ifndef INC_ZENOH_ZENOH_UDP_H_
+#define INC_ZENOH_ZENOH_UDP_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stddef.h"
+#include "nx_api.h"
+
+
+/* A Zenoh Pico UDP socket. Zenoh Pico passes sockets by value so the receive cursor lives alongside the NetX socket.
+ * The NetX socket must be the first member so the wrapper can be found from it (see zenoh_cleanup_nx) */
+typedef struct {
+    NX_UDP_SOCKET socket;
+    NX_PACKET    *rx_packet; /* Packet being read, kept until all of it has been consumed */
+    ULONG         rx_offset; /* Bytes of rx_packet already consumed */
+} zenoh_udp_socket_t;
+
+
+void   zenoh_udp_socket_rx_flush(zenoh_udp_socket_t *socket_ptr);
+
+void   zenoh_udp_buffers_init(void);
+void   zenoh_udp_buffers_reset(void);
+void   zenoh_udp_buffer_provider_arm(void);
+void   zenoh_udp_buffer_provider_disarm(void);
+void  *zenoh_udp_buffer_acquire(size_t size);
+bool   zenoh_udp_buffer_release(void *ptr);
+size_t zenoh_udp_buffer_size(const void *ptr);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_ZENOH_ZENOH_UDP_H_ */
@@ -9,37 +9,65 @@
 #include "secure_nsc.h"
 
 #include "background_thread.h"
+#include "nx_app.h"
 #include "utils.h"
+#include "scheduler.h"
 
 
 TX_THREAD background_thread_handle;
 uint8_t   background_thread_stack[BACKGROUND_THREAD_STACK_SIZE];
 
 
-void background_thread_entry(uint32_t initial_input) {
+/* Periodic jobs */
+static void background_secure_job(void *arg);
+static void background_pool_stats_job(void *arg);
+static void background_cycles_job(void *arg);
 
-    uint32_t current_time = tx_time_get_ms();
-    uint32_t next_wakeup  = current_time + BACKGROUND_THREAD_INTERVAL;
+static periodic_job_t background_jobs[] = {
+    {.name = "Secure background", .function = background_secure_job,     .period = BACKGROUND_THREAD_INTERVAL,     .phase = 0                                 },
+    {.name = "Pool stats",        .function = background_pool_stats_job, .period = BACKGROUND_POOL_STATS_INTERVAL, .phase = BACKGROUND_POOL_STATS_INTERVAL / 2},
+    {.name = "Cycle counter",     .function = background_cycles_job,     .period = BACKGROUND_CYCLES_INTERVAL,     .phase = 0                                 },
+};
 
-    while (1) {
+static periodic_job_t *background_jobs_heap[sizeof(background_jobs) / sizeof(background_jobs[0])];
+static scheduler_t     background_scheduler;
+
+
+/* Do background tasks in the secure world
+ * - TODO: Read all flash and RAM for ECC errors
+ * - Check if changes have been made to the metadata and sync them to the FRAM
+ */
+static void background_secure_job(void *arg) {
+    s_background_task();
+}
+
+
+/* Sample the packet pool usage */
+static void background_pool_stats_job(void *arg) {
+    nx_pool_stats_update();
+}
 
-        current_time = tx_time_get_ms();
 
-        /* Do background tasks in the secure world
-         * - TODO: Read all flash and RAM for ECC errors
-         * - Check if changes have been made to the metadata and sync them to the FRAM
-         */
-        s_background_task();
+/* Keep the 64-bit cycle counter from missing a wrap of CYCCNT */
+static void background_cycles_job(void *arg) {
+    cycles_get();
+}
 
-        /* Schedule the next wakeup */
-        next_wakeup += BACKGROUND_THREAD_INTERVAL;
-        if (current_time < next_wakeup) {
-            tx_thread_sleep_ms(next_wakeup - current_time);
-        }
 
-        /* Somehow we have gotten far behind so catch up */
-        else if ((current_time - next_wakeup) > (BACKGROUND_THREAD_INTERVAL * 3)) {
-            next_wakeup = current_time;
-        }
+void background_thread_entry(uint32_t initial_input) {
+
+    uint32_t delay;
+
+    scheduler_init(&background_scheduler, background_jobs_heap, sizeof(background_jobs_heap) / sizeof(background_jobs_heap[0]));
+    for (uint_fast8_t i = 0; i < (sizeof(background_jobs) / sizeof(background_jobs[0])); i++) {
+        scheduler_add(&background_scheduler, &background_jobs[i], tx_time_get_ms());
+    }
+
+    while (1) {
+
+        /* Run whatever is due and sleep until the next job */
+        scheduler_run(&background_scheduler, tx_time_get_ms());
+        delay = scheduler_delay(&background_scheduler, tx_time_get_ms());
+        if (delay > 0) tx_thread_sleep_ms(delay);
     }
-}
\ No newline at end of file
+}
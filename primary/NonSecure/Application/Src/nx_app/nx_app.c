@@ -7,6 +7,7 @@
 
 #include "stdint.h"
 #include "stdbool.h"
+#include "string.h"
 #include "nx_api.h"
 #include "nxd_dhcp_client.h"
 #include "nxd_ptp_client.h"
@@ -27,6 +28,24 @@ NX_IP nx_ip_instance __attribute__((section(".ETH_Section")));
 NX_PACKET_POOL nx_packet_pool __attribute__((section(".ETH_Section")));
 static uint8_t nx_packet_pool_memory[NX_APP_PACKET_POOL_SIZE] __attribute__((section(".ETH_Section")));
 
+NX_PACKET_POOL nx_rx_packet_pool __attribute__((section(".ETH_Section")));
+static uint8_t nx_rx_packet_pool_memory[NX_APP_RX_PACKET_POOL_SIZE] __attribute__((section(".ETH_Section")));
+
+NX_PACKET_POOL nx_zenoh_packet_pool __attribute__((section(".ETH_Section")));
+static uint8_t nx_zenoh_packet_pool_memory[NX_APP_ZENOH_PACKET_POOL_SIZE] __attribute__((section(".ETH_Section")));
+
+NX_PACKET_POOL nx_small_packet_pool __attribute__((section(".ETH_Section")));
+static uint8_t nx_small_packet_pool_memory[NX_APP_SMALL_PACKET_POOL_SIZE] __attribute__((section(".ETH_Section")));
+
+/* Pool usage statistics, indexed by nx_pool_index_t */
+static NX_PACKET_POOL *const nx_pools[NX_NUM_POOLS] = {
+    [NX_POOL_TX]    = &nx_packet_pool,
+    [NX_POOL_RX]    = &nx_rx_packet_pool,
+    [NX_POOL_ZENOH] = &nx_zenoh_packet_pool,
+    [NX_POOL_SMALL] = &nx_small_packet_pool,
+};
+nx_pool_stats_t nx_pool_stats[NX_NUM_POOLS];
+
 NX_DHCP dhcp_client __attribute__((section(".ETH_Section")));
 
 
@@ -47,6 +66,30 @@ nx_status_t nx_setup(TX_BYTE_POOL *byte_pool) {
     nx_status = nx_packet_pool_create(&nx_packet_pool, "NetXDuo App Pool", DEFAULT_PAYLOAD_SIZE, nx_packet_pool_memory, NX_APP_PACKET_POOL_SIZE);
     if (nx_status != NX_SUCCESS) return nx_status;
 
+    /* Create the receive packet pool. This is only used by the ethernet driver so bursts of outgoing traffic can't
+     * starve reception */
+    nx_status = nx_packet_pool_create(&nx_rx_packet_pool, "NetXDuo RX Pool", DEFAULT_PAYLOAD_SIZE, nx_rx_packet_pool_memory, NX_APP_RX_PACKET_POOL_SIZE);
+    if (nx_status != NX_SUCCESS) return nx_status;
+
+    /* Give the receive pool to the driver. This must happen before the IP instance initialises the driver */
+    nx_status = nx_stm32_eth_driver_rx_pool_set(&nx_rx_packet_pool);
+    if (nx_status != NX_SUCCESS) return nx_status;
+
+    /* Create the Zenoh transmit pool so a burst of publishes can't starve the rest of the stack */
+    nx_status = nx_packet_pool_create(&nx_zenoh_packet_pool, "NetXDuo Zenoh Pool", DEFAULT_PAYLOAD_SIZE, nx_zenoh_packet_pool_memory, NX_APP_ZENOH_PACKET_POOL_SIZE);
+    if (nx_status != NX_SUCCESS) return nx_status;
+
+    /* Create the small packet pool for PTP, BPDUs, ARP, TCP control and other short frames */
+    nx_status = nx_packet_pool_create(&nx_small_packet_pool, "NetXDuo Small Pool", NX_APP_SMALL_PAYLOAD_SIZE, nx_small_packet_pool_memory, NX_APP_SMALL_PACKET_POOL_SIZE);
+    if (nx_status != NX_SUCCESS) return nx_status;
+
+    /* Start the low watermarks at the pool sizes */
+    for (nx_pool_index_t i = 0; i < NX_NUM_POOLS; i++) {
+        nx_pool_stats[i].available      = nx_pools[i]->nx_packet_pool_total;
+        nx_pool_stats[i].low_watermark  = nx_pools[i]->nx_packet_pool_total;
+        nx_pool_stats[i].empty_requests = 0;
+    }
+
     /* Allocate the memory for nx_ip_instance */
     tx_status = tx_byte_allocate(byte_pool, (void **) &pointer, NX_INTERNAL_IP_THREAD_STACK_SIZE, TX_NO_WAIT);
     if (tx_status != TX_SUCCESS) return NX_STATUS_POOL_ERROR;
@@ -55,6 +98,10 @@ nx_status_t nx_setup(TX_BYTE_POOL *byte_pool) {
     nx_status = nx_ip_create(&nx_ip_instance, "NetX IP instance", NX_DEFAULT_IP_ADDRESS, NX_DEFAULT_NET_MASK, &nx_packet_pool, nx_stm32_eth_driver, pointer, NX_INTERNAL_IP_THREAD_STACK_SIZE, NX_INTERNAL_IP_THREAD_PRIORITY);
     if (nx_status != NX_SUCCESS) return nx_status;
 
+    /* NetX allocates ARP, ICMPv6 and TCP control packets from the auxiliary pool (NX_ENABLE_DUAL_PACKET_POOL) */
+    nx_status = nx_ip_auxiliary_packet_pool_set(&nx_ip_instance, &nx_small_packet_pool);
+    if (nx_status != NX_SUCCESS) return nx_status;
+
     /* Allocate the memory for ARP */
     tx_status = tx_byte_allocate(byte_pool, (void **) &pointer, DEFAULT_ARP_CACHE_SIZE, TX_NO_WAIT);
     if (tx_status != TX_SUCCESS) return NX_STATUS_POOL_ERROR;
@@ -81,3 +128,42 @@ nx_status_t nx_setup(TX_BYTE_POOL *byte_pool) {
 
     return nx_status;
 }
+
+
+/* Sample the number of free packets in each pool and update the low watermarks. A pool can run dry and refill between
+ * two samples, so a rise in the pool's empty request count also takes the low watermark to zero */
+void nx_pool_stats_update(void) {
+
+    TX_INTERRUPT_SAVE_AREA
+
+    ULONG available;
+    ULONG empty_requests;
+
+    for (nx_pool_index_t i = 0; i < NX_NUM_POOLS; i++) {
+
+        TX_DISABLE
+        available      = nx_pools[i]->nx_packet_pool_available;
+        empty_requests = nx_pools[i]->nx_packet_pool_empty_requests;
+        if (empty_requests != nx_pool_stats[i].empty_requests) {
+            nx_pool_stats[i].low_watermark = 0;
+        } else if (available < nx_pool_stats[i].low_watermark) {
+            nx_pool_stats[i].low_watermark = available;
+        }
+        nx_pool_stats[i].available      = available;
+        nx_pool_stats[i].empty_requests = empty_requests;
+        TX_RESTORE
+    }
+}
+
+
+/* Take a fresh sample and copy out the stats of every pool */
+void nx_pool_stats_get(nx_pool_stats_t stats[NX_NUM_POOLS]) {
+
+    TX_INTERRUPT_SAVE_AREA
+
+    nx_pool_stats_update();
+
+    TX_DISABLE
+    memcpy(stats, nx_pool_stats, sizeof(nx_pool_stats));
+    TX_RESTORE
+}
@@ -15,6 +15,7 @@
 #include "nx_app.h"
 #include "switch_thread.h"
 #include "phy_thread.h"
+#include "phy_callbacks.h"
 #include "config.h"
 
 
@@ -33,9 +34,14 @@ int32_t nx_eth_phy_get_link_state(void) {
 
     int32_t linkstate = ETH_PHY_STATUS_LINK_ERROR;
 
-    /* If SJA1105 isn't initialised or none of the PHYs have links then return link down */
-    bool phy_link_up         = hphy0.linkup || hphy1.linkup || hphy2.linkup || hphy3.linkup;
-    bool external_connection = hsja1105.initialised && (phy_link_up || !PHY_LINK_REQUIRED_FOR_NX_LINK);
+    /* If SJA1105 isn't initialised or none of the PHYs have links then return link down. The link state comes from
+     * phy_link_up since that is what the link change events are sent for, the switch thread sends one when the switch
+     * initialised flag changes */
+    bool any_link_up = false;
+    for (uint_fast8_t i = 0; i < NUM_PHYS; i++) {
+        any_link_up |= phy_link_up[i];
+    }
+    bool external_connection = hsja1105.initialised && (any_link_up || !PHY_LINK_REQUIRED_FOR_NX_LINK);
     if (!external_connection) {
         linkstate = ETH_PHY_STATUS_LINK_DOWN;
         return linkstate;
@@ -13,6 +13,8 @@
 #include "main.h"
 
 #include "nx_app.h"
+#include "nx_link_thread.h"
+#include "phy_callbacks.h"
 #include "config.h"
 #include "utils.h"
 #include "tx_app.h"
@@ -26,8 +28,9 @@
 uint32_t ip_address;
 uint32_t net_mask;
 
-TX_THREAD nx_link_thread_handle;
-uint8_t   nx_link_thread_stack[NX_LINK_THREAD_STACK_SIZE];
+TX_THREAD            nx_link_thread_handle;
+uint8_t              nx_link_thread_stack[NX_LINK_THREAD_STACK_SIZE];
+TX_EVENT_FLAGS_GROUP nx_link_events_handle;
 
 
 static void ip_address_change_notify_callback(NX_IP *ip_instance, void *ptr) {
@@ -61,9 +64,9 @@ static void ip_address_change_notify_callback(NX_IP *ip_instance, void *ptr) {
 
 
 /* TODO: Remember the dynamically assigned IP address (NX_DHCP_CLIENT_RESTORE_STATE) */
-/* TODO: Respond to PHY linkup events or poll faster when the link is down */
 
-/* This thread monitors the link state */
+/* This thread monitors the link state. It sleeps until a PHY reports a link change or the switch thread reports the
+ * switch being initialised, with a slow fallback check in case something changes the link without an event */
 void nx_link_thread_entry(uint32_t thread_input) {
 
     uint32_t    actual_status = 0;
@@ -71,6 +74,13 @@ void nx_link_thread_entry(uint32_t thread_input) {
     tx_status_t tx_status     = TX_SUCCESS;
     bool        linkdown      = true;
     uint32_t    current_time;
+    uint32_t    timeout;
+    uint32_t    event_flags;
+
+    static const ULONG link_flags[NUM_PHYS] = {NX_LINK_PHY_EVENT, NX_LINK_PHY_EVENT, NX_LINK_PHY_EVENT, NX_LINK_PHY_EVENT};
+
+    /* Get woken up by PHY link changes. Any that happened before this are picked up by the first check below */
+    phy_link_subscribe(&nx_link_events_handle, link_flags);
 
     /* Register the IP address change callback */
     nx_status = nx_ip_address_change_notify(&nx_ip_instance, ip_address_change_notify_callback, NULL);
@@ -177,11 +187,13 @@ void nx_link_thread_entry(uint32_t thread_input) {
         }
 #endif
 
-        /* Delay differently based on link state. TODO: Use an event from the PHY thread to wake up faster */
-        if (linkdown) {
-            tx_thread_sleep_ms(NX_APP_CABLE_CONNECTION_CHECK_UP_PERIOD);
-        } else {
-            tx_thread_sleep_ms(NX_APP_CABLE_CONNECTION_CHECK_DOWN_PERIOD);
-        }
+        /* Wait for a link change, or until the fallback check or DHCP record save is due */
+        timeout = NX_LINK_FALLBACK_CHECK_PERIOD;
+#if ENABLE_DHCP_RESTORE == true
+        current_time = tx_time_get_ms();
+        timeout      = (dhcp_record_next_save_time > current_time) ? MIN(timeout, dhcp_record_next_save_time - current_time) : 0;
+#endif
+        tx_status = tx_event_flags_get(&nx_link_events_handle, NX_LINK_ALL_EVENTS, TX_OR_CLEAR, &event_flags, MS_TO_TICKS(timeout));
+        if ((tx_status != TX_SUCCESS) && (tx_status != TX_NO_EVENTS)) Error_Handler();
     }
 }
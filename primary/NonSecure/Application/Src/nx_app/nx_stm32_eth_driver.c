@@ -32,6 +32,7 @@
 #include "nx_stp.h"
 #include "stp_callbacks.h"
 #include "utils.h"
+#include "config.h"
 #include "main.h"
 
 #endif /* NX_STM32_ETH_DRIVER_H */
@@ -55,6 +56,35 @@ ETH_MACFilterConfigTypeDef FilterConfig;
 
 /****** DRIVER SPECIFIC ****** Start of part/vendor specific data area.  Include hardware-specific data here!  */
 
+/* TX buffer chain, one entry per DMA descriptor. HAL_ETH_Transmit_IT() copies the chain into the descriptors before
+ * returning, so the entries can be overwritten by the next send without waiting for the frame to complete. */
+static ETH_BufferTypeDef tx_buffer_ring[ETH_TX_DESC_CNT];
+
+/* Dedicated pool for receive packets. If this isn't set the IP instance's default pool is used */
+static NX_PACKET_POOL *rx_packet_pool_ptr = NX_NULL;
+
+/* Receive packets allocated in bulk by the IP thread. HAL_ETH_RxAllocateCallback() takes from here first so refilling
+ * the descriptors doesn't need a pool allocation per descriptor. Only as many packets as there are descriptors about to
+ * need a buffer are taken, so the stash is empty while the port is idle and doesn't eat into the RX pool. */
+static NX_PACKET *rx_refill_stash[ETH_RX_DESC_CNT];
+static UINT       rx_refill_count = 0;
+
+/* Receive packets held back for error recovery. After a Receive Buffer Unavailable fault the pool is usually empty, so
+ * these make sure some descriptors can be handed back to the DMA to restart reception. */
+static NX_PACKET *rx_reserve[NX_DRIVER_RX_RESERVE];
+static UINT       rx_reserve_count = 0;
+
+/* Error causes latched by HAL_ETH_ErrorCallback() for the IP thread to act on */
+static NX_DRIVER_ERROR_COUNTERS error_counters;
+static volatile ULONG           dma_error_pending   = 0;
+static volatile UINT            mac_error_pending   = NX_FALSE;
+static UINT                     rx_recovery_pending = NX_FALSE;
+
+/* Retries the receive restart after a Receive Buffer Unavailable fault. With the DMA suspended there are no receive
+ * interrupts, and on an idle or receive only port there may be no other deferred events either */
+static TX_TIMER rx_recovery_timer;
+static UINT     rx_recovery_timer_created = NX_FALSE;
+
 /****** DRIVER SPECIFIC ****** End of part/vendor specific data area!  */
 
 
@@ -90,7 +120,14 @@ static UINT _nx_driver_hardware_packet_send(NX_PACKET *packet_ptr);
 static UINT _nx_driver_hardware_multicast_join(NX_IP_DRIVER *driver_req_ptr);
 static UINT _nx_driver_hardware_multicast_leave(NX_IP_DRIVER *driver_req_ptr);
 static UINT _nx_driver_hardware_get_status(NX_IP_DRIVER *driver_req_ptr);
-static VOID _nx_driver_hardware_packet_received(VOID);
+static UINT _nx_driver_hardware_packet_received(UINT budget);
+static VOID _nx_driver_hardware_rx_refill(VOID);
+static UINT _nx_driver_hardware_rx_descriptors_pending(VOID);
+static VOID _nx_driver_hardware_error_recover(VOID);
+static UINT _nx_driver_hardware_restart(VOID);
+static VOID _nx_driver_hardware_rx_resume(VOID);
+static VOID _nx_driver_hardware_rings_reset(VOID);
+static VOID _nx_driver_rx_recovery_timer_entry(ULONG id);
 #ifdef NX_ENABLE_INTERFACE_CAPABILITY
 static UINT _nx_driver_hardware_capability_set(NX_IP_DRIVER *driver_req_ptr);
 #endif /* NX_ENABLE_INTERFACE_CAPABILITY */
@@ -397,8 +434,12 @@ static VOID _nx_driver_initialize(NX_IP_DRIVER *driver_req_ptr) {
     /* Setup the driver state to not initialized.  */
     nx_driver_information.nx_driver_information_state = NX_DRIVER_STATE_NOT_INITIALIZED;
 
-    /* Setup the default packet pool for the driver's received packets.  */
-    nx_driver_information.nx_driver_information_packet_pool_ptr = ip_ptr->nx_ip_default_packet_pool;
+    /* Setup the packet pool for the driver's received packets. Use the dedicated pool if one has been set.  */
+    if (rx_packet_pool_ptr != NX_NULL) {
+        nx_driver_information.nx_driver_information_packet_pool_ptr = rx_packet_pool_ptr;
+    } else {
+        nx_driver_information.nx_driver_information_packet_pool_ptr = ip_ptr->nx_ip_default_packet_pool;
+    }
 
     /* Get the rounded start pool start. */
     rounded_pool_start = nx_driver_information.nx_driver_information_packet_pool_ptr->nx_packet_pool_start;
@@ -1296,6 +1337,7 @@ static VOID _nx_driver_deferred_processing(NX_IP_DRIVER *driver_req_ptr) {
     TX_INTERRUPT_SAVE_AREA
 
     ULONG deferred_events;
+    UINT  received;
 
 
     /* Disable interrupts.  */
@@ -1307,6 +1349,20 @@ static VOID _nx_driver_deferred_processing(NX_IP_DRIVER *driver_req_ptr) {
 
     /* Restore interrupts.  */
     TX_RESTORE
+
+    /* Check for a DMA or MAC error.  */
+    if (deferred_events & NX_DRIVER_DEFERRED_DMA_ERROR) {
+
+        /* Classify the error and restart whatever has stopped.  */
+        _nx_driver_hardware_error_recover();
+    }
+
+    /* Keep draining and rebuilding the receive ring until reception has been restarted. With the DMA suspended there
+       are no receive interrupts, so the recovery timer raises a deferred event to retry if nothing else does.  */
+    if (rx_recovery_pending) {
+        deferred_events |= NX_DRIVER_DEFERRED_PACKET_RECEIVED;
+    }
+
     /* Check for a transmit complete event.  */
     if (deferred_events & NX_DRIVER_DEFERRED_PACKET_TRANSMITTED) {
 
@@ -1316,8 +1372,35 @@ static VOID _nx_driver_deferred_processing(NX_IP_DRIVER *driver_req_ptr) {
     /* Check for received packet.  */
     if (deferred_events & NX_DRIVER_DEFERRED_PACKET_RECEIVED) {
 
-        /* Process received packet(s).  */
-        _nx_driver_hardware_packet_received();
+        /* Top up the refill stash before the descriptors are handed back to the DMA.  */
+        _nx_driver_hardware_rx_refill();
+
+        /* Process up to a budget of received packets.  */
+        received = _nx_driver_hardware_packet_received(NX_DRIVER_RX_BUDGET);
+
+        /* If the budget was used up there may be more work. Re-arm the deferred processing so the IP thread can
+           service its other events in between, otherwise go back to interrupt driven reception.  */
+        if (received >= NX_DRIVER_RX_BUDGET) {
+
+            TX_DISABLE
+            deferred_events                                              = nx_driver_information.nx_driver_information_deferred_events;
+            nx_driver_information.nx_driver_information_deferred_events |= NX_DRIVER_DEFERRED_PACKET_RECEIVED;
+            TX_RESTORE
+
+            if (!deferred_events) {
+                _nx_ip_driver_deferred_processing(nx_driver_information.nx_driver_information_ip_ptr);
+            }
+        } else {
+
+            TX_DISABLE
+            __HAL_ETH_DMA_ENABLE_IT(&eth_handle, ETH_DMACIER_RIE);
+            TX_RESTORE
+        }
+
+        /* The ring has been rebuilt as far as the pools allow, restart reception if it was suspended.  */
+        if (rx_recovery_pending) {
+            _nx_driver_hardware_rx_resume();
+        }
     }
 
     /* Mark request as successful.  */
@@ -1535,6 +1618,16 @@ static UINT _nx_driver_hardware_initialize(NX_IP_DRIVER *driver_req_ptr) {
     /* Clear the number of buffers in use counter.  */
     nx_driver_information.nx_driver_information_multicast_count = 0;
 
+    /* Create the receive recovery retry timer, it is only activated while reception is suspended */
+    if (!rx_recovery_timer_created) {
+        if (tx_timer_create(&rx_recovery_timer, "ETH RX Recovery", _nx_driver_rx_recovery_timer_entry, 0,
+                            MS_TO_TICKS(NX_DRIVER_RX_RECOVERY_INTERVAL), MS_TO_TICKS(NX_DRIVER_RX_RECOVERY_INTERVAL),
+                            TX_NO_ACTIVATE) != TX_SUCCESS) {
+            return (NX_DRIVER_ERROR);
+        }
+        rx_recovery_timer_created = NX_TRUE;
+    }
+
     /* Return success!  */
     return (NX_SUCCESS);
 }
@@ -1637,6 +1730,10 @@ static UINT _nx_driver_hardware_disable(NX_IP_DRIVER *driver_req_ptr) {
 
     HAL_ETH_Stop(&eth_handle);
 
+    /* The next enable rebuilds the receive ring from scratch, so stop retrying the old one */
+    rx_recovery_pending = NX_FALSE;
+    tx_timer_deactivate(&rx_recovery_timer);
+
     /* Return success!  */
     return (NX_SUCCESS);
 }
@@ -1685,34 +1782,38 @@ static UINT _nx_driver_hardware_disable(NX_IP_DRIVER *driver_req_ptr) {
 
 static UINT _nx_driver_hardware_packet_send(NX_PACKET *packet_ptr) {
 
-    NX_PACKET *pktIdx;
-    UINT       buffLen = 0;
-
-    ETH_BufferTypeDef Txbuffer[ETH_TX_DESC_CNT];
-    memset(Txbuffer, 0, ETH_TX_DESC_CNT * sizeof(ETH_BufferTypeDef));
-
-
-    int i = 0;
+    NX_PACKET         *pktIdx;
+    ETH_BufferTypeDef *buffer;
+    ETH_BufferTypeDef *prev_buffer = NX_NULL;
+    UINT               buffLen     = 0;
+    UINT               count       = 0;
+    UINT               index       = eth_handle.TxDescList.CurTxDesc;
+    UINT               len;
 
+    /* Map the packet chain onto the ring starting at the next free descriptor */
     for (pktIdx = packet_ptr; pktIdx != NX_NULL; pktIdx = pktIdx->nx_packet_next) {
-        if (i >= ETH_TX_DESC_CNT) {
+        if (count >= ETH_TX_DESC_CNT) {
             return NX_DRIVER_ERROR;
         }
 
-        Txbuffer[i].buffer  = pktIdx->nx_packet_prepend_ptr;
-        Txbuffer[i].len     = (pktIdx->nx_packet_append_ptr - pktIdx->nx_packet_prepend_ptr);
-        buffLen            += (pktIdx->nx_packet_append_ptr - pktIdx->nx_packet_prepend_ptr);
+        len    = (UINT) (pktIdx->nx_packet_append_ptr - pktIdx->nx_packet_prepend_ptr);
+        buffer = &tx_buffer_ring[index];
 
-        if (i > 0) {
-            Txbuffer[i - 1].next = &Txbuffer[i];
-        }
+        buffer->buffer  = pktIdx->nx_packet_prepend_ptr;
+        buffer->len     = len;
+        buffer->next    = NX_NULL;
+        buffLen        += len;
 
-        if (pktIdx->nx_packet_next == NULL) {
-            Txbuffer[i].next = NULL;
+        if (prev_buffer != NX_NULL) {
+            prev_buffer->next = buffer;
         }
+        prev_buffer = buffer;
+
+        /* Only the bytes the DMA will read need to be written back */
+        clean_cache_by_addr((uint32_t *) pktIdx->nx_packet_prepend_ptr, len);
 
-        i++;
-        clean_cache_by_addr((uint32_t *) (pktIdx->nx_packet_data_start), pktIdx->nx_packet_data_end - pktIdx->nx_packet_data_start);
+        index = (index + 1) % ETH_TX_DESC_CNT;
+        count++;
     }
 
 #ifdef NX_ENABLE_INTERFACE_CAPABILITY
@@ -1729,7 +1830,7 @@ static UINT _nx_driver_hardware_packet_send(NX_PACKET *packet_ptr) {
 #endif /* NX_ENABLE_INTERFACE_CAPABILITY */
 
     TxPacketCfg.Length   = buffLen;
-    TxPacketCfg.TxBuffer = Txbuffer;
+    TxPacketCfg.TxBuffer = &tx_buffer_ring[eth_handle.TxDescList.CurTxDesc];
     TxPacketCfg.pData    = (uint32_t *) packet_ptr;
 
     if (HAL_ETH_Transmit_IT(&eth_handle, &TxPacketCfg)) {
@@ -1920,24 +2021,85 @@ void HAL_ETH_TxFreeCallback(uint32_t *buff) {
     nx_packet_transmit_release(release_packet);
 }
 
-static VOID _nx_driver_hardware_packet_received(VOID) {
+static UINT _nx_driver_hardware_packet_received(UINT budget) {
     NX_PACKET *received_packet_ptr;
+    UINT       received = 0;
 
-    while (HAL_ETH_ReadData(&eth_handle, (void **) &received_packet_ptr) == HAL_OK) {
+    while ((received < budget) && (HAL_ETH_ReadData(&eth_handle, (void **) &received_packet_ptr) == HAL_OK)) {
         /* Transfer the packet to NetX.  */
         _nx_driver_transfer_to_netx(nx_driver_information.nx_driver_information_ip_ptr, received_packet_ptr);
+        received++;
+    }
+
+    return received;
+}
+
+/* Count the receive descriptors that will need a new buffer when HAL_ETH_ReadData() next rebuilds the ring. These are the
+ * descriptors still waiting from earlier, plus every descriptor the DMA has handed back with a frame in it */
+static UINT _nx_driver_hardware_rx_descriptors_pending(VOID) {
+    ETH_DMADescTypeDef *dma_rx_desc;
+    UINT                pending = eth_handle.RxDescList.RxBuildDescCnt;
+    UINT                index   = eth_handle.RxDescList.RxDescIdx;
+
+    while (pending < ETH_RX_DESC_CNT) {
+        dma_rx_desc = (ETH_DMADescTypeDef *) eth_handle.RxDescList.RxDesc[index];
+        if (READ_BIT(dma_rx_desc->DESC3, ETH_DMARXNDESCWBF_OWN) != 0U) break;
+        pending++;
+        index = (index + 1U) % ETH_RX_DESC_CNT;
+    }
+
+    return pending;
+}
+
+static VOID _nx_driver_hardware_rx_refill(VOID) {
+    NX_PACKET *packet_ptr;
+    UINT       needed = _nx_driver_hardware_rx_descriptors_pending();
+
+    /* Only the IP thread adds to the stash and HAL_ETH_ReadData() is only called from the IP thread, so no locking is needed.
+     * The recovery reserve is topped up first */
+    while ((rx_reserve_count < NX_DRIVER_RX_RESERVE) || (rx_refill_count < needed)) {
+        if (nx_packet_allocate(nx_driver_information.nx_driver_information_packet_pool_ptr, &packet_ptr,
+                               NX_RECEIVE_PACKET, NX_NO_WAIT) != NX_SUCCESS) {
+            break;
+        }
+
+        /* Adjust the packet.  */
+        packet_ptr->nx_packet_prepend_ptr += 2;
+        invalidate_cache_by_addr((uint32_t *) packet_ptr->nx_packet_data_start, packet_ptr->nx_packet_data_end - packet_ptr->nx_packet_data_start);
+
+        if (rx_reserve_count < NX_DRIVER_RX_RESERVE) {
+            rx_reserve[rx_reserve_count++] = packet_ptr;
+        } else {
+            rx_refill_stash[rx_refill_count++] = packet_ptr;
+        }
     }
 }
 
 void HAL_ETH_RxAllocateCallback(uint8_t **buff) {
     NX_PACKET *packet_ptr;
-    if (nx_packet_allocate(nx_driver_information.nx_driver_information_packet_pool_ptr, &packet_ptr,
-                           NX_RECEIVE_PACKET, NX_NO_WAIT) == NX_SUCCESS) {
+
+    /* Take a pre-allocated packet if there is one */
+    if (rx_refill_count > 0) {
+        packet_ptr = rx_refill_stash[--rx_refill_count];
+        *buff      = packet_ptr->nx_packet_prepend_ptr;
+    }
+
+    /* Otherwise allocate directly (e.g. when HAL_ETH_Start_IT() builds the ring) */
+    else if (nx_packet_allocate(nx_driver_information.nx_driver_information_packet_pool_ptr, &packet_ptr,
+                                NX_RECEIVE_PACKET, NX_NO_WAIT) == NX_SUCCESS) {
         /* Adjust the packet.  */
         packet_ptr->nx_packet_prepend_ptr += 2;
         invalidate_cache_by_addr((uint32_t *) packet_ptr->nx_packet_data_start, packet_ptr->nx_packet_data_end - packet_ptr->nx_packet_data_start);
         *buff = packet_ptr->nx_packet_prepend_ptr;
-    } else {
+    }
+
+    /* Last resort, the pool is exhausted so dip into the recovery reserve */
+    else if (rx_reserve_count > 0) {
+        packet_ptr = rx_reserve[--rx_reserve_count];
+        *buff      = packet_ptr->nx_packet_prepend_ptr;
+    }
+
+    else {
         /* Rx Buffer Pool is exhausted. */
         *buff = NULL;
     }
@@ -2052,6 +2214,10 @@ void HAL_ETH_RxCpltCallback(ETH_HandleTypeDef *heth) {
     ULONG deffered_events;
     deffered_events = nx_driver_information.nx_driver_information_deferred_events;
 
+    /* Stop receive interrupts until the deferred processing has emptied the ring. They are re-enabled in
+     * _nx_driver_deferred_processing(), and a frame that arrives in the meantime leaves RI pending so it isn't missed */
+    __HAL_ETH_DMA_DISABLE_IT(heth, ETH_DMACIER_RIE);
+
     nx_driver_information.nx_driver_information_deferred_events |= NX_DRIVER_DEFERRED_PACKET_RECEIVED;
 
     if (!deffered_events) {
@@ -2075,14 +2241,239 @@ void HAL_ETH_TxCpltCallback(ETH_HandleTypeDef *heth) {
 
 void HAL_ETH_ErrorCallback(ETH_HandleTypeDef *heth) {
 
-    // TODO: VERY IMPORTANT
+    ULONG deffered_events;
+    ULONG dma_error;
+
+    /* The HAL only sets MACErrorCode for the duration of a MAC error callback, otherwise this is a DMA error */
+    if (heth->MACErrorCode != 0) {
+        error_counters.nx_driver_error_mac++;
+        mac_error_pending = NX_TRUE;
+    } else {
+        dma_error          = heth->DMAErrorCode;
+        heth->DMAErrorCode = 0;
+
+        if (dma_error & ETH_DMACSR_RBU) error_counters.nx_driver_error_rx_buffer_unavailable++;
+        if (dma_error & ETH_DMACSR_RWT) error_counters.nx_driver_error_rx_watchdog_timeout++;
+        if (dma_error & ETH_DMACSR_ETI) error_counters.nx_driver_error_early_transmit++;
+        if (dma_error & ETH_DMACSR_CDE) error_counters.nx_driver_error_context_descriptor++;
+        if (dma_error & ETH_DMACSR_FBE) error_counters.nx_driver_error_fatal_bus++;
+
+        dma_error_pending |= dma_error;
+    }
+
+    /* Leave the recovery to the IP thread */
+    deffered_events = nx_driver_information.nx_driver_information_deferred_events;
+
+    nx_driver_information.nx_driver_information_deferred_events |= NX_DRIVER_DEFERRED_DMA_ERROR;
+
+    if (!deffered_events) {
+        /* Call NetX deferred driver processing.  */
+        _nx_ip_driver_deferred_processing(nx_driver_information.nx_driver_information_ip_ptr);
+    }
+}
+
+
+/* Work out what an error has stopped and restart it. Called from the IP thread */
+static VOID _nx_driver_hardware_error_recover(VOID) {
 
-    /* Clear the Receive Buffer Unavailable fault */
-    //    if (heth->DMAErrorCode & ETH_DMACSR_RBU) {
-    //        CLEAR_BIT(heth->DMAErrorCode, (ETH_DMACSR_RBU | ETH_DMACSR_AIS));
-    //    }
+    TX_INTERRUPT_SAVE_AREA
+
+    ULONG dma_errors;
+    UINT  mac_error;
+
+    TX_DISABLE
+    dma_errors        = dma_error_pending;
+    dma_error_pending = 0;
+    mac_error         = mac_error_pending;
+    mac_error_pending = NX_FALSE;
+    TX_RESTORE
 
-    //    Error_Handler();
+    /* Nothing to restart if the link isn't up, the next enable starts the hardware from scratch */
+    if (nx_driver_information.nx_driver_information_state != NX_DRIVER_STATE_LINK_ENABLED) {
+        return;
+    }
+
+    /* A fatal bus error stops the DMA in both directions and the HAL masks every ETH interrupt */
+    if (dma_errors & ETH_DMACSR_FBE) {
+        if (_nx_driver_hardware_restart() == NX_SUCCESS) {
+            error_counters.nx_driver_error_recoveries++;
+        } else {
+            error_counters.nx_driver_error_recovery_failures++;
+        }
+        return;
+    }
+
+    /* MAC status errors (watchdog, jabber) don't stop the MAC or DMA, but the HAL marks the handle as failed which stops
+     * HAL_ETH_ReadData() and HAL_ETH_Transmit_IT() from working */
+    if (mac_error && (eth_handle.gState == HAL_ETH_STATE_ERROR)) {
+        eth_handle.gState = HAL_ETH_STATE_STARTED;
+        error_counters.nx_driver_error_recoveries++;
+    }
+
+    /* The receive DMA is suspended until descriptors are available again. Rebuild the ring in the receive processing,
+     * retrying from the timer until the pool has packets to give */
+    if (dma_errors & ETH_DMACSR_RBU) {
+        rx_recovery_pending = NX_TRUE;
+        tx_timer_activate(&rx_recovery_timer);
+    }
+
+    /* RWT, ETI and CDE only affect a single frame so are just counted */
+}
+
+
+/* Restart the MAC and DMA in place after a fatal error without tearing down the link or the IP instance */
+static UINT _nx_driver_hardware_restart(VOID) {
+    NX_PACKET *packet_ptr;
+
+    /* HAL_ETH_Stop_IT() only accepts a started handle, but a fatal error leaves it in the error state */
+    eth_handle.gState = HAL_ETH_STATE_STARTED;
+    if (HAL_ETH_Stop_IT(&eth_handle) != HAL_OK) {
+        return NX_DRIVER_ERROR;
+    }
+
+    /* Drop any partially received frame, its descriptors no longer own the buffers */
+    if (eth_handle.RxDescList.pRxStart != NULL) {
+        packet_ptr = (NX_PACKET *) eth_handle.RxDescList.pRxStart;
+        nx_packet_release(packet_ptr);
+        eth_handle.RxDescList.pRxStart = NULL;
+        eth_handle.RxDescList.pRxEnd   = NULL;
+    }
+
+    /* Where the DMA stopped in each ring is unknown after a bus error, so start both from scratch */
+    _nx_driver_hardware_rings_reset();
+
+    /* The HAL doesn't clear the fatal error flags, they would fire again as soon as interrupts are enabled */
+    __HAL_ETH_DMA_CLEAR_IT(&eth_handle, ETH_DMACSR_FBE | ETH_DMACSR_AIS);
+    eth_handle.ErrorCode = HAL_ETH_ERROR_NONE;
+
+    /* Top up the buffers so HAL_ETH_Start_IT() can rebuild every descriptor, then restart */
+    _nx_driver_hardware_rx_refill();
+    if (HAL_ETH_Start_IT(&eth_handle) != HAL_OK) {
+        return NX_DRIVER_ERROR;
+    }
+
+    rx_recovery_pending = NX_FALSE;
+    tx_timer_deactivate(&rx_recovery_timer);
+
+    return NX_SUCCESS;
+}
+
+
+/* Put both descriptor rings back in the state HAL_ETH_Init() leaves them in, returning every packet they hold. Transmit
+ * packets still in the ring will never complete. The DMA must be stopped */
+static VOID _nx_driver_hardware_rings_reset(VOID) {
+    ETH_DMADescTypeDef *dma_desc;
+    NX_PACKET          *packet_ptr;
+
+    for (UINT i = 0; i < ETH_TX_DESC_CNT; i++) {
+        if (eth_handle.TxDescList.PacketAddress[i] != NULL) {
+            HAL_ETH_TxFreeCallback(eth_handle.TxDescList.PacketAddress[i]);
+            eth_handle.TxDescList.PacketAddress[i] = NULL;
+        }
+        dma_desc = (ETH_DMADescTypeDef *) eth_handle.TxDescList.TxDesc[i];
+        WRITE_REG(dma_desc->DESC0, 0U);
+        WRITE_REG(dma_desc->DESC1, 0U);
+        WRITE_REG(dma_desc->DESC2, 0U);
+        WRITE_REG(dma_desc->DESC3, 0U);
+    }
+    eth_handle.TxDescList.CurTxDesc    = 0;
+    eth_handle.TxDescList.BuffersInUse = 0;
+    eth_handle.TxDescList.releaseIndex = 0;
+
+    for (UINT i = 0; i < ETH_RX_DESC_CNT; i++) {
+        dma_desc = (ETH_DMADescTypeDef *) eth_handle.RxDescList.RxDesc[i];
+        if (dma_desc->BackupAddr0 != 0U) {
+            packet_ptr = (NX_PACKET *) ((uint8_t *) dma_desc->BackupAddr0 - 2U - header_size);
+            nx_packet_release(packet_ptr);
+        }
+        WRITE_REG(dma_desc->DESC0, 0U);
+        WRITE_REG(dma_desc->DESC1, 0U);
+        WRITE_REG(dma_desc->DESC2, 0U);
+        WRITE_REG(dma_desc->DESC3, 0U);
+        WRITE_REG(dma_desc->BackupAddr0, 0U);
+        WRITE_REG(dma_desc->BackupAddr1, 0U);
+    }
+    eth_handle.RxDescList.RxDescIdx      = 0;
+    eth_handle.RxDescList.RxDescCnt      = 0;
+    eth_handle.RxDescList.RxBuildDescIdx = 0;
+    eth_handle.RxDescList.RxBuildDescCnt = 0;
+    eth_handle.RxDescList.RxDataLength   = 0;
+
+    /* Writing the list addresses while the DMA is stopped also resets its current descriptor pointers */
+    __DMB();
+    WRITE_REG(eth_handle.Instance->DMACTDRLR, ETH_TX_DESC_CNT - 1U);
+    WRITE_REG(eth_handle.Instance->DMACTDLAR, (uint32_t) eth_handle.Init.TxDesc);
+    WRITE_REG(eth_handle.Instance->DMACTDTPR, (uint32_t) eth_handle.Init.TxDesc);
+    WRITE_REG(eth_handle.Instance->DMACRDRLR, ETH_RX_DESC_CNT - 1U);
+    WRITE_REG(eth_handle.Instance->DMACRDLAR, (uint32_t) eth_handle.Init.RxDesc);
+    WRITE_REG(eth_handle.Instance->DMACRDTPR, (uint32_t) (eth_handle.Init.RxDesc + (ETH_RX_DESC_CNT - 1U)));
+}
+
+
+/* Raise a receive event so the IP thread tries to rebuild the receive ring again */
+static VOID _nx_driver_rx_recovery_timer_entry(ULONG id) {
+
+    TX_INTERRUPT_SAVE_AREA
+
+    ULONG deffered_events;
+
+    NX_PARAMETER_NOT_USED(id);
+
+    TX_DISABLE
+    deffered_events = nx_driver_information.nx_driver_information_deferred_events;
+    nx_driver_information.nx_driver_information_deferred_events |= NX_DRIVER_DEFERRED_PACKET_RECEIVED;
+    TX_RESTORE
+
+    if (!deffered_events) {
+        /* Call NetX deferred driver processing.  */
+        _nx_ip_driver_deferred_processing(nx_driver_information.nx_driver_information_ip_ptr);
+    }
+}
+
+
+/* Resume the receive DMA after a Receive Buffer Unavailable fault. Called once HAL_ETH_ReadData() has rebuilt the ring */
+static VOID _nx_driver_hardware_rx_resume(VOID) {
+
+    /* If no descriptor could be given a buffer the pools are still empty, the recovery timer tries again */
+    if (eth_handle.RxDescList.RxBuildDescCnt >= ETH_RX_DESC_CNT) {
+        error_counters.nx_driver_error_recovery_failures++;
+        return;
+    }
+
+    /* Rebuilding the descriptors wrote the tail pointer, which is what makes the suspended DMA poll the ring again */
+    rx_recovery_pending = NX_FALSE;
+    tx_timer_deactivate(&rx_recovery_timer);
+    error_counters.nx_driver_error_recoveries++;
+}
+
+
+/* Use a dedicated packet pool for received packets. This must be called before the IP instance is created */
+UINT nx_stm32_eth_driver_rx_pool_set(NX_PACKET_POOL *pool_ptr) {
+
+    if (pool_ptr == NX_NULL) {
+        return NX_PTR_ERROR;
+    }
+
+    rx_packet_pool_ptr = pool_ptr;
+
+    return NX_SUCCESS;
+}
+
+
+/* Copy out the driver's error counters */
+UINT nx_stm32_eth_driver_error_counters_get(NX_DRIVER_ERROR_COUNTERS *counters_ptr) {
+
+    TX_INTERRUPT_SAVE_AREA
+
+    if (counters_ptr == NX_NULL) {
+        return NX_PTR_ERROR;
+    }
+
+    TX_DISABLE
+    *counters_ptr = error_counters;
+    TX_RESTORE
+
+    return NX_SUCCESS;
 }
 
 /****** DRIVER SPECIFIC ****** Start of part/vendor specific internal driver functions.  */
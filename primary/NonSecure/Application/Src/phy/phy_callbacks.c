@@ -6,6 +6,7 @@
  */
 
 #include "stdint.h"
+#include "string.h"
 #include "hal.h"
 #include "tx_api.h"
 #include "main.h"
@@ -14,27 +15,39 @@
 #include "lan867x.h"
 #include "phy_callbacks.h"
 #include "phy_thread.h"
-#include "stp_thread.h"
 #include "utils.h"
 #include "tx_app.h"
-#include "phy_platform.h"
+#include "phy_mdio.h"
 
 
 TX_MUTEX             phy_mutex_handle;
 TX_EVENT_FLAGS_GROUP phy_events_handle;
 
+/* Link state as last reported by the PHY drivers, for diagnostics */
+bool     phy_link_up[NUM_PHYS];
+uint32_t phy_link_changes[NUM_PHYS];
+
+/* Threads that want to hear about link changes */
+typedef struct {
+    TX_EVENT_FLAGS_GROUP *events;
+    ULONG                 flags[NUM_PHYS];
+} phy_link_subscriber_t;
+
+static phy_link_subscriber_t phy_link_subscribers[PHY_LINK_MAX_SUBSCRIBERS];
+static uint32_t              phy_link_subscriber_count = 0;
+
 
 static phy_status_t phy_88q2112_callback_read_reg(uint8_t phy_addr, uint8_t mmd_addr, uint16_t reg_addr, uint16_t *data, uint32_t timeout, void *context) {
 
     /* 88Q2112 only needs 1 preamble bit */
     /* Set the clock frequency to 9.62MHz (PHY supports up to 12.5MHz) */
-    return phy_read_reg_c45(phy_addr, mmd_addr, reg_addr, data, timeout, true, ETH_MACMDIOAR_CR_DIV26);
+    return phy_mdio_read_c45(phy_addr, mmd_addr, reg_addr, data, timeout, true, ETH_MACMDIOAR_CR_DIV26);
 }
 
 static phy_status_t phy_lan8671_callback_read_reg(uint8_t phy_addr, uint16_t reg_addr, uint16_t *data, uint32_t timeout, void *context) {
 
     /* Set the clock frequency to 2.45MHz (PHY supports up to 4MHz) */
-    return phy_read_reg_c22(phy_addr, reg_addr, data, timeout, ETH_MACMDIOAR_CR_DIV102);
+    return phy_mdio_read_c22(phy_addr, reg_addr, data, timeout, ETH_MACMDIOAR_CR_DIV102);
 }
 
 
@@ -42,13 +55,13 @@ static phy_status_t phy_88q2112_callback_write_reg(uint8_t phy_addr, uint8_t mmd
 
     /* 88Q2112 only needs 1 preamble bit */
     /* Set the clock frequency to 9.62MHz (PHY supports up to 12.5MHz) */
-    return phy_write_reg_c45(phy_addr, mmd_addr, reg_addr, data, timeout, true, ETH_MACMDIOAR_CR_DIV26);
+    return phy_mdio_write_c45(phy_addr, mmd_addr, reg_addr, data, timeout, true, ETH_MACMDIOAR_CR_DIV26);
 }
 
 static phy_status_t phy_lan8671_callback_write_reg(uint8_t phy_addr, uint16_t reg_addr, uint16_t data, uint32_t timeout, void *context) {
 
     /* Set the clock frequency to 2.45MHz (PHY supports up to 4MHz) */
-    return phy_write_reg_c22(phy_addr, reg_addr, data, timeout, ETH_MACMDIOAR_CR_DIV102);
+    return phy_mdio_write_c22(phy_addr, reg_addr, data, timeout, ETH_MACMDIOAR_CR_DIV102);
 }
 
 
@@ -115,39 +128,63 @@ static phy_status_t phy_callback_give_mutex(void *context) {
     return status;
 }
 
+/* Register for link change notifications. flags[i] is set in events whenever PHY i reports its link going up or down
+ * (0 to ignore that PHY). Subscribers read the new state from phy_link_up */
+void phy_link_subscribe(TX_EVENT_FLAGS_GROUP *events, const ULONG flags[NUM_PHYS]) {
+
+    TX_INTERRUPT_SAVE_AREA
+
+    TX_DISABLE
+    if (phy_link_subscriber_count >= PHY_LINK_MAX_SUBSCRIBERS) Error_Handler();
+    phy_link_subscribers[phy_link_subscriber_count].events = events;
+    memcpy(phy_link_subscribers[phy_link_subscriber_count].flags, flags, sizeof(phy_link_subscribers[0].flags));
+    phy_link_subscriber_count++;
+    TX_RESTORE
+}
+
+
+/* Record a link change of PHY index and notify the subscribers. Called from the driver event callback, and by the PHY
+ * thread for PHYs without interrupts when polling finds the link has changed */
+phy_status_t phy_link_report(uint32_t index, bool link_up) {
+
+    phy_status_t status = PHY_OK;
+
+    if (index >= NUM_PHYS) return PHY_ERROR;
+
+    phy_link_up[index] = link_up;
+    phy_link_changes[index]++;
+
+    /* Don't send notifications if the kernel hasn't started */
+    if (tx_thread_identify() == TX_NULL) return status;
+
+    /* Notify every subscriber */
+    for (uint32_t i = 0; i < phy_link_subscriber_count; i++) {
+        if (phy_link_subscribers[i].flags[index] == 0) continue;
+        if (tx_event_flags_set(phy_link_subscribers[i].events, phy_link_subscribers[i].flags[index], TX_OR) != TX_SUCCESS) {
+            status = PHY_ERROR;
+        }
+    }
+
+    return status;
+}
+
+
 static phy_status_t phy_callback_event(phy_event_t event, void *context) {
 
     phy_status_t status = PHY_OK;
+    uint32_t     index;
 
     switch (event) {
         case PHY_EVENT_LINK_UP:
         case PHY_EVENT_LINK_DOWN:
 
-/* Notify the STP thread */
-#if ENABLE_STP_THREAD == true
-
-            /* Don't send notification if the kernel hasn't started */
-            if (tx_thread_identify() == TX_NULL) return PHY_OK;
-
-            tx_status_t tx_status = TX_SUCCESS;
-
-            if (context == &hphy0) {
-                tx_status = tx_event_flags_set(&stp_events_handle, STP_PORT0_LINK_STATE_CHANGE_EVENT, TX_OR);
-            } else if (context == &hphy1) {
-                tx_status = tx_event_flags_set(&stp_events_handle, STP_PORT1_LINK_STATE_CHANGE_EVENT, TX_OR);
-            } else if (context == &hphy2) {
-                tx_status = tx_event_flags_set(&stp_events_handle, STP_PORT2_LINK_STATE_CHANGE_EVENT, TX_OR);
-            } else if (context == &hphy3) {
-                tx_status = tx_event_flags_set(&stp_events_handle, STP_PORT3_LINK_STATE_CHANGE_EVENT, TX_OR);
-            }
-            /* Return the tx_status */
-            if (tx_status != TX_SUCCESS) {
-                status = PHY_ERROR;
-            } else {
-                status = PHY_OK;
+            /* Work out which PHY this is */
+            for (index = 0; index < NUM_PHYS; index++) {
+                if (context == phy_handles[index]) break;
             }
-#endif
+            if (index >= NUM_PHYS) return PHY_ERROR;
 
+            status = phy_link_report(index, event == PHY_EVENT_LINK_UP);
             break;
 
         default:
@@ -181,6 +218,7 @@ const phy_callbacks_t phy_callbacks_lan8671 = {
     .callback_delay_ns      = &phy_callback_delay_ns,
     .callback_take_mutex    = &phy_callback_take_mutex,
     .callback_give_mutex    = &phy_callback_give_mutex,
+    .callback_event         = &phy_callback_event,
     .callback_write_log     = &log_write,
 };
 
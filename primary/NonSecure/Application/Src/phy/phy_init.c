@@ -10,6 +10,7 @@
 
 #include "phy_thread.h"
 #include "phy_callbacks.h"
+#include "phy_mdio.h"
 #include "config.h"
 #include "utils.h"
 
@@ -82,6 +83,7 @@ phy_status_t phys_init() {
     tx_thread_sleep_ms(10); /* 10ms required by 88Q2112 */
     HAL_GPIO_WritePin(PHY_RST_GPIO_Port, PHY_RST_Pin, SET);
     tx_thread_sleep_ms(10);
+    phy_mdio_invalidate();
 
     /* Initialise all PHYs */
     status = PHY_Init(&hphy0, &phy_config_0, &phy_callbacks_88q2112, &hphy0);
@@ -116,3 +118,21 @@ phy_status_t phys_init() {
 
     return status;
 }
+
+
+/* Re-initialise one of the 88Q2112s (index 0-2) to undo the undocumented register changes made by a cable test */
+phy_status_t phy_88q211x_reinit(uint32_t index) {
+
+    static phy_config_88q211x_t * const configs[] = {&phy_config_0, &phy_config_1, &phy_config_2};
+
+    phy_status_t          status = PHY_OK;
+    phy_handle_88q211x_t *dev    = phy_handles[index];
+
+    status = PHY_Init(dev, configs[index], &phy_callbacks_88q2112, dev);
+    if (status != PHY_OK) return status;
+
+    status = PHY_88Q211X_EnableInterrupts(dev);
+    if (status != PHY_OK) return status;
+
+    return PHY_88Q211X_EnableTemperatureSensor(dev);
+}
@@ -0,0 +1,186 @@
+/*
+ * phy_mdio.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "hal.h"
+#include "tx_api.h"
+#include "main.h"
+
+#include "phy_mdio.h"
+#include "config.h"
+#include "utils.h"
+
+
+/* MDIO access through the ETH MAC's station management agent. Accesses are made with the PHY mutex held (the PHY
+ * drivers take it around every operation), so only one operation is ever in flight.
+ *
+ * - A clause 45 operation is normally an address frame followed by the data frame. Each MMD keeps its address
+ *   register until it is written again, so when the PHY's address register already points at the register being
+ *   accessed the address frame is skipped (SKAP). Only the last MMD and register read on each PHY is tracked, so this
+ *   only helps when the same register is read twice in a row, e.g. waiting on a status bit. Polls that move between
+ *   registers still send every address frame, as does a read after a write since writes clear the tracking.
+ * - Writes are posted: the frame is started and the caller carries on. The next operation waits for it to finish.
+ * - Waiting spins briefly (a frame is a few us) and then sleeps a tick at a time so long waits don't hold up other
+ *   threads. Relinquishing instead would spin at full load when no other thread of the same priority is ready. */
+
+
+#define PHY_MDIO_NUM_ADDRS       (32)
+#define PHY_MDIO_NOT_LATCHED     (0)
+#define PHY_MDIO_LATCH(mmd, reg) ((1UL << 31) | (((uint32_t) (mmd)) << 16) | (reg)) /* Never PHY_MDIO_NOT_LATCHED */
+
+
+phy_mdio_stats_t phy_mdio_stats;
+
+static uint32_t phy_mdio_latched[PHY_MDIO_NUM_ADDRS]; /* Last clause 45 MMD and register addressed on each PHY */
+
+
+/* Forget all latched addresses. Must be called after the PHYs are hardware reset */
+void phy_mdio_invalidate(void) {
+    for (uint32_t i = 0; i < PHY_MDIO_NUM_ADDRS; i++) {
+        phy_mdio_latched[i] = PHY_MDIO_NOT_LATCHED;
+    }
+}
+
+
+/* Wait for the previous operation to finish */
+static phy_status_t phy_mdio_wait(uint32_t timeout) {
+
+    uint32_t start_time   = HAL_GetTick();
+    uint32_t start_cycles = DWT->CYCCNT;
+
+    while (ETH->MACMDIOAR & ETH_MACMDIOAR_MB) {
+
+        if ((HAL_GetTick() - start_time) > timeout) {
+            phy_mdio_stats.timeouts++;
+            phy_mdio_invalidate();
+            return PHY_BUSY;
+        }
+
+        /* Only sleep once the kernel is running and the wait is longer than a context switch */
+        if (((DWT->CYCCNT - start_cycles) > (PHY_MDIO_SPIN_US * CYCLES_PER_US)) && (tx_thread_identify() != TX_NULL)) {
+            phy_mdio_stats.sleeps++;
+            tx_thread_sleep(1);
+        }
+    }
+
+    return PHY_OK;
+}
+
+
+static void phy_mdio_start(uint32_t mdioar, uint32_t mdiodr) {
+    phy_mdio_stats.frames++;
+    ETH->MACMDIODR = mdiodr;
+    ETH->MACMDIOAR = mdioar | ETH_MACMDIOAR_MB;
+}
+
+
+/* Common clause 45 setup. Returns the MACMDIOAR value for the operation */
+static uint32_t phy_mdio_c45_setup(uint8_t phy_addr, uint8_t mmd_addr, uint16_t reg_addr, bool preamble_suppression, uint32_t clock_range) {
+
+    uint32_t mdioar = (((uint32_t) phy_addr << ETH_MACMDIOAR_PA_Pos) & ETH_MACMDIOAR_PA) |
+                      (((uint32_t) mmd_addr << ETH_MACMDIOAR_RDA_Pos) & ETH_MACMDIOAR_RDA) |
+                      (clock_range & ETH_MACMDIOAR_CR) |
+                      ETH_MACMDIOAR_C45E;
+
+    if (preamble_suppression) mdioar |= ETH_MACMDIOAR_PSE;
+
+    /* The PHY already has this address latched */
+    if (phy_mdio_latched[phy_addr & (PHY_MDIO_NUM_ADDRS - 1)] == PHY_MDIO_LATCH(mmd_addr, reg_addr)) {
+        mdioar |= ETH_MACMDIOAR_SKAP;
+        phy_mdio_stats.address_frames_skipped++;
+    }
+
+    return mdioar;
+}
+
+
+phy_status_t phy_mdio_read_c45(uint8_t phy_addr, uint8_t mmd_addr, uint16_t reg_addr, uint16_t *data, uint32_t timeout, bool preamble_suppression, uint32_t clock_range) {
+
+    phy_status_t status = PHY_OK;
+    uint32_t     mdioar;
+
+    status = phy_mdio_wait(timeout);
+    if (status != PHY_OK) return status;
+
+    mdioar = phy_mdio_c45_setup(phy_addr, mmd_addr, reg_addr, preamble_suppression, clock_range) | ETH_MACMDIOAR_MOC_RD;
+    phy_mdio_start(mdioar, (uint32_t) reg_addr << ETH_MACMDIODR_RA_Pos);
+
+    status = phy_mdio_wait(timeout);
+    if (status != PHY_OK) return status;
+
+    *data = (uint16_t) (ETH->MACMDIODR & ETH_MACMDIODR_MD);
+
+    /* A plain read leaves the MMD's address register where it was */
+    phy_mdio_latched[phy_addr & (PHY_MDIO_NUM_ADDRS - 1)] = PHY_MDIO_LATCH(mmd_addr, reg_addr);
+
+    return status;
+}
+
+
+phy_status_t phy_mdio_write_c45(uint8_t phy_addr, uint8_t mmd_addr, uint16_t reg_addr, uint16_t data, uint32_t timeout, bool preamble_suppression, uint32_t clock_range) {
+
+    phy_status_t status = PHY_OK;
+    uint32_t     mdioar;
+
+    status = phy_mdio_wait(timeout);
+    if (status != PHY_OK) return status;
+
+    mdioar = phy_mdio_c45_setup(phy_addr, mmd_addr, reg_addr, preamble_suppression, clock_range) | ETH_MACMDIOAR_MOC_WR;
+    phy_mdio_start(mdioar, ((uint32_t) reg_addr << ETH_MACMDIODR_RA_Pos) | data);
+    phy_mdio_stats.posted_writes++;
+
+    /* The write could be a soft reset, which clears the address registers */
+    phy_mdio_latched[phy_addr & (PHY_MDIO_NUM_ADDRS - 1)] = PHY_MDIO_NOT_LATCHED;
+
+    return status;
+}
+
+
+phy_status_t phy_mdio_read_c22(uint8_t phy_addr, uint16_t reg_addr, uint16_t *data, uint32_t timeout, uint32_t clock_range) {
+
+    phy_status_t status = PHY_OK;
+    uint32_t     mdioar;
+
+    status = phy_mdio_wait(timeout);
+    if (status != PHY_OK) return status;
+
+    mdioar = (((uint32_t) phy_addr << ETH_MACMDIOAR_PA_Pos) & ETH_MACMDIOAR_PA) |
+             (((uint32_t) reg_addr << ETH_MACMDIOAR_RDA_Pos) & ETH_MACMDIOAR_RDA) |
+             (clock_range & ETH_MACMDIOAR_CR) |
+             ETH_MACMDIOAR_MOC_RD;
+    phy_mdio_start(mdioar, 0);
+
+    status = phy_mdio_wait(timeout);
+    if (status != PHY_OK) return status;
+
+    *data = (uint16_t) (ETH->MACMDIODR & ETH_MACMDIODR_MD);
+
+    return status;
+}
+
+
+phy_status_t phy_mdio_write_c22(uint8_t phy_addr, uint16_t reg_addr, uint16_t data, uint32_t timeout, uint32_t clock_range) {
+
+    phy_status_t status = PHY_OK;
+    uint32_t     mdioar;
+
+    status = phy_mdio_wait(timeout);
+    if (status != PHY_OK) return status;
+
+    mdioar = (((uint32_t) phy_addr << ETH_MACMDIOAR_PA_Pos) & ETH_MACMDIOAR_PA) |
+             (((uint32_t) reg_addr << ETH_MACMDIOAR_RDA_Pos) & ETH_MACMDIOAR_RDA) |
+             (clock_range & ETH_MACMDIOAR_CR) |
+             ETH_MACMDIOAR_MOC_WR;
+    phy_mdio_start(mdioar, data);
+    phy_mdio_stats.posted_writes++;
+
+    /* Clause 22 writes can reach the MMD address registers (registers 13 and 14) or reset the PHY */
+    phy_mdio_latched[phy_addr & (PHY_MDIO_NUM_ADDRS - 1)] = PHY_MDIO_NOT_LATCHED;
+
+    return status;
+}
@@ -14,6 +14,7 @@
 #include "phy_thread.h"
 #include "phy_callbacks.h"
 #include "utils.h"
+#include "scheduler.h"
 #include "config.h"
 #include "tx_app.h"
 
@@ -21,21 +22,201 @@
 uint8_t   phy_thread_stack[PHY_THREAD_STACK_SIZE];
 TX_THREAD phy_thread_handle;
 
-float phy_temperatures[NUM_PHYS];
-bool  phy_temperatures_valid[NUM_PHYS];
+float              phy_temperatures[NUM_PHYS];
+bool               phy_temperatures_valid[NUM_PHYS];
+phy_cable_result_t phy_cable_results[NUM_PHYS];
 
+/* Cable test state. Only one PHY is tested at a time */
+#define PHY_CABLE_TEST_NONE (UINT32_MAX)
+
+static uint32_t phy_cable_test_index = PHY_CABLE_TEST_NONE;
+static uint32_t phy_cable_test_start;
+static uint32_t phy_cable_test_next  = 0;              /* Round robin so one faulty port can't starve the others */
+static uint32_t phy_link_down_since[NUM_PHYS];         /* Time of the last link change, updated from the link events */
+
+/* Interrupt lines and events of the 88Q2112s */
+static GPIO_TypeDef * const phy_int_ports[PHY_NUM_88Q211X] = {PHY0_INT_GPIO_Port, PHY1_INT_GPIO_Port, PHY2_INT_GPIO_Port};
+static const uint16_t       phy_int_pins[PHY_NUM_88Q211X]  = {PHY0_INT_Pin, PHY1_INT_Pin, PHY2_INT_Pin};
+static const ULONG          phy_int_flags[PHY_NUM_88Q211X] = {PHY_PHY0_EVENT, PHY_PHY1_EVENT, PHY_PHY2_EVENT};
+static const ULONG          phy_link_flags[NUM_PHYS]       = {PHY_PHY0_LINK_EVENT, PHY_PHY1_LINK_EVENT, PHY_PHY2_LINK_EVENT, PHY_PHY3_LINK_EVENT};
+
+
+/* The cable results are read by other threads so they are copied with interrupts disabled */
+void phy_cable_result_get(uint32_t index, phy_cable_result_t *result) {
+    TX_INTERRUPT_SAVE_AREA
+    TX_DISABLE
+    *result = phy_cable_results[index];
+    TX_RESTORE
+}
+
+
+static void phy_cable_result_set(uint32_t index, const phy_cable_result_t *result) {
+    TX_INTERRUPT_SAVE_AREA
+    TX_DISABLE
+    phy_cable_results[index] = *result;
+    TX_RESTORE
+}
+
+
+/* Periodic jobs. Link changes are handled from PHY interrupts, so link polling is only a slow watchdog in case an
+ * interrupt is missed. The LAN8671 has no interrupt so it is polled quickly instead. Each PHY is handled by its own job
+ * and the jobs are phase spread so MDIO accesses are interleaved with interrupt handling rather than done in one burst.
+ * arg is the PHY index */
+static void phy_temperature_job(void *arg);
+static void phy_link_poll_job(void *arg);
+static void phy_lan8671_link_poll_job(void *arg);
+static void phy_faults_job(void *arg);
+static void phy_cable_test_job(void *arg);
+
+static periodic_job_t phy_jobs[] = {
+    {.name = "PHY0 link poll",   .function = phy_link_poll_job,         .arg = (void *) 0, .period = PHY_LINK_WATCHDOG_INTERVAL, .phase = 0                                 },
+    {.name = "PHY1 link poll",   .function = phy_link_poll_job,         .arg = (void *) 1, .period = PHY_LINK_WATCHDOG_INTERVAL, .phase = PHY_LINK_WATCHDOG_INTERVAL / 3    },
+    {.name = "PHY2 link poll",   .function = phy_link_poll_job,         .arg = (void *) 2, .period = PHY_LINK_WATCHDOG_INTERVAL, .phase = PHY_LINK_WATCHDOG_INTERVAL * 2 / 3},
+    {.name = "PHY3 link poll",   .function = phy_lan8671_link_poll_job, .arg = (void *) 3, .period = PHY_LINK_POLL_INTERVAL,     .phase = PHY_LINK_POLL_INTERVAL / 2        },
+    {.name = "PHY0 temperature", .function = phy_temperature_job,       .arg = (void *) 0, .period = PHY_TEMPERATURE_INTERVAL,   .phase = PHY_TEMPERATURE_INTERVAL / 6      },
+    {.name = "PHY1 temperature", .function = phy_temperature_job,       .arg = (void *) 1, .period = PHY_TEMPERATURE_INTERVAL,   .phase = PHY_TEMPERATURE_INTERVAL / 2      },
+    {.name = "PHY2 temperature", .function = phy_temperature_job,       .arg = (void *) 2, .period = PHY_TEMPERATURE_INTERVAL,   .phase = PHY_TEMPERATURE_INTERVAL * 5 / 6  },
+    {.name = "PHY faults",       .function = phy_faults_job,            .arg = (void *) 0, .period = PHY_LINK_WATCHDOG_INTERVAL, .phase = PHY_LINK_WATCHDOG_INTERVAL / 6    },
+    {.name = "PHY cable test",   .function = phy_cable_test_job,        .arg = (void *) 0, .period = PHY_CABLE_TEST_INTERVAL,    .phase = PHY_CABLE_TEST_INTERVAL / 3       },
+};
+
+static periodic_job_t *phy_jobs_heap[sizeof(phy_jobs) / sizeof(phy_jobs[0])];
+static scheduler_t     phy_scheduler;
+
+
+static void phy_temperature_job(void *arg) {
+    uint32_t index = (uint32_t) (uintptr_t) arg;
+    if (index == phy_cable_test_index) return;
+    if (PHY_88Q211X_ReadTemperature(phy_handles[index], &(phy_temperatures[index]), &(phy_temperatures_valid[index])) != PHY_OK) Error_Handler();
+}
 
-void phy_thread_entry(uint32_t initial_input) {
 
-    phy_status_t              phy_status  = PHY_OK;
-    tx_status_t               tx_status   = TX_SUCCESS;
-    phy_cable_state_88q211x_t cable_state = PHY_CABLE_STATE_88Q211X_NOT_STARTED;
-    uint32_t                  event_flags = 0;
-    bool                      link_up     = false;
+/* Watchdog in case an interrupt is missed. The interrupt lines are level (active low) but the EXTI is edge triggered,
+ * so if an edge is lost the line stays low and no more interrupts arrive. Check the line first since that is free,
+ * then poll the link state over MDIO */
+static void phy_int_line_check(uint32_t index) {
+    if (HAL_GPIO_ReadPin(phy_int_ports[index], phy_int_pins[index]) == GPIO_PIN_RESET) {
+        if (tx_event_flags_set(&phy_events_handle, phy_int_flags[index], TX_OR) != TX_SUCCESS) Error_Handler();
+    }
+}
+
+
+static void phy_link_poll_job(void *arg) {
+
+    uint32_t index = (uint32_t) (uintptr_t) arg;
+    bool     link_up;
+
+    if (index == phy_cable_test_index) return;
+
+    phy_int_line_check(index);
+
+    if (PHY_88Q211X_GetLinkState(phy_handles[index], &link_up) != PHY_OK) Error_Handler();
+}
+
+
+/* The LAN8671 has no interrupt line so its link state is polled. The driver may report the change itself through the
+ * event callback, otherwise it is reported here */
+static void phy_lan8671_link_poll_job(void *arg) {
+
+    uint32_t index = (uint32_t) (uintptr_t) arg;
+    bool     link_up;
+
+    if (PHY_LAN867X_GetLinkState(phy_handles[index], &link_up) != PHY_OK) Error_Handler();
+    if (link_up != phy_link_up[index]) {
+        if (phy_link_report(index, link_up) != PHY_OK) Error_Handler();
+    }
+}
 
-    UNUSED(cable_state); // TODO: Use
+
+static void phy_faults_job(void *arg) {
+
+    phy_fault_t fault = PHY_FAULT_NONE;
+    if (phy_cable_test_index == 0) return;
+    PHY_88Q211X_CheckFaults(&hphy0, &fault);
+    // phy_status         = PHY_88Q211X_CheckFaults(&hphy1, &fault1);
+    // phy_status         = PHY_88Q211X_CheckFaults(&hphy2, &fault2);
+    //        if (fault != PHY_FAULT_NONE) {
+    //            phy_status = PHY_88Q211X_Start100MBIST(&hphy0);
+    //            if (phy_status != PHY_OK) Error_Handler();
+    //            phy_status = PHY_88Q211X_Get100MBISTResults(&hphy0, &error);
+    //            if (phy_status != PHY_OK) Error_Handler();
+    //        }
+}
+
+
+/* Virtual cable tests (VCT). A test takes the port down and leaves undocumented registers changed, so it is only run
+ * on ports that have had no link for PHY_CABLE_TEST_LINK_DOWN_TIME, one PHY at a time, and the PHY is re-initialised
+ * afterwards. Startup link up is never delayed and live ports are never touched */
+static void phy_cable_test_job(void *arg) {
+
+    uint32_t                  now = tx_time_get_ms();
+    uint32_t                  index;
+    phy_cable_result_t        result;
+    phy_cable_state_88q211x_t cable_state;
+    uint32_t                  peak_distance;
+    bool                      link_up;
+
+    /* Collect the result of the test in progress */
+    if (phy_cable_test_index != PHY_CABLE_TEST_NONE) {
+
+        if ((now - phy_cable_test_start) < PHY_CABLE_TEST_DURATION) return;
+
+        index = phy_cable_test_index;
+        if (PHY_88Q211X_GetVCTResults(phy_handles[index], &cable_state, &peak_distance) != PHY_OK) Error_Handler();
+
+        result.valid         = true;
+        result.state         = cable_state;
+        result.peak_distance = peak_distance;
+        result.time          = now;
+        phy_cable_result_set(index, &result);
+
+        /* Put the PHY back how it was and pick up the link state again. Its interrupts were ignored during the test,
+         * so handle any that are still asserted */
+        if (phy_88q211x_reinit(index) != PHY_OK) Error_Handler();
+        phy_cable_test_index = PHY_CABLE_TEST_NONE;
+        if (PHY_88Q211X_GetLinkState(phy_handles[index], &link_up) != PHY_OK) Error_Handler();
+        phy_int_line_check(index);
+        phy_link_down_since[index] = now;
+
+        return;
+    }
+
+    /* Start a test on the next port that has been down long enough and hasn't been tested recently */
+    for (uint32_t i = 0; i < PHY_NUM_88Q211X; i++) {
+
+        index = (phy_cable_test_next + i) % PHY_NUM_88Q211X;
+        phy_cable_result_get(index, &result);
+
+        if (phy_link_up[index]) continue;
+        if ((now - phy_link_down_since[index]) < PHY_CABLE_TEST_LINK_DOWN_TIME) continue;
+        if (result.valid && ((now - result.time) < PHY_CABLE_TEST_REPEAT_INTERVAL)) continue;
+
+        if (PHY_88Q211X_StartVCT(phy_handles[index]) != PHY_OK) Error_Handler();
+        phy_cable_test_index = index;
+        phy_cable_test_start = now;
+        phy_cable_test_next  = (index + 1) % PHY_NUM_88Q211X;
+        return;
+    }
+}
+
+
+void phy_thread_entry(uint32_t initial_input) {
+
+    phy_status_t phy_status  = PHY_OK;
+    tx_status_t  tx_status   = TX_SUCCESS;
+    uint32_t     event_flags = 0;
+    uint32_t     link_flags  = 0;
+    uint32_t     delay       = 0;
+    bool         link_up     = false;
 
     memset((bool *) &phy_temperatures_valid, 0, sizeof(phy_temperatures_valid));
+    memset(phy_cable_results, 0, sizeof(phy_cable_results));
+    for (uint_fast8_t i = 0; i < NUM_PHYS; i++) {
+        phy_link_down_since[i] = tx_time_get_ms();
+    }
+
+    /* Hear about link changes so the cable test knows how long each port has been down */
+    phy_link_subscribe(&phy_events_handle, phy_link_flags);
 
     /* Initialise PHYs */
     phy_status = phys_init();
@@ -48,98 +229,44 @@ void phy_thread_entry(uint32_t initial_input) {
     if (phy_status != PHY_OK) Error_Handler();
     phy_status = PHY_88Q211X_GetLinkState(&hphy2, &link_up);
     if (phy_status != PHY_OK) Error_Handler();
+    phy_lan8671_link_poll_job((void *) 3);
 
-    /* Setup timing control variables (done in ms) */
-    uint32_t current_time   = tx_time_get_ms();
-    uint32_t next_wake_time = current_time + PHY_THREAD_INTERVAL;
+    /* Start the periodic jobs (done in ms) */
+    scheduler_init(&phy_scheduler, phy_jobs_heap, sizeof(phy_jobs_heap) / sizeof(phy_jobs_heap[0]));
+    for (uint_fast8_t i = 0; i < (sizeof(phy_jobs) / sizeof(phy_jobs[0])); i++) {
+        scheduler_add(&phy_scheduler, &phy_jobs[i], tx_time_get_ms());
+    }
 
     while (1) {
 
-        /* Sleep until the next wake time while also monitoring for PHY events */
-        current_time = tx_time_get_ms();
-        if (current_time < next_wake_time) {
-
-            /* Wait for an interrupt */
-            tx_status = tx_event_flags_get(&phy_events_handle, PHY_ALL_EVENTS, TX_OR_CLEAR, &event_flags, MS_TO_TICKS(next_wake_time - current_time));
-            if ((tx_status != TX_SUCCESS) && (tx_status != TX_NO_EVENTS)) Error_Handler();
-
-            /* Process any interrupts */
-            if (event_flags && (tx_status != TX_NO_EVENTS)) {
-
-                /* Call the interrupt handlers */
-                if (event_flags & PHY_PHY0_EVENT) {
-                    phy_status = PHY_88Q211X_ProcessInterrupt(&hphy0);
-                    if (phy_status != PHY_OK) Error_Handler();
-                }
-                if (event_flags & PHY_PHY1_EVENT) {
-                    phy_status = PHY_88Q211X_ProcessInterrupt(&hphy1);
-                    if (phy_status != PHY_OK) Error_Handler();
-                }
-                if (event_flags & PHY_PHY2_EVENT) {
-                    phy_status = PHY_88Q211X_ProcessInterrupt(&hphy2);
-                    if (phy_status != PHY_OK) Error_Handler();
-                }
-                // if (event_flags & PHY_PHY3_EVENT) { TODO:
-                //     phy_status = PHY_88Q211X_ProcessInterrupt(&hphy3);
-                //     if (phy_status != PHY_OK) Error_Handler();
-                // }
-
-                /* Go to the start of the loop and go back to sleep if necessary */
-                continue;
-            }
-
-            /* Otherwise the sleep time is over and regular PHY processing must be done */
-        }
+        /* Do any regular PHY processing that is due */
+        scheduler_run(&phy_scheduler, tx_time_get_ms());
+        delay = scheduler_delay(&phy_scheduler, tx_time_get_ms());
 
-        /* Schedule next wake time */
-        next_wake_time += PHY_THREAD_INTERVAL;
-
-        /* Read temperatures */
-        phy_status = PHY_88Q211X_ReadTemperature(&hphy0, &(phy_temperatures[0]), &(phy_temperatures_valid[0]));
-        if (phy_status != PHY_OK) Error_Handler();
-        phy_status = PHY_88Q211X_ReadTemperature(&hphy1, &(phy_temperatures[1]), &(phy_temperatures_valid[1]));
-        if (phy_status != PHY_OK) Error_Handler();
-        phy_status = PHY_88Q211X_ReadTemperature(&hphy2, &(phy_temperatures[2]), &(phy_temperatures_valid[2]));
-        if (phy_status != PHY_OK) Error_Handler();
-
-        /* Poll link states in case an interrupt is missed */
-        phy_status = PHY_88Q211X_GetLinkState(&hphy0, &link_up);
-        if (phy_status != PHY_OK) Error_Handler();
-        phy_status = PHY_88Q211X_GetLinkState(&hphy1, &link_up);
-        if (phy_status != PHY_OK) Error_Handler();
-        phy_status = PHY_88Q211X_GetLinkState(&hphy2, &link_up);
-        if (phy_status != PHY_OK) Error_Handler();
-
-        phy_fault_t fault = PHY_FAULT_NONE;
-        phy_status        = PHY_88Q211X_CheckFaults(&hphy0, &fault);
-        // phy_status         = PHY_88Q211X_CheckFaults(&hphy1, &fault1);
-        // phy_status         = PHY_88Q211X_CheckFaults(&hphy2, &fault2);
-        //        if (fault != PHY_FAULT_NONE) {
-        //            phy_status = PHY_88Q211X_Start100MBIST(&hphy0);
-        //            if (phy_status != PHY_OK) Error_Handler();
-        //            phy_status = PHY_88Q211X_Get100MBISTResults(&hphy0, &error);
-        //            if (phy_status != PHY_OK) Error_Handler();
-        //        }
-
-        /* TODO: Move VCT to after a timeout if there is no link (to prioritise startup speed), also the PHY probably needs to be reset after due to magic numbers in undocumented registers */
-        // /* Start the virtual cable tests (this can take up to 500ms) */
-        // status = PHY_88Q211X_StartVCT(&hphy0);
-        // if (status != PHY_OK) Error_Handler();
-        // status = PHY_88Q211X_StartVCT(&hphy1);
-        // if (status != PHY_OK) Error_Handler();
-        // status = PHY_88Q211X_StartVCT(&hphy2);
-        // if (status != PHY_OK) Error_Handler();
-
-        // /* Get the VCT results */
-        // tx_thread_sleep_ms(500);
-        // uint32_t                  maximum_peak_distance;
-        // status = PHY_88Q211X_GetVCTResults(&hphy0, &cable_state, &maximum_peak_distance);
-        // if (status != PHY_OK) Error_Handler();
-        // status = PHY_88Q211X_GetVCTResults(&hphy1, &cable_state, &maximum_peak_distance);
-        // if (status != PHY_OK) Error_Handler();
-        // status = PHY_88Q211X_GetVCTResults(&hphy2, &cable_state, &maximum_peak_distance);
-        // if (status != PHY_OK) Error_Handler();
+        /* Sleep until the next job is due while also monitoring for PHY events */
+        tx_status = tx_event_flags_get(&phy_events_handle, PHY_ALL_EVENTS, TX_OR_CLEAR, &event_flags, MS_TO_TICKS(delay));
+        if (tx_status == TX_NO_EVENTS) continue;
+        if (tx_status != TX_SUCCESS) Error_Handler();
 
+        /* Call the interrupt handlers. A PHY under a cable test is left alone, the test drops its link and the
+         * interrupts it raises are dealt with when the test is collected */
+        for (uint32_t index = 0; index < PHY_NUM_88Q211X; index++) {
+            if (!(event_flags & phy_int_flags[index]) || (index == phy_cable_test_index)) continue;
+            phy_status = PHY_88Q211X_ProcessInterrupt(phy_handles[index]);
+            if (phy_status != PHY_OK) Error_Handler();
+        }
+        // if (event_flags & PHY_PHY3_EVENT) { TODO:
+        //     phy_status = PHY_88Q211X_ProcessInterrupt(&hphy3);
+        //     if (phy_status != PHY_OK) Error_Handler();
+        // }
+
+        /* Restart the down time of any port whose link changed, including changes reported by the handlers above */
+        tx_status = tx_event_flags_get(&phy_events_handle, PHY_LINK_EVENTS, TX_OR_CLEAR, &link_flags, TX_NO_WAIT);
+        if (tx_status == TX_SUCCESS) event_flags |= link_flags;
+        else if (tx_status != TX_NO_EVENTS) Error_Handler();
+        for (uint32_t index = 0; index < NUM_PHYS; index++) {
+            if (event_flags & phy_link_flags[index]) phy_link_down_since[index] = tx_time_get_ms();
+        }
 
         /* TODO: If the current thread holds the phy mutex when it shouldn't report an error */
     }
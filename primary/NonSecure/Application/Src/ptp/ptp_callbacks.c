@@ -13,6 +13,7 @@
 
 #include "nx_app.h"
 #include "ptp_callbacks.h"
+#include "ptp_servo.h"
 #include "utils.h"
 #include "config.h"
 
@@ -21,10 +22,84 @@
 
 
 ptp_event_counters_t ptp_event_counters;
+ptp_servo_t          ptp_servo;
+
+static uint32_t ptp_base_addend;       /* Addend for the nominal HCLK frequency, the servo corrects relative to this */
+static float    ptp_applied_frequency; /* Frequency correction last written to the addend in ppb */
 
 extern ETH_HandleTypeDef heth;
 
 
+static int64_t ptp_time_to_ns(const NX_PTP_TIME *time) {
+    return (((((int64_t) time->second_high) << 32) | (int64_t) time->second_low) * NX_PTP_NANOSECONDS_PER_SEC) + time->nanosecond;
+}
+
+
+/* The servo stats are updated by the PTP client thread so they are copied with interrupts disabled */
+void ptp_servo_stats_get(ptp_servo_stats_t *stats) {
+    TX_INTERRUPT_SAVE_AREA
+    TX_DISABLE
+    *stats = ptp_servo.stats;
+    TX_RESTORE
+}
+
+
+/* Servo trace, replayed on a host by Tests/ptp_servo. Each sample logs the local sync receive time, the offset and path
+ * delay, the frequency correction in force while it was measured and whether the clock was then stepped by the offset.
+ * Servo resets are logged too since the local clock may have been set */
+static void ptp_servo_trace_sample(int64_t local_time, int32_t offset, int32_t path_delay, float frequency, bool stepped) {
+#if PTP_SERVO_TRACE == true
+    log_write("PTP servo trace: %lu %lu %ld %ld %ld %u\n", (uint32_t) (local_time / NX_PTP_NANOSECONDS_PER_SEC), (uint32_t) (local_time % NX_PTP_NANOSECONDS_PER_SEC), offset, path_delay, lrintf(frequency), stepped);
+#endif
+}
+
+
+static void ptp_servo_trace_reset(void) {
+#if PTP_SERVO_TRACE == true
+    log_write("PTP servo trace: reset\n");
+#endif
+}
+
+
+/* Step the clock by an offset of less than a second */
+static nx_status_t ptp_clock_step(int32_t offset_ns, ULONG seconds) {
+
+    TX_INTERRUPT_SAVE_AREA
+
+    nx_status_t     status = NX_STATUS_SUCCESS;
+    ETH_TimeTypeDef eth_time;
+
+    /* Form the ETH_TimeTypeDef struct */
+    eth_time.NanoSeconds = abs(offset_ns);
+    eth_time.Seconds     = seconds;
+
+    /* Update the time */
+    TX_DISABLE
+    if (offset_ns >= 0) {
+        if (HAL_ETH_PTP_AddTimeOffset(&heth, HAL_ETH_PTP_POSITIVE_UPDATE, &eth_time) != HAL_OK) status = NX_STATUS_NOT_ENABLED;
+    } else {
+        if (HAL_ETH_PTP_AddTimeOffset(&heth, HAL_ETH_PTP_NEGATIVE_UPDATE, &eth_time) != HAL_OK) status = NX_STATUS_NOT_ENABLED;
+    }
+    TX_RESTORE
+
+    return status;
+}
+
+
+/* Change the clock rate by writing a new addend for the fine update accumulator. The HAL only offers this as part of a
+ * full PTP reconfiguration, so the registers are written directly. If the previous update hasn't been latched yet this
+ * one is dropped, the servo will correct for it on the next sample */
+static void ptp_clock_frequency_set(float frequency) {
+    if (READ_BIT(heth.Instance->MACTSCR, ETH_MACTSCR_TSADDREG) != 0) {
+        ptp_event_counters.frequency_update_missed++;
+        return;
+    }
+    WRITE_REG(heth.Instance->MACTSAR, ptp_servo_addend(ptp_base_addend, frequency));
+    SET_BIT(heth.Instance->MACTSCR, ETH_MACTSCR_TSADDREG);
+    ptp_applied_frequency = frequency;
+}
+
+
 /* Clock callback for NetX PTP client */
 UINT ptp_clock_callback(NX_PTP_CLIENT *client_ptr, UINT operation, NX_PTP_TIME *time_ptr, NX_PACKET *packet_ptr, VOID *callback_data) {
 
@@ -32,8 +107,12 @@ UINT ptp_clock_callback(NX_PTP_CLIENT *client_ptr, UINT operation, NX_PTP_TIME *
 
     NX_PARAMETER_NOT_USED(callback_data);
 
-    nx_status_t     status = NX_STATUS_SUCCESS;
-    ETH_TimeTypeDef eth_time;
+    nx_status_t        status = NX_STATUS_SUCCESS;
+    ETH_TimeTypeDef    eth_time;
+    ptp_servo_action_t action;
+    int64_t            local_time;
+    int32_t            path_delay;
+    float              frequency;
 
     switch (operation) {
 
@@ -54,6 +133,11 @@ UINT ptp_clock_callback(NX_PTP_CLIENT *client_ptr, UINT operation, NX_PTP_TIME *
             if (HAL_ETH_PTP_GetConfig(&heth, &ptp_config) != HAL_OK) status = NX_PTP_PARAM_ERROR;
             if (status != NX_STATUS_SUCCESS) return status;
 
+            /* The servo steers the clock rate by adjusting the addend around this nominal value */
+            ptp_base_addend       = addend;
+            ptp_applied_frequency = 0.0f;
+            ptp_servo_init(&ptp_servo, PTP_SERVO_KP, PTP_SERVO_KI, PTP_SERVO_MAX_FREQUENCY, PTP_SERVO_STEP_THRESHOLD, PTP_SERVO_STATS_WINDOW);
+
             /* Update the config */
             ptp_config.TimestampUpdateMode   = ENABLE; /* Fine mode */
             ptp_config.TimestampAddend       = addend;
@@ -84,15 +168,17 @@ UINT ptp_clock_callback(NX_PTP_CLIENT *client_ptr, UINT operation, NX_PTP_TIME *
             /* TODO: Set the ETH_MACTSECNR_TSEC and ETH_MACTSICNR_TSIC registers */
 
             /* Reset event counters */
-            ptp_event_counters.tx_timestamps_missed = 0;
-            ptp_event_counters.sync                 = 0;
-            ptp_event_counters.new_master           = 0;
-            ptp_event_counters.master_timeout       = 0;
-            ptp_event_counters.clock_set            = 0;
-            ptp_event_counters.timestamps_extracted = 0;
-            ptp_event_counters.clock_get            = 0;
-            ptp_event_counters.clock_adjusted       = 0;
-            ptp_event_counters.timestamps_sent      = 0;
+            ptp_event_counters.tx_timestamps_missed    = 0;
+            ptp_event_counters.sync                    = 0;
+            ptp_event_counters.new_master              = 0;
+            ptp_event_counters.master_timeout          = 0;
+            ptp_event_counters.clock_set               = 0;
+            ptp_event_counters.timestamps_extracted    = 0;
+            ptp_event_counters.clock_get               = 0;
+            ptp_event_counters.clock_adjusted          = 0;
+            ptp_event_counters.clock_stepped           = 0;
+            ptp_event_counters.frequency_update_missed = 0;
+            ptp_event_counters.timestamps_sent         = 0;
             break;
         }
 
@@ -109,6 +195,10 @@ UINT ptp_clock_callback(NX_PTP_CLIENT *client_ptr, UINT operation, NX_PTP_TIME *
             if (HAL_ETH_PTP_SetTime(&heth, &eth_time) != HAL_OK) status = NX_STATUS_NOT_ENABLED;
             TX_RESTORE
             if (status != NX_STATUS_SUCCESS) return status;
+
+            /* The servo's timing history is meaningless after a jump */
+            ptp_servo_reset(&ptp_servo);
+            ptp_servo_trace_reset();
             ptp_event_counters.clock_set++;
             break;
         }
@@ -154,19 +244,21 @@ UINT ptp_clock_callback(NX_PTP_CLIENT *client_ptr, UINT operation, NX_PTP_TIME *
                 offset_ns = -NX_PTP_NANOSECONDS_PER_SEC;
             }
 
-            /* Form the ETH_TimeTypeDef struct */
-            eth_time.NanoSeconds = abs(offset_ns);
-            eth_time.Seconds     = time_ptr->second_low;
-
-            /* Update the time */
-            TX_DISABLE
-            if (offset_ns >= 0) {
-                if (HAL_ETH_PTP_AddTimeOffset(&heth, HAL_ETH_PTP_POSITIVE_UPDATE, &eth_time) != HAL_OK) status = NX_STATUS_NOT_ENABLED;
-            } else {
-                if (HAL_ETH_PTP_AddTimeOffset(&heth, HAL_ETH_PTP_NEGATIVE_UPDATE, &eth_time) != HAL_OK) status = NX_STATUS_NOT_ENABLED;
+            /* The offset was measured when the last sync arrived. For both delay request-response and peer delay the
+             * client calculates offset = t1 - t2 + delay, so the path delay it used can be recovered from the sync
+             * timestamps */
+            local_time = ptp_time_to_ns(&client_ptr->nx_ptp_client_sync_ts);
+            path_delay = (int32_t) (offset_ns + local_time - ptp_time_to_ns(&client_ptr->nx_ptp_client_sync));
+
+            /* Steer the clock rate, only stepping the time when the servo asks for it */
+            action = ptp_servo_sample(&ptp_servo, offset_ns, local_time, path_delay, &frequency);
+            ptp_servo_trace_sample(local_time, offset_ns, path_delay, ptp_applied_frequency, action == PTP_SERVO_ACTION_STEP);
+            if (action == PTP_SERVO_ACTION_STEP) {
+                status = ptp_clock_step(offset_ns, time_ptr->second_low);
+                if (status != NX_STATUS_SUCCESS) return status;
+                ptp_event_counters.clock_stepped++;
             }
-            TX_RESTORE
-            if (status != NX_STATUS_SUCCESS) return status;
+            if (action != PTP_SERVO_ACTION_NONE) ptp_clock_frequency_set(frequency);
 
             ptp_event_counters.clock_adjusted++;
             break;
@@ -237,6 +329,8 @@ UINT ptp_event_callback(NX_PTP_CLIENT *ptp_client_ptr, UINT event, VOID *event_d
     switch (event) {
         case NX_PTP_CLIENT_EVENT_MASTER: {
             ptp_event_counters.new_master++;
+            ptp_servo_reset(&ptp_servo);
+            ptp_servo_trace_reset();
 //            printf("new MASTER clock!\r\n");
             break;
         }
@@ -250,6 +344,8 @@ UINT ptp_event_callback(NX_PTP_CLIENT *ptp_client_ptr, UINT event, VOID *event_d
 
         case NX_PTP_CLIENT_EVENT_TIMEOUT: {
             ptp_event_counters.master_timeout++;
+            ptp_servo_reset(&ptp_servo);
+            ptp_servo_trace_reset();
 //            printf("Master clock TIMEOUT!\r\n");
             break;
         }
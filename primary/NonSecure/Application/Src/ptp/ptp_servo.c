@@ -0,0 +1,155 @@
+/*
+ * ptp_servo.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "math.h"
+
+#include "ptp_servo.h"
+
+
+/* PI clock servo. Each sample is the offset of the local clock from the master (positive when the local clock is
+ * behind) and the local time it was measured at. The servo returns a frequency correction in ppb to apply to the
+ * clock, and only asks for the clock to be stepped when the offset is too large to slew out. Like the scheduler it
+ * knows nothing about the hardware or ThreadX, so recorded timestamp traces can be replayed through it on a host */
+
+
+#define PTP_SERVO_NS_PER_SEC (1e9f)
+
+
+static float ptp_servo_clamp(float value, float limit) {
+    if (value > limit) return limit;
+    if (value < -limit) return -limit;
+    return value;
+}
+
+
+static void ptp_servo_window_clear(ptp_servo_t *servo) {
+    servo->window_offset_sq  = 0.0f;
+    servo->window_offset_max = 0;
+    servo->window_frequency  = 0.0f;
+    servo->window_path_delay = 0;
+    servo->window_count      = 0;
+}
+
+
+/* Summarise the locked samples over each window, like the rms/max/freq/delay lines of other PTP implementations */
+static void ptp_servo_window_add(ptp_servo_t *servo, int32_t offset, float frequency, int32_t path_delay) {
+
+    int32_t offset_abs = (offset < 0) ? -offset : offset;
+
+    servo->window_offset_sq  += (float) offset * (float) offset;
+    servo->window_offset_max  = (offset_abs > servo->window_offset_max) ? offset_abs : servo->window_offset_max;
+    servo->window_frequency  += frequency;
+    servo->window_path_delay += path_delay;
+    servo->window_count++;
+
+    if (servo->window_count < servo->stats_window) return;
+
+    servo->stats.offset_rms      = sqrtf(servo->window_offset_sq / (float) servo->window_count);
+    servo->stats.offset_max      = servo->window_offset_max;
+    servo->stats.frequency_mean  = servo->window_frequency / (float) servo->window_count;
+    servo->stats.path_delay_mean = (int32_t) (servo->window_path_delay / (int64_t) servo->window_count);
+    ptp_servo_window_clear(servo);
+}
+
+
+void ptp_servo_init(ptp_servo_t *servo, float kp, float ki, float max_frequency, int32_t step_threshold, uint32_t stats_window) {
+
+    servo->kp             = kp;
+    servo->ki             = ki;
+    servo->max_frequency  = max_frequency;
+    servo->step_threshold = step_threshold;
+    servo->stats_window   = (stats_window > 0) ? stats_window : 1;
+
+    servo->state       = PTP_SERVO_UNLOCKED;
+    servo->drift       = 0.0f;
+    servo->last_time   = 0;
+    servo->last_offset = 0;
+    ptp_servo_window_clear(servo);
+
+    servo->stats = (ptp_servo_stats_t) {0};
+}
+
+
+/* Forget the timing history, e.g. after the master changes or the clock is set. The integral term is kept, the local
+ * oscillator hasn't changed so the last frequency estimate is still the best one to hold over with */
+void ptp_servo_reset(ptp_servo_t *servo) {
+    if (servo->state != PTP_SERVO_UNLOCKED) servo->stats.resets++;
+    servo->state       = PTP_SERVO_UNLOCKED;
+    servo->stats.state = PTP_SERVO_UNLOCKED;
+    ptp_servo_window_clear(servo);
+}
+
+
+/* Process one offset measurement. The offset is in ns, local_time is the local clock in ns when the offset was measured
+ * (the sync receive timestamp) and path_delay is only recorded for stats. The frequency to apply is written to
+ * frequency unless the action is PTP_SERVO_ACTION_NONE */
+ptp_servo_action_t ptp_servo_sample(ptp_servo_t *servo, int32_t offset, int64_t local_time, int32_t path_delay, float *frequency) {
+
+    ptp_servo_action_t action   = PTP_SERVO_ACTION_NONE;
+    int64_t            interval = local_time - servo->last_time;
+    bool               step     = (offset > servo->step_threshold) || (offset < -servo->step_threshold);
+    float              integral;
+
+    servo->stats.samples++;
+    servo->stats.offset     = offset;
+    servo->stats.path_delay = path_delay;
+
+    /* Samples have to move forwards in time, anything else means the clock was changed behind our back */
+    if ((servo->state != PTP_SERVO_UNLOCKED) && (interval <= 0)) ptp_servo_reset(servo);
+
+    switch (servo->state) {
+
+        /* First sample, just remember it */
+        case PTP_SERVO_UNLOCKED: {
+            servo->state = PTP_SERVO_MEASURING;
+            break;
+        }
+
+        /* Second sample, the change in offset gives the frequency error. Step out whatever offset is left over once */
+        case PTP_SERVO_MEASURING: {
+            servo->drift = ptp_servo_clamp(servo->drift + (((float) ((int64_t) offset - servo->last_offset) * PTP_SERVO_NS_PER_SEC) / (float) interval), servo->max_frequency);
+            *frequency   = servo->drift;
+            action       = step ? PTP_SERVO_ACTION_STEP : PTP_SERVO_ACTION_ADJUST;
+            servo->state = PTP_SERVO_LOCKED;
+            break;
+        }
+
+        /* Steer the frequency so the offset is slewed out. A large offset means something upset the clock, step it
+         * rather than wind up the integrator */
+        case PTP_SERVO_LOCKED: {
+            if (step) {
+                *frequency = servo->drift;
+                action     = PTP_SERVO_ACTION_STEP;
+                break;
+            }
+            integral     = (servo->ki * (float) offset * PTP_SERVO_NS_PER_SEC) / (float) interval;
+            servo->drift = ptp_servo_clamp(servo->drift + integral, servo->max_frequency);
+            *frequency   = ptp_servo_clamp(((servo->kp * (float) offset * PTP_SERVO_NS_PER_SEC) / (float) interval) + servo->drift, servo->max_frequency);
+            action       = PTP_SERVO_ACTION_ADJUST;
+            ptp_servo_window_add(servo, offset, *frequency, path_delay);
+            break;
+        }
+    }
+
+    if (action == PTP_SERVO_ACTION_STEP) servo->stats.steps++;
+    if (action != PTP_SERVO_ACTION_NONE) servo->stats.frequency = *frequency;
+
+    servo->stats.state = servo->state;
+    servo->last_time   = local_time;
+    servo->last_offset = offset;
+
+    return action;
+}
+
+
+/* Scale the nominal addend by a frequency correction in ppb. The addend is the fraction of the HCLK rate the PTP clock
+ * runs at, so a larger addend makes the clock run faster */
+uint32_t ptp_servo_addend(uint32_t base_addend, float frequency) {
+    return (uint32_t) ((int64_t) base_addend + (int64_t) lrintf((float) base_addend * (frequency / PTP_SERVO_NS_PER_SEC)));
+}
@@ -38,14 +38,19 @@ void ptp_thread_entry(uint32_t initial_input) {
     NX_PACKET       *packet_ptr = NULL;
     NX_PTP_TIME      timestamp;
 
+#if (PTP_PRINT_TIME_INTERVAL != UINT32_MAX)
     NX_PTP_TIME      time;
     NX_PTP_DATE_TIME date;
+    uint32_t         next_print_time = 0;
+#endif /* (PTP_PRINT_TIME_INTERVAL != UINT32_MAX) */
+
+    uint32_t next_servo_print_time = 0;
+    uint32_t current_time          = 0;
 
-    uint32_t next_print_time = 0;
-    uint32_t current_time    = 0;
+    ptp_servo_stats_t servo_stats;
 
     /* Create the PTP client */
-    status = nx_ptp_client_create(&ptp_client, &nx_ip_instance, 0, &nx_packet_pool, NX_INTERNAL_PTP_THREAD_PRIORITY, (UCHAR *) nx_internal_ptp_stack, sizeof(nx_internal_ptp_stack), ptp_clock_callback, NX_NULL);
+    status = nx_ptp_client_create(&ptp_client, &nx_ip_instance, 0, &nx_small_packet_pool, NX_INTERNAL_PTP_THREAD_PRIORITY, (UCHAR *) nx_internal_ptp_stack, sizeof(nx_internal_ptp_stack), ptp_clock_callback, NX_NULL);
     if (status != NX_SUCCESS) Error_Handler();
 
     /* Start the PTP client */
@@ -57,7 +62,7 @@ void ptp_thread_entry(uint32_t initial_input) {
     while (1) {
 
         /* Receive transmitted packet information from the queue */
-        status = tx_queue_receive(&ptp_tx_queue_handle, &tx_info, CONSTRAIN(PTP_PRINT_TIME_INTERVAL, MS_TO_TICKS(100), TX_WAIT_FOREVER));
+        status = tx_queue_receive(&ptp_tx_queue_handle, &tx_info, CONSTRAIN(MIN(PTP_PRINT_TIME_INTERVAL, PTP_SERVO_PRINT_INTERVAL), MS_TO_TICKS(100), TX_WAIT_FOREVER));
 
         /* Successfully transmitted packet: update the PTP client */
         if (status == NX_SUCCESS) {
@@ -134,20 +139,32 @@ void ptp_thread_entry(uint32_t initial_input) {
         else if (status != TX_QUEUE_EMPTY) {
             Error_Handler();
         }
-    }
+
+        current_time = tx_time_get_ms();
 
 #if (PTP_PRINT_TIME_INTERVAL != UINT32_MAX)
 
-    /* Get, convert, and print the PTP time (this ironically uses the non-precise threadx time to delay between prints) */
-    current_time = tx_time_get_ms();
-    if (current_time >= next_print_time) {
-        status = nx_ptp_client_time_get(&ptp_client, &time);
-        if (status != NX_SUCCESS) Error_Handler();
-        status = nx_ptp_client_utility_convert_time_to_date(&time, -ptp_utc_offset, &date);
-        if (status != NX_SUCCESS) Error_Handler();
-        printf("%2u/%02u/%u %02u:%02u:%02u.%09lu\r\n", date.day, date.month, date.year, date.hour, date.minute, date.second, date.nanosecond);
-        next_print_time = current_time + PTP_PRINT_TIME_INTERVAL;
-    }
+        /* Get, convert, and log the PTP time (this ironically uses the non-precise threadx time to delay between prints) */
+        if (current_time >= next_print_time) {
+            status = nx_ptp_client_time_get(&ptp_client, &time);
+            if (status != NX_SUCCESS) Error_Handler();
+            status = nx_ptp_client_utility_convert_time_to_date(&time, -ptp_utc_offset, &date);
+            if (status != NX_SUCCESS) Error_Handler();
+            log_write("PTP time: %2u/%02u/%u %02u:%02u:%02u.%09lu\n", date.day, date.month, date.year, date.hour, date.minute, date.second, date.nanosecond);
+            next_print_time = current_time + PTP_PRINT_TIME_INTERVAL;
+        }
 
-#endif /* (PTP_PRINT_TIME_INTERVAL != TX_WAIT_FOREVER) */
+#endif /* (PTP_PRINT_TIME_INTERVAL != UINT32_MAX) */
+
+#if (PTP_SERVO_PRINT_INTERVAL != UINT32_MAX)
+
+        /* Log the servo stats. The window values only change once every PTP_SERVO_STATS_WINDOW samples */
+        if (current_time >= next_servo_print_time) {
+            ptp_servo_stats_get(&servo_stats);
+            log_write("PTP servo: state %u, offset %ld ns (rms %ld, max %ld), frequency %ld ppb (mean %ld), path delay %ld ns (mean %ld), samples %lu, steps %lu, resets %lu\n", servo_stats.state, servo_stats.offset, lrintf(servo_stats.offset_rms), servo_stats.offset_max, lrintf(servo_stats.frequency), lrintf(servo_stats.frequency_mean), servo_stats.path_delay, servo_stats.path_delay_mean, servo_stats.samples, servo_stats.steps, servo_stats.resets);
+            next_servo_print_time = current_time + PTP_SERVO_PRINT_INTERVAL;
+        }
+
+#endif /* (PTP_SERVO_PRINT_INTERVAL != UINT32_MAX) */
+    }
 }
@@ -0,0 +1,110 @@
+/*
+ * scheduler.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stddef.h"
+
+#include "main.h"
+
+#include "scheduler.h"
+
+
+/* Runs periodic jobs in deadline order for a single thread. The scheduler has no idea what the time is or how to
+ * sleep, the owning thread passes the current time in and sleeps (or waits for events) for as long as it is told. This
+ * keeps it free of ThreadX so it can be run on a host with a virtual clock */
+
+
+static void scheduler_swap(scheduler_t *scheduler, uint32_t a, uint32_t b) {
+    periodic_job_t *job = scheduler->heap[a];
+    scheduler->heap[a]  = scheduler->heap[b];
+    scheduler->heap[b]  = job;
+}
+
+
+static void scheduler_sift_up(scheduler_t *scheduler, uint32_t index) {
+
+    uint32_t parent;
+
+    while (index > 0) {
+        parent = (index - 1) / 2;
+        if (!SCHEDULER_TIME_BEFORE(scheduler->heap[index]->next_run, scheduler->heap[parent]->next_run)) break;
+        scheduler_swap(scheduler, index, parent);
+        index = parent;
+    }
+}
+
+
+static void scheduler_sift_down(scheduler_t *scheduler, uint32_t index) {
+
+    uint32_t child;
+
+    while ((child = (2 * index) + 1) < scheduler->count) {
+
+        /* Pick the earlier of the two children */
+        if (((child + 1) < scheduler->count) && SCHEDULER_TIME_BEFORE(scheduler->heap[child + 1]->next_run, scheduler->heap[child]->next_run)) {
+            child++;
+        }
+
+        if (!SCHEDULER_TIME_BEFORE(scheduler->heap[child]->next_run, scheduler->heap[index]->next_run)) break;
+        scheduler_swap(scheduler, index, child);
+        index = child;
+    }
+}
+
+
+void scheduler_init(scheduler_t *scheduler, periodic_job_t **heap, uint32_t capacity) {
+    scheduler->heap     = heap;
+    scheduler->capacity = capacity;
+    scheduler->count    = 0;
+    scheduler->overruns = 0;
+}
+
+
+/* Add a job. Its first run will be job->phase ms after now */
+void scheduler_add(scheduler_t *scheduler, periodic_job_t *job, uint32_t now) {
+
+    if ((scheduler->count >= scheduler->capacity) || (job->period == 0)) Error_Handler();
+
+    job->next_run                     = now + job->phase;
+    scheduler->heap[scheduler->count] = job;
+    scheduler_sift_up(scheduler, scheduler->count);
+    scheduler->count++;
+}
+
+
+/* Run every job that is due. Each job is rescheduled relative to its previous deadline so it doesn't drift. If it has
+ * fallen a whole period or more behind the missed runs are dropped instead of being run back to back */
+void scheduler_run(scheduler_t *scheduler, uint32_t now) {
+
+    periodic_job_t *job;
+
+    if (scheduler->count == 0) return;
+
+    while (!SCHEDULER_TIME_BEFORE(now, scheduler->heap[0]->next_run)) {
+
+        job = scheduler->heap[0];
+        job->function(job->arg);
+
+        job->next_run += job->period;
+        if (!SCHEDULER_TIME_BEFORE(now, job->next_run)) {
+            job->next_run += (((now - job->next_run) / job->period) + 1) * job->period; /* Keeps the phase */
+            scheduler->overruns++;
+        }
+        scheduler_sift_down(scheduler, 0);
+    }
+}
+
+
+/* Return the number of ms until the next job is due, or 0 if one already is. This should be given the time after
+ * scheduler_run() returns, not the time that was given to it, or the jobs' run time is slept on top of the wait */
+uint32_t scheduler_delay(const scheduler_t *scheduler, uint32_t now) {
+
+    if (scheduler->count == 0) return UINT32_MAX;
+    if (!SCHEDULER_TIME_BEFORE(now, scheduler->heap[0]->next_run)) return 0;
+    return scheduler->heap[0]->next_run - now;
+}
@@ -21,6 +21,7 @@
 #include "utils.h"
 #include "switch_thread.h"
 #include "phy_thread.h"
+#include "phy_callbacks.h"
 #include "phy_common.h"
 
 
@@ -111,6 +112,13 @@ volatile uint32_t stp_error_counter = 0;
 
 
 void stp_thread_entry(uint32_t initial_input) {
+
+#if ENABLE_STP_THREAD == true
+    /* Get notified when a port's link goes up or down */
+    static const ULONG link_flags[NUM_PHYS] = {STP_PORT0_LINK_STATE_CHANGE_EVENT, STP_PORT1_LINK_STATE_CHANGE_EVENT, STP_PORT2_LINK_STATE_CHANGE_EVENT, STP_PORT3_LINK_STATE_CHANGE_EVENT};
+    phy_link_subscribe(&stp_events_handle, link_flags);
+#endif
+
 //
 //    uint32_t    event_flags;
 //    NX_PACKET*  received_packet;
@@ -5,6 +5,7 @@
  *      Author: bens1
  */
 
+#include "stdatomic.h"
 #include "tx_api.h"
 #include "hal.h"
 
@@ -16,10 +17,37 @@
 #include "sja1105q_default_conf.h"
 
 
+#define SWITCH_SPI_CMD_WRITE    (1UL << 31)                   /* First word of every SPI transaction, bit 31 set means write */
+#define SWITCH_SPI_CMD_ADDR(cmd) (((cmd) >> 4) & 0x001fffffUL) /* Bits 24:4 hold the register address */
+
+/* Address ranges holding the configuration tables (UM10944). Writes anywhere else (PTP clock, clock generation and reset
+ * units, pad configuration, counters) don't change the local copies */
+typedef struct {
+    uint32_t start;
+    uint32_t end;
+} sja1105_table_range_t;
+
+static const sja1105_table_range_t sja1105_table_ranges[] = {
+    {0x000020, 0x00005f}, /* Dynamic reconfiguration registers */
+    {0x008000, 0x00800f}, /* AVB parameters dynamic reconfiguration */
+    {0x020000, 0x02ffff}, /* Static configuration */
+};
+
+
 TX_MUTEX            sja1105_mutex_handle;
+TX_SEMAPHORE        sja1105_spi_semaphore_handle;
 static UCHAR        switch_byte_pool_buffer[SWITCH_MEM_POOL_SIZE] __ALIGNED(32);
 static TX_BYTE_POOL switch_byte_pool;
 
+/* SPI traffic tracking. A write to one of the table address ranges marks the local copies as dirty */
+atomic_uint_fast32_t sja1105_spi_words        = 0;
+atomic_bool          sja1105_tables_dirty     = true;
+static bool          sja1105_spi_command_next = false;
+static TX_THREAD    *sja1105_untracked_thread = TX_NULL; /* Writes from this thread don't mark the tables as dirty */
+
+/* Set by HAL_SPI_ErrorCallback() during an interrupt driven transfer */
+static volatile bool sja1105_spi_error = false;
+
 
 sja1105_status_t switch_byte_pool_init() {
 
@@ -36,16 +64,84 @@ static void sja1105_write_cs_pin(sja1105_pinstate_t state, void *context) {
 
     if (state == SJA1105_PIN_RESET) {
         HAL_GPIO_WritePin(SWCH_CS_GPIO_Port, SWCH_CS_Pin, RESET);
+        sja1105_spi_command_next = true;
     } else {
         HAL_GPIO_WritePin(SWCH_CS_GPIO_Port, SWCH_CS_Pin, SET);
     }
 }
 
+static bool sja1105_is_table_address(uint32_t address) {
+    for (uint_fast8_t i = 0; i < (sizeof(sja1105_table_ranges) / sizeof(sja1105_table_ranges[0])); i++) {
+        if ((address >= sja1105_table_ranges[i].start) && (address <= sja1105_table_ranges[i].end)) return true;
+    }
+    return false;
+}
+
+/* Check the command word at the start of each transaction for writes to the tables */
+static inline void sja1105_spi_track(const uint32_t *tx_data, uint16_t size) {
+
+    if (sja1105_spi_command_next && (size > 0)) {
+        if ((tx_data[0] & SWITCH_SPI_CMD_WRITE) && sja1105_is_table_address(SWITCH_SPI_CMD_ADDR(tx_data[0])) &&
+            ((sja1105_untracked_thread == TX_NULL) || (tx_thread_identify() != sja1105_untracked_thread))) {
+            sja1105_tables_dirty = true;
+        }
+        sja1105_spi_command_next = false;
+    }
+
+    sja1105_spi_words += size;
+}
+
+/* Dynamic table reads are started by writing the reconfiguration control word with RDWRSET clear, so to the tracking
+ * they look like table writes. Where RDWRSET sits depends on the table, so rather than decode every control word the
+ * switch thread stops tracking its own transactions while it reads the tables back or frees management routes. Writes
+ * from every other thread are still tracked, and the switch mutex keeps them out of the middle of a driver call */
+void switch_spi_untracked_begin(void) {
+    sja1105_untracked_thread = tx_thread_identify();
+}
+
+void switch_spi_untracked_end(void) {
+    sja1105_untracked_thread = TX_NULL;
+}
+
+/* Only use interrupts for long transfers once the kernel is running, otherwise there is no thread to put to sleep */
+static inline bool sja1105_spi_use_it(uint16_t size) {
+    return (size >= SWITCH_SPI_IT_MIN_SIZE) && (tx_thread_identify() != TX_NULL);
+}
+
+/* Sleep until an interrupt driven transfer finishes */
+static sja1105_status_t sja1105_spi_wait(uint32_t timeout) {
+
+    sja1105_status_t status = SJA1105_OK;
+
+    if (tx_semaphore_get(&sja1105_spi_semaphore_handle, MS_TO_TICKS(timeout)) != TX_SUCCESS) {
+        HAL_SPI_Abort(&SWCH_SPI);
+
+        /* The transfer may have completed between the timeout and the abort */
+        tx_semaphore_get(&sja1105_spi_semaphore_handle, TX_NO_WAIT);
+        status = SJA1105_SPI_ERROR;
+    }
+
+    if (sja1105_spi_error) status = SJA1105_SPI_ERROR;
+
+    return status;
+}
+
 static sja1105_status_t sja1105_spi_transmit(const uint32_t *data, uint16_t size, uint32_t timeout, void *context) {
 
     sja1105_status_t status = SJA1105_OK;
 
-    if (HAL_SPI_Transmit(&SWCH_SPI, (uint8_t *) data, size, timeout) != HAL_OK) {
+    sja1105_spi_track(data, size);
+
+    if (sja1105_spi_use_it(size)) {
+        sja1105_spi_error = false;
+        if (HAL_SPI_Transmit_IT(&SWCH_SPI, (uint8_t *) data, size) != HAL_OK) {
+            status = SJA1105_SPI_ERROR;
+        } else {
+            status = sja1105_spi_wait(timeout);
+        }
+    }
+
+    else if (HAL_SPI_Transmit(&SWCH_SPI, (uint8_t *) data, size, timeout) != HAL_OK) {
         status = SJA1105_SPI_ERROR;
     }
 
@@ -56,7 +152,18 @@ static sja1105_status_t sja1105_spi_receive(uint32_t *data, uint16_t size, uint3
 
     sja1105_status_t status = SJA1105_OK;
 
-    if (HAL_SPI_Receive(&SWCH_SPI, (uint8_t *) data, size, timeout) != HAL_OK) {
+    sja1105_spi_words += size;
+
+    if (sja1105_spi_use_it(size)) {
+        sja1105_spi_error = false;
+        if (HAL_SPI_Receive_IT(&SWCH_SPI, (uint8_t *) data, size) != HAL_OK) {
+            status = SJA1105_SPI_ERROR;
+        } else {
+            status = sja1105_spi_wait(timeout);
+        }
+    }
+
+    else if (HAL_SPI_Receive(&SWCH_SPI, (uint8_t *) data, size, timeout) != HAL_OK) {
         status = SJA1105_SPI_ERROR;
     }
 
@@ -67,13 +174,43 @@ static sja1105_status_t sja1105_spi_transmit_receive(const uint32_t *tx_data, ui
 
     sja1105_status_t status = SJA1105_OK;
 
-    if (HAL_SPI_TransmitReceive(&SWCH_SPI, (uint8_t *) tx_data, (uint8_t *) rx_data, size, timeout) != HAL_OK) {
+    sja1105_spi_track(tx_data, size);
+
+    if (sja1105_spi_use_it(size)) {
+        sja1105_spi_error = false;
+        if (HAL_SPI_TransmitReceive_IT(&SWCH_SPI, (uint8_t *) tx_data, (uint8_t *) rx_data, size) != HAL_OK) {
+            status = SJA1105_SPI_ERROR;
+        } else {
+            status = sja1105_spi_wait(timeout);
+        }
+    }
+
+    else if (HAL_SPI_TransmitReceive(&SWCH_SPI, (uint8_t *) tx_data, (uint8_t *) rx_data, size, timeout) != HAL_OK) {
         status = SJA1105_SPI_ERROR;
     }
 
     return status;
 }
 
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi) {
+    if (hspi->Instance == SWCH_SPI.Instance) tx_semaphore_put(&sja1105_spi_semaphore_handle);
+}
+
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi) {
+    if (hspi->Instance == SWCH_SPI.Instance) tx_semaphore_put(&sja1105_spi_semaphore_handle);
+}
+
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi) {
+    if (hspi->Instance == SWCH_SPI.Instance) tx_semaphore_put(&sja1105_spi_semaphore_handle);
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi) {
+    if (hspi->Instance == SWCH_SPI.Instance) {
+        sja1105_spi_error = true;
+        tx_semaphore_put(&sja1105_spi_semaphore_handle);
+    }
+}
+
 static uint32_t sja1105_get_time_ms(void *context) {
 
     /* Use kernel time if it has been started */
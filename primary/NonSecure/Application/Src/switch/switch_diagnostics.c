@@ -5,6 +5,8 @@
  *      Author: bens1
  */
 
+#include "string.h"
+
 #include "zenoh-pico.h"
 #include "pb_encode.h"
 #include "switch.pb.h"
@@ -15,49 +17,157 @@
 #include "state_machine.h"
 #include "comms_thread.h"
 #include "phy_thread.h"
+#include "nx_app.h"
 
 
-#define SWITCH_STATS_BUFFER_SIZE (256)
+#define SWITCH_STATS_BUFFER_SIZE (448) /* Enough for a keyframe with every field of every port and pool */
 
 
-static pb_ostream_t       stream;
-static z_owned_encoding_t stats_encoding;
-static uint8_t            switch_stats_buffer[SWITCH_STATS_BUFFER_SIZE];
-static SwitchDiag         switch_diag = SwitchDiag_init_default;
+static pb_ostream_t stream;
+static uint8_t      switch_stats_buffer[SWITCH_STATS_BUFFER_SIZE];
+static SwitchDiag   switch_diag = SwitchDiag_init_default;
 
+/* Between keyframes only the ports and fields that differ from the last message handed to Zenoh are sent */
+static PortDiag ports_current[SJA1105_NUM_PORTS];
+static PortDiag ports_published[SJA1105_NUM_PORTS];
+static PoolDiag pools_current[NX_NUM_POOLS];
+static PoolDiag pools_published[NX_NUM_POOLS];
+static float    temp_published;
+static bool     temp_published_valid  = false;
+static bool     keyframe_needed       = true;
+static uint32_t deltas_since_keyframe = 0;
+static uint32_t sequence              = 0;
+static uint32_t published_generation  = 0; /* Session the last message was handed to */
 
-bool switch_stats_port_callback(pb_ostream_t *stream, const pb_field_t *field, void * const *arg) {
 
-    /* Read the port high level statistics counters from the switch chip */
+/* Read the latest values for every port into ports_current */
+static sja1105_status_t switch_stats_read(void) {
+
+    sja1105_status_t     status = SJA1105_OK;
     sja1105_statistics_t switch_stats;
-    if (SJA1105_ReadStatistics(&hsja1105, &switch_stats) != SJA1105_OK) Error_Handler();
+    bool                 forwarding;
+    phy_cable_result_t   cable;
+
+    /* Read the port high level statistics counters from the switch chip */
+    status = SJA1105_ReadStatistics(&hsja1105, &switch_stats);
+    if (status != SJA1105_OK) return status;
 
     /* Go through each port */
     for (port_index_t port_index = 0; port_index < SJA1105_NUM_PORTS; port_index++) {
 
-        /* Create the struct to store the port stats */
-        PortDiag port       = PortDiag_init_default;
-        bool     forwarding = false;
+        PortDiag *port = &ports_current[port_index];
+        *port          = (PortDiag) PortDiag_init_default;
 
-        /* Assign the port high level statistics */
-        port.rx_bytes           = switch_stats.rx_bytes[port_index];
-        port.has_rx_bytes       = true;
-        port.tx_bytes           = switch_stats.tx_bytes[port_index];
-        port.has_tx_bytes       = true;
-        port.dropped_frames     = switch_stats.dropped_frames[port_index];
-        port.has_dropped_frames = true;
+        /* Assign the port number and high level statistics */
+        PB_SET_FIELD((*port), index, port_index);
+        PB_SET_FIELD((*port), rx_bytes, switch_stats.rx_bytes[port_index]);
+        PB_SET_FIELD((*port), tx_bytes, switch_stats.tx_bytes[port_index]);
+        PB_SET_FIELD((*port), dropped_frames, switch_stats.dropped_frames[port_index]);
 
         /* Get and assign the port state */
-        if (SJA1105_PortGetForwarding(&hsja1105, port_index, &forwarding) != SJA1105_OK) Error_Handler();
-        port.state = forwarding ? PortState_FORWARDING : PortState_DISABLED;
+        status = SJA1105_PortGetForwarding(&hsja1105, port_index, &forwarding);
+        if (status != SJA1105_OK) return status;
+        port->state = forwarding ? PortState_FORWARDING : PortState_DISABLED;
 
         /* Assign the PHY temperature */
         if (port_index == PORT_HOST) {
-            port.has_phy_temp = false; /* TODO: Get this value from the DTS */
+            port->has_phy_temp = false; /* TODO: Get this value from the DTS */
         } else {
-            port.phy_temp     = phy_temperatures[port_index];
-            port.has_phy_temp = phy_temperatures_valid[port_index];
+            port->phy_temp     = phy_temperatures[port_index];
+            port->has_phy_temp = phy_temperatures_valid[port_index];
+        }
+
+        /* Assign the last cable test result */
+        if (port_index < PHY_NUM_88Q211X) {
+            phy_cable_result_get(port_index, &cable);
+            if (cable.valid) {
+                PB_SET_FIELD((*port), cable_state, cable.state);
+                PB_SET_FIELD((*port), cable_peak_distance, cable.peak_distance);
+                PB_SET_FIELD((*port), cable_test_time, cable.time);
+            }
         }
+    }
+
+    return status;
+}
+
+
+/* Read the latest packet pool usage into pools_current */
+static void switch_stats_pools_read(void) {
+
+    nx_pool_stats_t pool_stats[NX_NUM_POOLS];
+
+    nx_pool_stats_get(pool_stats);
+
+    for (nx_pool_index_t pool_index = 0; pool_index < NX_NUM_POOLS; pool_index++) {
+
+        PoolDiag *pool = &pools_current[pool_index];
+        *pool          = (PoolDiag) PoolDiag_init_default;
+
+        PB_SET_FIELD((*pool), index, pool_index);
+        PB_SET_FIELD((*pool), available, pool_stats[pool_index].available);
+        PB_SET_FIELD((*pool), low_watermark, pool_stats[pool_index].low_watermark);
+        PB_SET_FIELD((*pool), empty_requests, pool_stats[pool_index].empty_requests);
+    }
+}
+
+
+/* Returns true if a value that was published has since become unavailable. A delta can't express a field going
+ * missing so this needs a keyframe */
+static bool switch_stats_field_lost(void) {
+
+    if (temp_published_valid && !switch_temperature_valid) return true;
+
+    for (port_index_t port_index = 0; port_index < SJA1105_NUM_PORTS; port_index++) {
+        if (ports_published[port_index].has_phy_temp && !ports_current[port_index].has_phy_temp) return true;
+    }
+
+    return false;
+}
+
+
+/* Strip everything that hasn't changed out of a port. Returns false if nothing has changed and the port can be left
+ * out. The state is a required field so it is always sent with a changed port */
+static bool switch_stats_port_delta(PortDiag *port, const PortDiag *previous) {
+
+    port->has_rx_bytes       = port->rx_bytes != previous->rx_bytes;
+    port->has_tx_bytes       = port->tx_bytes != previous->tx_bytes;
+    port->has_dropped_frames = port->dropped_frames != previous->dropped_frames;
+    port->has_phy_temp       = port->has_phy_temp && (!previous->has_phy_temp || (port->phy_temp != previous->phy_temp));
+
+    /* A new cable test is sent as a whole */
+    if (port->has_cable_test_time && previous->has_cable_test_time && (port->cable_test_time == previous->cable_test_time)) {
+        port->has_cable_state         = false;
+        port->has_cable_peak_distance = false;
+        port->has_cable_test_time     = false;
+    }
+
+    return port->has_rx_bytes || port->has_tx_bytes || port->has_dropped_frames || port->has_phy_temp || port->has_cable_test_time || (port->state != previous->state);
+}
+
+
+/* Strip everything that hasn't changed out of a pool. Returns false if nothing has changed and the pool can be left
+ * out */
+static bool switch_stats_pool_delta(PoolDiag *pool, const PoolDiag *previous) {
+
+    pool->has_available      = pool->available != previous->available;
+    pool->has_low_watermark  = pool->low_watermark != previous->low_watermark;
+    pool->has_empty_requests = pool->empty_requests != previous->empty_requests;
+
+    return pool->has_available || pool->has_low_watermark || pool->has_empty_requests;
+}
+
+
+bool switch_stats_port_callback(pb_ostream_t *stream, const pb_field_t *field, void * const *arg) {
+
+    PortDiag port;
+
+    /* Go through each port */
+    for (port_index_t port_index = 0; port_index < SJA1105_NUM_PORTS; port_index++) {
+
+        /* Keyframes contain every port, deltas only the ports that changed */
+        port = ports_current[port_index];
+        if (!switch_diag.keyframe && !switch_stats_port_delta(&port, &ports_published[port_index])) continue;
 
         /* Encode this sub message */
         if (!pb_encode_tag_for_field(stream, field)) Error_Handler();
@@ -68,9 +178,32 @@ bool switch_stats_port_callback(pb_ostream_t *stream, const pb_field_t *field, v
 }
 
 
+bool switch_stats_pool_callback(pb_ostream_t *stream, const pb_field_t *field, void * const *arg) {
+
+    PoolDiag pool;
+
+    /* Go through each pool */
+    for (nx_pool_index_t pool_index = 0; pool_index < NX_NUM_POOLS; pool_index++) {
+
+        /* Keyframes contain every pool, deltas only the pools that changed */
+        pool = pools_current[pool_index];
+        if (!switch_diag.keyframe && !switch_stats_pool_delta(&pool, &pools_published[pool_index])) continue;
+
+        /* Encode this sub message */
+        if (!pb_encode_tag_for_field(stream, field)) Error_Handler();
+        if (!pb_encode_submessage(stream, PoolDiag_fields, &pool)) Error_Handler();
+    }
+
+    return true;
+}
+
+
 sja1105_status_t init_switch_diagnostics() {
     switch_diag.ports.funcs.encode = &switch_stats_port_callback;
     switch_diag.ports.arg          = NULL;
+    switch_diag.pools.funcs.encode = &switch_stats_pool_callback;
+    switch_diag.pools.arg          = NULL;
+    keyframe_needed                = true;
     return SJA1105_OK;
 }
 
@@ -80,6 +213,7 @@ sja1105_status_t publish_switch_diagnostics(uint32_t current_time) {
     sja1105_status_t sja_status = SJA1105_OK;
     tx_status_t      tx_status  = TX_SUCCESS;
     _z_res_t         z_status   = Z_OK;
+    uint32_t         generation = zenoh_session_generation;
     uint32_t         flags;
 
     /* Check if publishing stats is allowed */
@@ -88,15 +222,25 @@ sja1105_status_t publish_switch_diagnostics(uint32_t current_time) {
 
         /* Reset variables */
         stream = pb_ostream_from_buffer(switch_stats_buffer, SWITCH_STATS_BUFFER_SIZE);
-        z_owned_bytes_t           payload;
-        z_publisher_put_options_t options;
 
         /* Get the stats */
+        sja_status = switch_stats_read();
+        if (sja_status != SJA1105_OK) return sja_status;
+        switch_stats_pools_read();
+
+        /* A session can close and reopen between two publishes without this ever seeing it disconnected, so a new
+         * session is spotted by its generation too */
+        if (generation != published_generation) keyframe_needed = true;
+
+        /* Send everything after a (re)connection, periodically, or when a delta can't describe the change */
+        PB_SET_FIELD(switch_diag, keyframe, keyframe_needed || (deltas_since_keyframe >= SWITCH_STATS_KEYFRAME_INTERVAL) || switch_stats_field_lost());
+        PB_SET_FIELD(switch_diag, sequence, sequence);
+
         switch_diag.timestamp.seconds     = current_time / 1000;             /* TODO: Get from PTP */
         switch_diag.timestamp.nanoseconds = (current_time % 1000) * 1000000; /* TODO: Get from PTP */
         switch_diag.has_timestamp         = true;
         switch_diag.temp                  = switch_temperature;
-        switch_diag.has_temp              = switch_temperature_valid;
+        switch_diag.has_temp              = switch_temperature_valid && (switch_diag.keyframe || !temp_published_valid || (switch_temperature != temp_published));
 
         /* Encode the message */
         if (!pb_encode(&stream, SwitchDiag_fields, &switch_diag)) {
@@ -104,35 +248,49 @@ sja1105_status_t publish_switch_diagnostics(uint32_t current_time) {
             return sja_status;
         }
 
-        /* Convert into a Zenoh payload */
-        z_status = z_bytes_from_static_buf(&payload, switch_stats_buffer, stream.bytes_written);
-        if (z_status < Z_OK) tx_status = zenoh_disconnected(false);
-        if (tx_status != TX_SUCCESS) Error_Handler();
-
-
         /* Check if publishing stats is still allowed */
         tx_status = tx_event_flags_get(&state_machine_events_handle, STATE_MACHINE_ZENOH_CONNECTED, TX_OR, &flags, TX_NO_WAIT);
         if (tx_status == TX_SUCCESS) {
 
             /* Publish the message */
-            z_publisher_put_options_default(&options);
-            z_status = z_encoding_from_str(&stats_encoding, ENCODING_SWITCH_STATS);
-            if (z_status < Z_OK) tx_status = zenoh_disconnected(false);
-            if (tx_status != TX_SUCCESS) Error_Handler();
-            options.encoding = z_move(stats_encoding);
-            z_status         = z_publisher_put(z_loan(stats_pub), z_move(payload), &options);
+            z_status = zenoh_publication_put(&stats_publication, switch_stats_buffer, stream.bytes_written);
             if (z_status < Z_OK) tx_status = zenoh_disconnected(false);
             if (tx_status != TX_SUCCESS) Error_Handler();
+
+            /* The next delta is relative to what was just sent. If the put failed the session is being restarted
+             * and subscribers of the next one need a keyframe */
+            if (z_status >= Z_OK) {
+                memcpy(ports_published, ports_current, sizeof(ports_published));
+                memcpy(pools_published, pools_current, sizeof(pools_published));
+                temp_published        = switch_temperature;
+                temp_published_valid  = switch_temperature_valid;
+                deltas_since_keyframe = switch_diag.keyframe ? 0 : (deltas_since_keyframe + 1);
+                keyframe_needed       = false;
+                published_generation  = generation;
+                sequence++;
+            } else {
+                keyframe_needed = true;
+            }
+        }
+
+        /* Disconnected while encoding */
+        else if (tx_status == TX_NO_EVENTS) {
+            keyframe_needed = true;
         }
 
         /* Error occured */
-        else if (tx_status != TX_NO_EVENTS) {
+        else {
             sja_status = SJA1105_ERROR;
         }
     }
 
+    /* Not connected so start the next session with a keyframe */
+    else if (tx_status == TX_NO_EVENTS) {
+        keyframe_needed = true;
+    }
+
     /* Error occured */
-    else if (tx_status != TX_NO_EVENTS) {
+    else {
         sja_status = SJA1105_ERROR;
     }
 
@@ -15,6 +15,8 @@
 #include "sja1105.h"
 #include "sja1105q_default_conf.h"
 #include "utils.h"
+#include "scheduler.h"
+#include "nx_link_thread.h"
 
 
 uint8_t   switch_thread_stack[SWITCH_THREAD_STACK_SIZE];
@@ -25,71 +27,116 @@ float                switch_temperature;
 bool                 switch_temperature_valid;
 
 
-/* This thread perform regular maintenance for the switch and publishes periodic diagnostic messages */
-void switch_thread_entry(uint32_t initial_input) {
+/* Periodic jobs, phase spread so their SPI transfers don't all land in the same wakeup */
+static void switch_tables_job(void *arg);
+static void switch_tables_verify_job(void *arg);
+static void switch_status_job(void *arg);
+static void switch_temperature_job(void *arg);
+static void switch_publish_job(void *arg);
+
+static periodic_job_t switch_jobs[] = {
+    {.name = "Switch tables",        .function = switch_tables_job,        .period = SWITCH_MAINTENANCE_INTERVAL,   .phase = 0                                    },
+    {.name = "Switch tables verify", .function = switch_tables_verify_job, .period = SWITCH_TABLE_VERIFY_INTERVAL,  .phase = SWITCH_MAINTENANCE_INTERVAL * 3 / 4  },
+    {.name = "Switch status",        .function = switch_status_job,        .period = SWITCH_MAINTENANCE_INTERVAL,   .phase = SWITCH_MAINTENANCE_INTERVAL / 4      },
+    {.name = "Switch temperature",   .function = switch_temperature_job,   .period = SWITCH_TEMPERATURE_INTERVAL,   .phase = SWITCH_MAINTENANCE_INTERVAL / 2      },
+    {.name = "Switch publish stats", .function = switch_publish_job,       .period = SWITCH_PUBLISH_STATS_INTERVAL, .phase = SWITCH_PUBLISH_STATS_INTERVAL * 3 / 4},
+};
+
+static periodic_job_t *switch_jobs_heap[sizeof(switch_jobs) / sizeof(switch_jobs[0])];
+static scheduler_t     switch_scheduler;
+
+
+/* Re-read every table into the local copies. The reads go through the dynamic reconfiguration registers so they aren't
+ * tracked, otherwise they would mark the tables as dirty again. The flag is cleared first so a write from another
+ * thread during the read isn't lost */
+static void switch_tables_read(void) {
 
     sja1105_status_t status;
 
-    uint32_t current_time          = tx_time_get_ms();
-    uint32_t next_publish_time     = current_time;
-    uint32_t next_maintenance_time = current_time;
-    uint32_t next_wakeup           = 0;
+    sja1105_tables_dirty = false;
+    switch_spi_untracked_begin();
+    status = SJA1105_ReadAllTables(&hsja1105);
+    switch_spi_untracked_end();
+    if (status != SJA1105_OK) Error_Handler();
+}
 
-    switch_temperature       = 0.0;
-    switch_temperature_valid = false;
 
-    status = init_switch_diagnostics();
+/* Make sure local copies of tables match the copy on the switch chip (this doesn't check for differences, it only
+ * updates the internal copy). Only do this after something has been written to the switch, the verify job catches
+ * anything that has been missed */
+static void switch_tables_job(void *arg) {
+    if (sja1105_tables_dirty) switch_tables_read();
+}
+
+
+static void switch_tables_verify_job(void *arg) {
+    switch_tables_read();
+}
+
+
+static void switch_status_job(void *arg) {
+
+    sja1105_status_t status;
+
+    /* Check the status registers for issues */
+    if (SJA1105_CheckStatusRegisters(&hsja1105) != SJA1105_OK) Error_Handler(); // TODO: look into buffer shifting issue
+
+    /* Free any management routes that have been used. This goes through the L2 lookup reconfiguration registers too, but
+     * management routes are short lived so rather than re-read every table each time, anything they change in the local
+     * copies is left to the verify job */
+    switch_spi_untracked_begin();
+    status = SJA1105_ManagementRouteFree(&hsja1105, false);
+    switch_spi_untracked_end();
     if (status != SJA1105_OK) Error_Handler();
 
-    while (1) {
+    /* TODO: Occasionally check no important MAC addresses have been learned by accident (PTP, STP, etc) */
+}
 
-        current_time = tx_time_get_ms();
 
-        /* Check if maintenance is necessary */
-        if (current_time >= next_maintenance_time) {
-            next_maintenance_time += SWITCH_MAINTENANCE_INTERVAL;
+static void switch_temperature_job(void *arg) {
+    if (SJA1105_ReadTemperature(&hsja1105, &switch_temperature) != SJA1105_OK) Error_Handler();
+    switch_temperature_valid = true;
+}
+
 
-            /* Make sure local copies of tables match the copy on the switch chip (this doesn't check for differences, it only updates the internal copy) */
-            status = SJA1105_ReadAllTables(&hsja1105);
-            if (status != SJA1105_OK) Error_Handler();
+static void switch_publish_job(void *arg) {
+    if (publish_switch_diagnostics(tx_time_get_ms()) != SJA1105_OK) Error_Handler();
+}
 
-            /* Check the status registers for issues */
-            status = SJA1105_CheckStatusRegisters(&hsja1105); // TODO: look into buffer shifting issue
-            if (status != SJA1105_OK) Error_Handler();
 
-            /* Free any management routes that have been used */
-            status = SJA1105_ManagementRouteFree(&hsja1105, false);
-            if (status != SJA1105_OK) Error_Handler();
+/* This thread perform regular maintenance for the switch and publishes periodic diagnostic messages */
+void switch_thread_entry(uint32_t initial_input) {
 
-            /* TODO: Occasionally check no important MAC addresses have been learned by accident (PTP, STP, etc) */
+    sja1105_status_t status;
+    uint32_t         delay;
+    bool             initialised = false;
 
-            /* Read the temperature */
-            status = SJA1105_ReadTemperature(&hsja1105, &switch_temperature);
-            if (status != SJA1105_OK) Error_Handler();
-            switch_temperature_valid = true;
-        }
+    switch_temperature       = 0.0;
+    switch_temperature_valid = false;
 
-        /* Check if publishing diagnostics is necessary */
-        if (current_time >= next_publish_time) {
-            next_publish_time += SWITCH_PUBLISH_STATS_INTERVAL;
+    status = init_switch_diagnostics();
+    if (status != SJA1105_OK) Error_Handler();
 
-            /* Attempt to publish the diagnostics */
-            status = publish_switch_diagnostics(current_time);
-            if (status != SJA1105_OK) Error_Handler();
-        }
+    scheduler_init(&switch_scheduler, switch_jobs_heap, sizeof(switch_jobs_heap) / sizeof(switch_jobs_heap[0]));
+    for (uint_fast8_t i = 0; i < (sizeof(switch_jobs) / sizeof(switch_jobs[0])); i++) {
+        scheduler_add(&switch_scheduler, &switch_jobs[i], tx_time_get_ms());
+    }
 
-        /* Schedule the next wakeup */
-        next_wakeup = MIN(next_maintenance_time, next_publish_time);
-        if (current_time < next_wakeup) {
-            tx_thread_sleep_ms(next_wakeup - current_time);
-        }
+    while (1) {
 
-        /* Somehow we have gotten far behind so catch up */
-        else if ((current_time - next_wakeup) > (MAX(SWITCH_MAINTENANCE_INTERVAL, SWITCH_PUBLISH_STATS_INTERVAL) * 3)) {
-            next_maintenance_time = current_time;
-            next_publish_time     = current_time;
+        /* Run whatever is due and sleep until the next job */
+        scheduler_run(&switch_scheduler, tx_time_get_ms());
+
+        /* NetX only reports the link as up once the switch is initialised, wake the link thread whenever that changes
+         * rather than leaving it to the fallback check */
+        if (hsja1105.initialised != initialised) {
+            initialised = hsja1105.initialised;
+            if (tx_event_flags_set(&nx_link_events_handle, NX_LINK_SWITCH_EVENT, TX_OR) != TX_SUCCESS) Error_Handler();
         }
 
+        delay = scheduler_delay(&switch_scheduler, tx_time_get_ms());
+        if (delay > 0) tx_thread_sleep_ms(delay);
+
         /* TODO: If the current thread holds the switch mutex when it shouldn't report an error */
     }
 }
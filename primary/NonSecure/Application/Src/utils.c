@@ -42,6 +42,51 @@ uint32_t tx_time_get_ms() {
 }
 
 
+/* Sleep for whole ticks while at least a tick remains, then busy wait for the rest. tx_thread_sleep(n) can return up
+ * to a tick early but never late, so this doesn't oversleep (apart from being preempted) */
+void tx_thread_sleep_us(uint32_t us) {
+
+    uint64_t deadline = cycles_get() + ((uint64_t) us * CYCLES_PER_US);
+    uint64_t now      = cycles_get();
+    uint64_t remaining_us;
+
+    while (now < deadline) {
+        remaining_us = (deadline - now) / CYCLES_PER_US;
+        if (remaining_us >= (1000000 / TX_TIMER_TICKS_PER_SECOND)) {
+            tx_thread_sleep((ULONG) (remaining_us / (1000000 / TX_TIMER_TICKS_PER_SECOND)));
+        }
+        now = cycles_get();
+    }
+}
+
+
+/* DWT->CYCCNT (enabled in tx_initialize_low_level.S) extended to 64 bits. The 32-bit counter wraps every ~17s at
+ * 250MHz so this must be called more often than that, which the background thread guarantees */
+uint64_t cycles_get(void) {
+
+    TX_INTERRUPT_SAVE_AREA
+
+    static uint32_t last_cycles = 0;
+    static uint64_t wraps       = 0;
+
+    uint32_t cycles;
+    uint64_t ret;
+
+    TX_DISABLE
+    cycles = DWT->CYCCNT;
+    if (cycles < last_cycles) wraps += (1ULL << 32);
+    last_cycles = cycles;
+    ret         = wraps | cycles;
+    TX_RESTORE
+
+    return ret;
+}
+
+
+/* Monotonic microseconds since boot */
+uint64_t time_get_us(void) { return cycles_get() / CYCLES_PER_US; }
+
+
 void delay_ns(uint32_t ns) {
 
     /* CPU runs at 250MHz so one instruction is 4ns.
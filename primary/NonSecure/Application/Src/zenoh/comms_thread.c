@@ -21,6 +21,10 @@
 #include "encodings.h"
 #include "zenoh-pico.h"
 #include "zenoh_cleanup.h"
+#include "zenoh_memory.h"
+#include "zenoh_publication.h"
+#include "zenoh_random.h"
+#include "zenoh_udp.h"
 #include "comms_thread.h"
 #include "switch_thread.h"
 #include "state_machine.h"
@@ -46,10 +50,8 @@ static _Atomic heartbeat_state_t heartbeat_consumer_state     = HEARTBEAT_NOT_ST
 static uint8_t                   heartbeat_producer_buffer[HEARTBEAT_PB_H_MAX_SIZE];
 
 zenoh_event_counters_t zenoh_events;
-
-/* Publishers */
-z_owned_publisher_t        stats_pub;
-static z_owned_publisher_t heartbeat_pub;
+zenoh_locator_t        zenoh_last_locator;
+atomic_uint_fast32_t   zenoh_session_generation = 0;
 
 /* Publisher options */
 static const z_publisher_options_t heartbeat_pub_options = {
@@ -60,6 +62,19 @@ static const z_publisher_options_t heartbeat_pub_options = {
     .reliability        = Z_RELIABILITY_RELIABLE,
 };
 
+/* Publications */
+zenoh_publication_t stats_publication = {
+    .keyexpr  = ZENOH_PUB_STATS_KEYEXPR,
+    .encoding = ENCODING_SWITCH_STATS,
+    .options  = NULL,
+};
+
+static zenoh_publication_t heartbeat_publication = {
+    .keyexpr  = ZENOH_PUB_HEARTBEAT_KEYEXPR,
+    .encoding = ENCODING_HEARTBEAT,
+    .options  = &heartbeat_pub_options,
+};
+
 
 tx_status_t zenoh_connected(bool update_state_machine) {
 
@@ -95,6 +110,50 @@ void heartbeat_sub_callback(z_loaned_sample_t *sample, void *ctx) {
 }
 
 
+
+/* Declarations made on every new session */
+typedef struct {
+    const char *keyexpr;
+    void (*callback)(z_loaned_sample_t *sample, void *ctx);
+} comms_subscriber_t;
+
+static zenoh_publication_t * const comms_publications[] = {
+    &stats_publication,
+    &heartbeat_publication,
+};
+
+static const comms_subscriber_t comms_subscribers[] = {
+    {ZENOH_SUB_HEARTBEAT_KEYEXPR, heartbeat_sub_callback},
+};
+
+
+/* Declare every publication and (background) subscriber in the tables above */
+static _z_res_t comms_declare_all(const z_loaned_session_t *session) {
+
+    _z_res_t z_status = Z_OK;
+
+    z_owned_keyexpr_t        key;
+    z_view_keyexpr_t         view_key;
+    z_owned_closure_sample_t closure;
+
+    for (uint_fast8_t i = 0; i < (sizeof(comms_publications) / sizeof(comms_publications[0])); i++) {
+        z_status = zenoh_publication_declare(session, comms_publications[i]);
+        if (z_status < Z_OK) return z_status;
+    }
+
+    for (uint_fast8_t i = 0; i < (sizeof(comms_subscribers) / sizeof(comms_subscribers[0])); i++) {
+        z_view_keyexpr_from_str(&view_key, comms_subscribers[i].keyexpr);
+        z_status = z_declare_keyexpr(session, &key, z_loan(view_key));
+        if (z_status < Z_OK) return z_status;
+        z_closure(&closure, comms_subscribers[i].callback, NULL, NULL);
+        z_status = z_declare_background_subscriber(session, z_loan(key), z_move(closure), NULL);
+        if (z_status < Z_OK) return z_status;
+    }
+
+    return z_status;
+}
+
+
 /* This thread manages the Zenoh Pico session initialisation, reconnection and heartbeats */
 void comms_thread_entry(uint32_t initial_input) {
 
@@ -105,14 +164,18 @@ void comms_thread_entry(uint32_t initial_input) {
     uint32_t    failure_streak        = 0;
     bool        failure_streak_valid  = false;
     uint32_t    current_time          = tx_time_get_ms();
+    uint32_t    direct_reconnects_left = 0;     /* Attempts left to connect to router_locator before scouting again */
+    bool        direct_reconnect       = false; /* This attempt is connecting straight to router_locator */
+
+    zenoh_locator_t router_locator = {0};
+    char            router_locator_str[32];
 
     Heartbeat    heartbeat = Heartbeat_init_zero;
     pb_ostream_t heartbeat_stream;
 
-    z_owned_encoding_t heartbeat_encoding;
-
     memset(&zenoh_events, 0, sizeof(zenoh_event_counters_t));
     memset(zenoh_udp_multicast_groups_valid, 0, sizeof(zenoh_udp_multicast_groups_valid));
+    zenoh_udp_buffers_init();
 
     while (1) {
 
@@ -120,11 +183,16 @@ void comms_thread_entry(uint32_t initial_input) {
         tx_status                = TX_SUCCESS;
         z_status                 = Z_OK;
         session_open             = false;
+        direct_reconnect         = false;
         heartbeat_consumer_state = HEARTBEAT_NOT_STARTED;
 
         /* Initialise the byte pool */
         tx_status = tx_byte_pool_create(&zenoh_byte_pool, "Zenoh Pico memory pool", zenoh_byte_pool_buffer, ZENOH_MEM_POOL_SIZE);
         if (tx_status != TX_SUCCESS) Error_Handler();
+        zenoh_memory_init();
+
+        /* Reseed the random generator from the hardware RNG so session IDs differ across restarts and reboots */
+        zenoh_random_seed();
 
         /* Read and apply the config */
         z_owned_config_t config;
@@ -132,7 +200,18 @@ void comms_thread_entry(uint32_t initial_input) {
         if (z_status < Z_OK) Error_Handler();
         z_status = zp_config_insert(z_loan_mut(config), Z_CONFIG_MODE_KEY, ZENOH_MODE);
         if (z_status < Z_OK) Error_Handler();
-        if (strcmp(ZENOH_LOCATOR, "") != 0) {
+        if (direct_reconnects_left > 0) {
+
+            /* The session dropped after it was open, so go straight back to the same router instead of scouting. Only
+             * the scouting is skipped, the session is still rebuilt from nothing like any other restart */
+            snprintf(router_locator_str, sizeof(router_locator_str), "%s/%lu.%lu.%lu.%lu:%u", router_locator.protocol,
+                     (router_locator.ip_address >> 24) & 0xff, (router_locator.ip_address >> 16) & 0xff,
+                     (router_locator.ip_address >> 8) & 0xff, router_locator.ip_address & 0xff, router_locator.port);
+            z_status = zp_config_insert(z_loan_mut(config), Z_CONFIG_CONNECT_KEY, router_locator_str);
+            if (z_status < Z_OK) Error_Handler();
+            direct_reconnects_left--;
+            direct_reconnect = true;
+        } else if (strcmp(ZENOH_LOCATOR, "") != 0) {
             if (strcmp(ZENOH_MODE, Z_CONFIG_MODE_CLIENT) == 0) {
                 z_status = zp_config_insert(z_loan_mut(config), Z_CONFIG_CONNECT_KEY, ZENOH_LOCATOR);
                 if (z_status < Z_OK) Error_Handler();
@@ -147,17 +226,27 @@ void comms_thread_entry(uint32_t initial_input) {
         z_open_options_default(&opts);
 
         /* Start a session */
-        log_write("Zenoh Pico: Attempting to open session\n");
+        if (direct_reconnect) {
+            log_write("Zenoh Pico: Attempting to open session directly with %s\n", router_locator_str);
+        } else {
+            log_write("Zenoh Pico: Attempting to open session\n");
+        }
         z_owned_session_t session;
+        zenoh_last_locator.protocol = NULL;
         do {
 
-            /* Attempt to open session */
+            /* Attempt to open session. Any UDP link opened along the way arms the transport buffer provider for
+             * this thread, it must not keep handing out packets once the session exists */
             z_status = z_open(&session, z_move(config), &opts);
+            zenoh_udp_buffer_provider_disarm();
 
             /* Session open */
             if (z_status == Z_OK) {
+                zenoh_session_generation++;
                 failure_streak       = 0;
                 failure_streak_valid = false;
+                router_locator       = zenoh_last_locator;
+                direct_reconnects_left = 0;
                 break;
             }
 
@@ -180,6 +269,13 @@ void comms_thread_entry(uint32_t initial_input) {
                 goto retry;
             }
 
+            /* The router that was just lost isn't back (yet). Try it again and scout once the attempts run out */
+            else if (direct_reconnect) {
+                log_write("Zenoh Pico: Failed to open session directly with %s, error code %i\n", router_locator_str, z_status);
+                failure_streak_valid = false;
+                goto retry;
+            }
+
             /* Unhandled error */
             else {
                 Error_Handler();
@@ -189,34 +285,12 @@ void comms_thread_entry(uint32_t initial_input) {
 
         log_write("Zenoh Pico: Session opened\n");
 
-        /* Declare stats publisher */
-        z_owned_keyexpr_t stats_pub_key;
-        z_view_keyexpr_t  stats_pub_view_key;
-        z_view_keyexpr_from_str(&stats_pub_view_key, ZENOH_PUB_STATS_KEYEXPR);
-        z_status = z_declare_keyexpr(z_loan(session), &stats_pub_key, z_loan(stats_pub_view_key));
-        if (z_status < Z_OK) Error_Handler();
-        z_status = z_declare_publisher(z_loan(session), &stats_pub, z_loan(stats_pub_key), NULL);
-        if (z_status < Z_OK) Error_Handler();
-
-        /* Declare heartbeat publisher */
-        z_owned_keyexpr_t heartbeat_pub_key;
-        z_view_keyexpr_t  heartbeat_pub_view_key;
-        z_view_keyexpr_from_str(&heartbeat_pub_view_key, ZENOH_PUB_HEARTBEAT_KEYEXPR);
-        z_status = z_declare_keyexpr(z_loan(session), &heartbeat_pub_key, z_loan(heartbeat_pub_view_key));
-        if (z_status < Z_OK) Error_Handler();
-        z_status = z_declare_publisher(z_loan(session), &heartbeat_pub, z_loan(heartbeat_pub_key), &heartbeat_pub_options);
-        if (z_status < Z_OK) Error_Handler();
-
-        /* Declare heartbeat background subscriber */
-        z_owned_keyexpr_t heartbeat_sub_key;
-        z_view_keyexpr_t  heartbeat_sub_view_key;
-        z_view_keyexpr_from_str(&heartbeat_sub_view_key, ZENOH_SUB_HEARTBEAT_KEYEXPR);
-        z_status = z_declare_keyexpr(z_loan(session), &heartbeat_sub_key, z_loan(heartbeat_sub_view_key));
-        if (z_status < Z_OK) Error_Handler();
-        z_owned_closure_sample_t heartbeat_closure;
-        z_closure(&heartbeat_closure, heartbeat_sub_callback, NULL, NULL);
-        z_status = z_declare_background_subscriber(z_loan(session), z_loan(heartbeat_sub_key), z_move(heartbeat_closure), NULL);
-        if (z_status < Z_OK) Error_Handler();
+        /* Declare the publishers and subscribers */
+        z_status = comms_declare_all(z_loan(session));
+        if (z_status < Z_OK) {
+            log_write("Zenoh Pico: Failed to declare resources, error code %i\n", z_status);
+            goto close;
+        }
 
         /* Notify the state machine that we are connected and ready to communicate */
         tx_status = zenoh_connected(true);
@@ -230,6 +304,9 @@ void comms_thread_entry(uint32_t initial_input) {
 
             current_time = tx_time_get_ms();
 
+            /* Log the allocations traced since the last heartbeat, if ZENOH_MEM_TRACE is enabled */
+            zenoh_memory_trace_log();
+
             /* Check if the server heartbeat has stopped.
              * If it has then record the error. Since the internal state
              * of the session is still intact (heartbeat miss is an
@@ -250,17 +327,9 @@ void comms_thread_entry(uint32_t initial_input) {
             heartbeat.error_code     = 0;                /* TODO: Send error code */
             heartbeat.has_error_code = false;            /* TODO: Send error code */
             if (!pb_encode(&heartbeat_stream, Heartbeat_fields, &heartbeat)) Error_Handler();
-            z_owned_bytes_t payload;
-            z_status = z_bytes_from_static_buf(&payload, heartbeat_producer_buffer, heartbeat_stream.bytes_written);
-            if (z_status < Z_OK) goto restart;
 
             /* Publish heartbeat message */
-            z_publisher_put_options_t options;
-            z_publisher_put_options_default(&options);
-            z_status = z_encoding_from_str(&heartbeat_encoding, ENCODING_HEARTBEAT);
-            if (z_status < Z_OK) Error_Handler();
-            options.encoding = z_move(heartbeat_encoding);
-            z_status         = z_publisher_put(z_loan(heartbeat_pub), z_move(payload), &options);
+            z_status = zenoh_publication_put(&heartbeat_publication, heartbeat_producer_buffer, heartbeat_stream.bytes_written);
             if (z_status < Z_OK) goto restart;
 
             /* Sleep for HEARTBEAT_INTERVAL ms. If the STATE_MACHINE_ZENOH_DISCONNECTED flag
@@ -293,6 +362,13 @@ void comms_thread_entry(uint32_t initial_input) {
 
         zenoh_events.restarts++;
 
+        /* The session was open so the router is known. Try to go straight back to it rather than scouting. Zenoh Pico
+         * can only reopen a transport under an existing session with Z_FEATURE_AUTO_RECONNECT, so the sockets, tasks,
+         * memory pool and declarations are all torn down below and recreated as usual */
+        if ((router_locator.protocol != NULL) && (strcmp(ZENOH_MODE, Z_CONFIG_MODE_CLIENT) == 0)) {
+            direct_reconnects_left = ZENOH_DIRECT_RECONNECT_ATTEMPTS;
+        }
+
         /* Notify the state machine */
         tx_status = zenoh_disconnected(true);
         if (tx_status != TX_SUCCESS) Error_Handler();
@@ -312,7 +388,9 @@ void comms_thread_entry(uint32_t initial_input) {
         /* Leave all multicast groups and delete all sockets created by Zenoh Pico */
         zenoh_cleanup_nx();
 
-        /* Delete the byte pool */
+        /* Delete the block pools and the byte pool, the allocations still traced are logged first */
+        zenoh_memory_trace_log();
+        zenoh_memory_deinit();
         tx_status = tx_byte_pool_delete(&zenoh_byte_pool);
         if (tx_status != TX_SUCCESS) Error_Handler();
 
@@ -321,6 +399,8 @@ void comms_thread_entry(uint32_t initial_input) {
         /* Break after termination before restarting. If there are many back to back attempts then wait for any leases to expire */
         if (failure_streak && !(failure_streak % ZENOH_MAX_RETRIES_BEFORE_LONG_PAUSE) && failure_streak_valid) {
             z_sleep_ms(Z_TRANSPORT_LEASE);
+        } else if (direct_reconnects_left > 0) {
+            z_sleep_ms(ZENOH_DIRECT_RECONNECT_INTERVAL);
         } else {
             z_sleep_ms(ZENOH_OPEN_SESSION_INTERVAL);
         }
@@ -9,6 +9,7 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "tx_api.h"
 #include "main.h"
@@ -20,48 +21,89 @@
 #include "config.h"
 #include "tx_app.h"
 #include "comms_thread.h"
+#include "zenoh_memory.h"
+#include "zenoh_random.h"
+#include "zenoh_udp.h"
 
 
 /*------------------ Random ------------------*/
-uint8_t z_random_u8(void) { return z_random_u32(); }
+uint8_t z_random_u8(void) {
+    uint8_t ret;
+    zenoh_random_fill(&ret, sizeof(ret));
+    return ret;
+}
 
-uint16_t z_random_u16(void) { return z_random_u32(); }
+uint16_t z_random_u16(void) {
+    uint16_t ret;
+    zenoh_random_fill(&ret, sizeof(ret));
+    return ret;
+}
 
-uint32_t z_random_u32(void) { return random(); }
+uint32_t z_random_u32(void) {
+    uint32_t ret;
+    zenoh_random_fill(&ret, sizeof(ret));
+    return ret;
+}
 
 uint64_t z_random_u64(void) {
-    uint64_t ret  = 0;
-    ret          |= z_random_u32();
-    ret           = ret << 32;
-    ret          |= z_random_u32();
+    uint64_t ret;
+    zenoh_random_fill(&ret, sizeof(ret));
     return ret;
 }
 
-void z_random_fill(void *buf, size_t len) {
-    for (size_t i = 0; i < len; i++) {
-        ((uint8_t *) buf)[i] = z_random_u8();
-    }
-}
+void z_random_fill(void *buf, size_t len) { zenoh_random_fill(buf, len); }
 
 /*------------------ Memory ------------------*/
 void *z_malloc(size_t size) {
     void *ptr = NULL;
 
-    uint8_t r = tx_byte_allocate(&zenoh_byte_pool, &ptr, size, TX_WAIT_FOREVER);
-    if (r != TX_SUCCESS) {
-        ptr = NULL;
-        Error_Handler();
-    }
+#if Z_FEATURE_LINK_UDP_UNICAST == 1 || Z_FEATURE_LINK_UDP_MULTICAST == 1
+    /* Put transport buffers directly in NX_PACKETs so they can be sent without copying. This only happens while a UDP
+     * link is being opened, see zenoh_udp_buffer_provider_arm() */
+    ptr = zenoh_udp_buffer_acquire(size);
+    if (ptr != NULL) return ptr;
+#endif
+
+    ptr = zenoh_memory_allocate(size);
+    if (ptr == NULL) Error_Handler();
     return ptr;
 }
 
 void *z_realloc(void *ptr, size_t size) {
-    // realloc not implemented
-    return NULL;
+    void  *new_ptr  = NULL;
+    size_t old_size = 0;
+
+    if (ptr == NULL) return z_malloc(size);
+    if (size == 0) {
+        z_free(ptr);
+        return NULL;
+    }
+
+#if Z_FEATURE_LINK_UDP_UNICAST == 1 || Z_FEATURE_LINK_UDP_MULTICAST == 1
+    /* Transport buffers are already as big as a batch and can't be resized */
+    old_size = zenoh_udp_buffer_size(ptr);
+    if ((old_size != 0) && (size <= old_size)) return ptr;
+#endif
+
+    /* Keep the block if it still fits its size class, otherwise allocate, copy and free */
+    if (old_size == 0) {
+        if (zenoh_memory_resize(ptr, size)) return ptr;
+        old_size = zenoh_memory_usable_size(ptr);
+    }
+
+    /* Like realloc the old block is left alone if there is no room for the new one */
+    new_ptr = z_malloc(size);
+    if (new_ptr == NULL) return NULL;
+    memcpy(new_ptr, ptr, (old_size < size) ? old_size : size);
+    z_free(ptr);
+    return new_ptr;
 }
 
 void z_free(void *ptr) {
-    tx_byte_release(ptr);
+#if Z_FEATURE_LINK_UDP_UNICAST == 1 || Z_FEATURE_LINK_UDP_MULTICAST == 1
+    if (zenoh_udp_buffer_release(ptr)) return;
+#endif
+    zenoh_memory_release(ptr);
 }
 
 void z_free_with_context(void *data, void *context) {
@@ -188,27 +230,21 @@ z_result_t _z_mutex_rec_lock(_z_mutex_rec_t *m) { return _z_mutex_lock(m); }
 z_result_t _z_mutex_rec_unlock(_z_mutex_rec_t *m) { return _z_mutex_unlock(m); }
 
 /*------------------ CondVar ------------------*/
-#define CONDVAR_MAX_WAITERS_COUNT 0xff;
+
+/* The waiter count is protected by disabling interrupts rather than a mutex, so a signal costs no more than a
+ * semaphore put. The count is decremented and the semaphore put in one critical section, so a waiter that times out
+ * can tell whether it was signalled in the meantime from the semaphore count */
 
 z_result_t _z_condvar_init(_z_condvar_t *cv) {
     if (!cv) {
         return _Z_ERR_GENERIC;
     }
 
-    _z_res_t z_status = Z_OK;
+    cv->waiters = 0;
 
-    /* Create mutex and semaphore */
-    UINT m_status = tx_mutex_create(&cv->mutex, TX_NULL, TX_INHERIT);
-    UINT s_status = tx_semaphore_create(&cv->sem, TX_NULL, 0);
-    cv->waiters   = 0;
-
-    /* Check for errors */
-    if (m_status != TX_SUCCESS || s_status != TX_SUCCESS) {
-        z_status = _Z_ERR_GENERIC;
-        return z_status;
-    }
+    if (tx_semaphore_create(&cv->sem, TX_NULL, 0) != TX_SUCCESS) return _Z_ERR_GENERIC;
 
-    return z_status;
+    return _Z_RES_OK;
 }
 
 z_result_t _z_condvar_drop(_z_condvar_t *cv) {
@@ -216,15 +252,9 @@ z_result_t _z_condvar_drop(_z_condvar_t *cv) {
         return _Z_ERR_GENERIC;
     }
 
-    _z_res_t    z_status  = Z_OK;
-    tx_status_t tx_status = TX_SUCCESS;
+    if (tx_semaphore_delete(&cv->sem) != TX_SUCCESS) return _Z_ERR_GENERIC;
 
-    tx_status = tx_mutex_delete(&cv->mutex);
-    if (tx_status != TX_SUCCESS) z_status = _Z_ERR_GENERIC;
-    tx_status = tx_semaphore_delete(&cv->sem);
-    if (tx_status != TX_SUCCESS) z_status = _Z_ERR_GENERIC;
-
-    return z_status;
+    return _Z_RES_OK;
 }
 
 z_result_t _z_condvar_signal(_z_condvar_t *cv) {
@@ -232,12 +262,14 @@ z_result_t _z_condvar_signal(_z_condvar_t *cv) {
         return _Z_ERR_GENERIC;
     }
 
-    tx_mutex_get(&cv->mutex, TX_WAIT_FOREVER);
+    TX_INTERRUPT_SAVE_AREA
+
+    TX_DISABLE
     if (cv->waiters > 0) {
-        tx_semaphore_put(&cv->sem);
         cv->waiters--;
+        tx_semaphore_put(&cv->sem);
     }
-    tx_mutex_put(&cv->mutex);
+    TX_RESTORE
 
     return _Z_RES_OK;
 }
@@ -247,58 +279,73 @@ z_result_t _z_condvar_signal_all(_z_condvar_t *cv) {
         return _Z_ERR_GENERIC;
     }
 
-    tx_mutex_get(&cv->mutex, TX_WAIT_FOREVER);
+    TX_INTERRUPT_SAVE_AREA
+
+    TX_DISABLE
     while (cv->waiters > 0) {
-        tx_semaphore_put(&cv->sem);
         cv->waiters--;
+        tx_semaphore_put(&cv->sem);
     }
-    tx_mutex_put(&cv->mutex);
+    TX_RESTORE
 
     return _Z_RES_OK;
 }
 
-z_result_t _z_condvar_wait(_z_condvar_t *cv, _z_mutex_t *m) {
-    if (!cv || !m) {
-        return _Z_ERR_GENERIC;
-    }
+/* Wait for up to timeout ticks. Returns false if it timed out without being signalled */
+static bool _z_condvar_wait_ticks(_z_condvar_t *cv, _z_mutex_t *m, ULONG timeout) {
+
+    TX_INTERRUPT_SAVE_AREA
+
+    bool signalled;
 
-    tx_mutex_get(&cv->mutex, TX_WAIT_FOREVER);
+    TX_DISABLE
     cv->waiters++;
-    tx_mutex_put(&cv->mutex);
+    TX_RESTORE
 
     _z_mutex_unlock(m);
-    tx_semaphore_get(&cv->sem, TX_WAIT_FOREVER);
+
+    signalled = tx_semaphore_get(&cv->sem, timeout) == TX_SUCCESS;
+
+    /* A signal that arrived after the timeout left the count on the semaphore. Take it, otherwise remove ourself as
+     * a waiter */
+    if (!signalled) {
+        TX_DISABLE
+        if (cv->sem.tx_semaphore_count > 0) {
+            signalled = tx_semaphore_get(&cv->sem, TX_NO_WAIT) == TX_SUCCESS;
+        } else {
+            cv->waiters--;
+        }
+        TX_RESTORE
+    }
 
     _z_mutex_lock(m);
 
-    return _Z_RES_OK;
+    return signalled;
 }
 
-z_result_t _z_condvar_wait_until(_z_condvar_t *cv, _z_mutex_t *m, const z_clock_t *abstime) {
+z_result_t _z_condvar_wait(_z_condvar_t *cv, _z_mutex_t *m) {
     if (!cv || !m) {
         return _Z_ERR_GENERIC;
     }
 
-    ULONG now            = tx_time_get();
-    ULONG target_time    = (abstime->second_low * 1000 + abstime->nanosecond / 1000000) * (TX_TIMER_TICKS_PER_SECOND / 1000);
-    ULONG block_duration = (target_time > now) ? (target_time - now) : 0;
+    _z_condvar_wait_ticks(cv, m, TX_WAIT_FOREVER);
 
-    tx_mutex_get(&cv->mutex, TX_WAIT_FOREVER);
-    cv->waiters++;
-    tx_mutex_put(&cv->mutex);
+    return _Z_RES_OK;
+}
 
-    _z_mutex_unlock(m);
+z_result_t _z_condvar_wait_until(_z_condvar_t *cv, _z_mutex_t *m, const z_clock_t *abstime) {
+    if (!cv || !m) {
+        return _Z_ERR_GENERIC;
+    }
 
-    bool timed_out = tx_semaphore_get(&cv->sem, block_duration) != TX_SUCCESS;
+    /* Round up to whole ticks so the wait doesn't end before abstime */
+    uint64_t deadline_us = ((((uint64_t) abstime->second_high << 32) | abstime->second_low) * 1000000) + (abstime->nanosecond / 1000);
+    uint64_t now_us      = time_get_us();
+    uint64_t ticks       = (deadline_us > now_us) ? (((deadline_us - now_us) * TX_TIMER_TICKS_PER_SECOND) + 999999) / 1000000 : 0;
 
-    _z_mutex_lock(m);
+    if (ticks >= TX_WAIT_FOREVER) ticks = TX_WAIT_FOREVER - 1;
 
-    if (timed_out) {
-        tx_mutex_get(&cv->mutex, TX_WAIT_FOREVER);
-        cv->waiters--;
-        tx_mutex_put(&cv->mutex);
-        return Z_ETIMEDOUT;
-    }
+    if (!_z_condvar_wait_ticks(cv, m, (ULONG) ticks)) return Z_ETIMEDOUT;
 
     return _Z_RES_OK;
 }
@@ -306,7 +353,7 @@ z_result_t _z_condvar_wait_until(_z_condvar_t *cv, _z_mutex_t *m, const z_clock_
 
 /*------------------ Sleep ------------------*/
 z_result_t z_sleep_us(size_t time) {
-    tx_thread_sleep_ms(time / 1000);
+    tx_thread_sleep_us(time);
     return _Z_RES_OK;
 }
 
@@ -322,10 +369,12 @@ z_result_t z_sleep_s(size_t time) {
 
 /*------------------ Clock ------------------*/
 
+/* Monotonic time since boot from the cycle counter */
 void __z_clock_gettime(z_clock_t *ts) {
-    uint64_t ms    = tx_time_get_ms();
-    ts->second_low = ms / (uint64_t) 1000;
-    ts->nanosecond = (ms % (uint64_t) 1000) * (uint64_t) 1000;
+    uint64_t us     = time_get_us();
+    ts->second_high = 0;
+    ts->second_low  = us / (uint64_t) 1000000;
+    ts->nanosecond  = (us % (uint64_t) 1000000) * (uint64_t) 1000;
 }
 
 z_clock_t z_clock_now(void) {
@@ -396,7 +445,7 @@ unsigned long z_time_elapsed_ms(z_time_t *time) {
     return (tx_time_get() - *time) * 1000ULL / TX_TIMER_TICKS_PER_SECOND;
 }
 
-unsigned long z_time_elapsed_s(z_time_t *time) { return (tx_time_get() - *time) * TX_TIMER_TICKS_PER_SECOND; }
+unsigned long z_time_elapsed_s(z_time_t *time) { return (tx_time_get() - *time) / TX_TIMER_TICKS_PER_SECOND; }
 
 z_result_t _z_get_time_since_epoch(_z_time_since_epoch *t) {
     ULONG64 time_ns = tx_time_get() * 1000000000ULL / TX_TIMER_TICKS_PER_SECOND;
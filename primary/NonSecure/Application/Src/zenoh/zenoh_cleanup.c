@@ -13,6 +13,8 @@
 #include "main.h"
 
 #include "zenoh_cleanup.h"
+#include "zenoh_udp.h"
+#include "zenoh_tcp.h"
 #include "comms_thread.h"
 #include "tx_app.h"
 #include "nx_app.h"
@@ -22,56 +24,62 @@ atomic_bool       zenoh_udp_multicast_groups_valid[NX_MAX_MULTICAST_GROUPS];
 volatile uint32_t zenoh_udp_multicast_groups_list[NX_MAX_MULTICAST_GROUPS];
 
 
+/* Deleting an object unlinks it from its created list and can move the list head, so each list is walked once using
+ * the count from before anything was deleted, picking up the next object before the current one can be deleted */
 void zenoh_cleanup_tx() {
 
-    tx_status_t status = TX_SUCCESS;
-
-    if (_tx_thread_created_count > 0) {
-        TX_THREAD *current_thread = _tx_thread_created_ptr;
-        TX_THREAD *next_thread    = current_thread->tx_thread_created_next;
-        do {
-            if (((uint8_t *) current_thread >= zenoh_byte_pool_buffer) && ((uint8_t *) current_thread < (zenoh_byte_pool_buffer + ZENOH_MEM_POOL_SIZE))) {
-                status = tx_thread_terminate(current_thread);
-                if (status != TX_SUCCESS) Error_Handler();
-                status = tx_thread_delete(current_thread);
-                if (status != TX_SUCCESS) Error_Handler();
-            }
-            current_thread = next_thread;
-            next_thread    = current_thread->tx_thread_created_next;
-        } while ((current_thread != _tx_thread_created_ptr) && (_tx_thread_created_count > 0));
+    tx_status_t   status     = TX_SUCCESS;
+    TX_THREAD    *thread     = _tx_thread_created_ptr;
+    ULONG         threads    = _tx_thread_created_count;
+    TX_MUTEX     *mutex      = _tx_mutex_created_ptr;
+    ULONG         mutexes    = _tx_mutex_created_count;
+    TX_SEMAPHORE *semaphore  = _tx_semaphore_created_ptr;
+    ULONG         semaphores = _tx_semaphore_created_count;
+    TX_THREAD    *next_thread;
+    TX_MUTEX     *next_mutex;
+    TX_SEMAPHORE *next_semaphore;
+
+    for (ULONG i = 0; i < threads; i++) {
+        next_thread = thread->tx_thread_created_next;
+        if (((uint8_t *) thread >= zenoh_byte_pool_buffer) && ((uint8_t *) thread < (zenoh_byte_pool_buffer + ZENOH_MEM_POOL_SIZE))) {
+            status = tx_thread_terminate(thread);
+            if (status != TX_SUCCESS) Error_Handler();
+            status = tx_thread_delete(thread);
+            if (status != TX_SUCCESS) Error_Handler();
+        }
+        thread = next_thread;
     }
 
-    if (_tx_mutex_created_count > 0) {
-        TX_MUTEX *current_mutex = _tx_mutex_created_ptr;
-        TX_MUTEX *next_mutex    = current_mutex->tx_mutex_created_next;
-        do {
-            if (((uint8_t *) current_mutex >= zenoh_byte_pool_buffer) && ((uint8_t *) current_mutex < (zenoh_byte_pool_buffer + ZENOH_MEM_POOL_SIZE))) {
-                status = tx_mutex_delete(current_mutex);
-                if (status != TX_SUCCESS) Error_Handler();
-            }
-            current_mutex = next_mutex;
-            next_mutex    = current_mutex->tx_mutex_created_next;
-        } while ((current_mutex != _tx_mutex_created_ptr) && (_tx_mutex_created_count > 0));
+    for (ULONG i = 0; i < mutexes; i++) {
+        next_mutex = mutex->tx_mutex_created_next;
+        if (((uint8_t *) mutex >= zenoh_byte_pool_buffer) && ((uint8_t *) mutex < (zenoh_byte_pool_buffer + ZENOH_MEM_POOL_SIZE))) {
+            status = tx_mutex_delete(mutex);
+            if (status != TX_SUCCESS) Error_Handler();
+        }
+        mutex = next_mutex;
     }
 
-    if (_tx_semaphore_created_count > 0) {
-        TX_SEMAPHORE *current_semaphore = _tx_semaphore_created_ptr;
-        TX_SEMAPHORE *next_semaphore    = current_semaphore->tx_semaphore_created_next;
-        do {
-            if (((uint8_t *) current_semaphore >= zenoh_byte_pool_buffer) && ((uint8_t *) current_semaphore < (zenoh_byte_pool_buffer + ZENOH_MEM_POOL_SIZE))) {
-                status = tx_semaphore_delete(current_semaphore);
-                if (status != TX_SUCCESS) Error_Handler();
-            }
-            current_semaphore = next_semaphore;
-            next_semaphore    = current_semaphore->tx_semaphore_created_next;
-        } while ((current_semaphore != _tx_semaphore_created_ptr) && (_tx_semaphore_created_count > 0));
+    for (ULONG i = 0; i < semaphores; i++) {
+        next_semaphore = semaphore->tx_semaphore_created_next;
+        if (((uint8_t *) semaphore >= zenoh_byte_pool_buffer) && ((uint8_t *) semaphore < (zenoh_byte_pool_buffer + ZENOH_MEM_POOL_SIZE))) {
+            status = tx_semaphore_delete(semaphore);
+            if (status != TX_SUCCESS) Error_Handler();
+        }
+        semaphore = next_semaphore;
     }
 }
 
 
+/* The socket lists are walked the same way as in zenoh_cleanup_tx() */
 void zenoh_cleanup_nx() {
 
-    nx_status_t status = NX_SUCCESS;
+    nx_status_t    status      = NX_SUCCESS;
+    NX_UDP_SOCKET *udp_socket  = nx_ip_instance.nx_ip_udp_created_sockets_ptr;
+    ULONG          udp_sockets = nx_ip_instance.nx_ip_udp_created_sockets_count;
+    NX_TCP_SOCKET *tcp_socket  = nx_ip_instance.nx_ip_tcp_created_sockets_ptr;
+    ULONG          tcp_sockets = nx_ip_instance.nx_ip_tcp_created_sockets_count;
+    NX_UDP_SOCKET *next_udp_socket;
+    NX_TCP_SOCKET *next_tcp_socket;
 
     /* Leave IPv4 multicast groups */
     for (uint_fast8_t i = 0; i < NX_MAX_MULTICAST_GROUPS; i++) {
@@ -82,22 +90,32 @@ void zenoh_cleanup_nx() {
     }
 
     /* Delete UDP sockets */
-    if (nx_ip_instance.nx_ip_udp_created_sockets_count > 0) {
-        NX_UDP_SOCKET *current_udp_socket = nx_ip_instance.nx_ip_udp_created_sockets_ptr;
-        NX_UDP_SOCKET *next_udp_socket    = current_udp_socket->nx_udp_socket_created_next;
-        do {
-            if (((uint8_t *) current_udp_socket >= zenoh_byte_pool_buffer) && ((uint8_t *) current_udp_socket < (zenoh_byte_pool_buffer + ZENOH_MEM_POOL_SIZE))) {
-                status = nx_udp_socket_unbind(current_udp_socket);
-                if ((status != NX_SUCCESS) && (status != NX_NOT_BOUND)) Error_Handler();
-                status = nx_udp_socket_delete(current_udp_socket);
-                if (status != NX_SUCCESS) Error_Handler();
-            }
-            current_udp_socket = next_udp_socket;
-            next_udp_socket    = current_udp_socket->nx_udp_socket_created_next;
-        } while ((current_udp_socket != nx_ip_instance.nx_ip_udp_created_sockets_ptr) && (nx_ip_instance.nx_ip_udp_created_sockets_count > 0));
+    for (ULONG i = 0; i < udp_sockets; i++) {
+        next_udp_socket = udp_socket->nx_udp_socket_created_next;
+        if (((uint8_t *) udp_socket >= zenoh_byte_pool_buffer) && ((uint8_t *) udp_socket < (zenoh_byte_pool_buffer + ZENOH_MEM_POOL_SIZE))) {
+            zenoh_udp_socket_rx_flush((zenoh_udp_socket_t *) udp_socket);
+            status = nx_udp_socket_unbind(udp_socket);
+            if ((status != NX_SUCCESS) && (status != NX_NOT_BOUND)) Error_Handler();
+            status = nx_udp_socket_delete(udp_socket);
+            if (status != NX_SUCCESS) Error_Handler();
+        }
+        udp_socket = next_udp_socket;
     }
 
-    // TODO: Delete TCP sockets when implemented
+    /* Delete TCP sockets */
+    for (ULONG i = 0; i < tcp_sockets; i++) {
+        next_tcp_socket = tcp_socket->nx_tcp_socket_created_next;
+        if (((uint8_t *) tcp_socket >= zenoh_byte_pool_buffer) && ((uint8_t *) tcp_socket < (zenoh_byte_pool_buffer + ZENOH_MEM_POOL_SIZE))) {
+            zenoh_tcp_socket_rx_flush((zenoh_tcp_socket_t *) tcp_socket);
+            nx_tcp_socket_disconnect(tcp_socket, Z_CONFIG_SOCKET_TIMEOUT); /* Resets the connection if the FIN handshake doesn't complete */
+            status = nx_tcp_client_socket_unbind(tcp_socket);
+            if ((status != NX_SUCCESS) && (status != NX_NOT_BOUND)) Error_Handler();
+            status = nx_tcp_socket_delete(tcp_socket);
+            if (status != NX_SUCCESS) Error_Handler();
+        }
+        tcp_socket = next_tcp_socket;
+    }
 
-    // TODO: Release any held packets (check if this is done in unbind/delete)
+    /* Release the packets backing the transport buffers. Packets still queued in NetX return to their pools when sent */
+    zenoh_udp_buffers_reset();
 }
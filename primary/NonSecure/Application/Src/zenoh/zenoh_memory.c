@@ -0,0 +1,279 @@
+/*
+ * zenoh_memory.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+
+#include "tx_api.h"
+#include "main.h"
+
+#include "config.h"
+#include "utils.h"
+#include "comms_thread.h"
+#include "zenoh_memory.h"
+
+
+/* Zenoh Pico makes lots of small, short lived allocations (slices, strings, vector entries). ThreadX byte pools are
+ * first-fit with a linear search, so over a long session these fragment the pool and allocations get slower until
+ * one fails. Small allocations are instead served in O(1) from fixed size block pools, with the byte pool left for
+ * the few large, long lived objects (task stacks, transport state, ...).
+ *
+ * The block pools are carved out of zenoh_byte_pool so everything Zenoh Pico owns stays inside
+ * zenoh_byte_pool_buffer (zenoh_cleanup relies on this) and is thrown away with it on a session restart */
+
+
+/* Byte pool allocations are preceded by the size that was asked for, so their usable size is known without looking at
+ * ThreadX's block list. The header is a whole number of ALIGN_TYPEs so the memory handed out is as aligned as the byte
+ * pool's own */
+#define ZENOH_BYTE_HEADER_SIZE   (((sizeof(size_t) + sizeof(ALIGN_TYPE) - 1) / sizeof(ALIGN_TYPE)) * sizeof(ALIGN_TYPE))
+#define ZENOH_BYTE_HEADER(ptr)   ((UCHAR *) (ptr) - ZENOH_BYTE_HEADER_SIZE)
+#define ZENOH_BYTE_SIZE(ptr)     (*((size_t *) ZENOH_BYTE_HEADER(ptr)))
+
+
+#if ZENOH_MEM_TRACE == true
+
+/* Zenoh Pico allocates from its own tasks, which have no secure stack to log from, so records are queued here and
+ * logged later by the comms thread */
+typedef enum {
+    ZENOH_TRACE_INIT,
+    ZENOH_TRACE_ALLOCATE,
+    ZENOH_TRACE_RELEASE,
+} zenoh_trace_kind_t;
+
+typedef struct {
+    zenoh_trace_kind_t kind;
+    uint32_t           ptr;
+    uint32_t           size;
+} zenoh_trace_record_t;
+
+static zenoh_trace_record_t zenoh_trace_records[ZENOH_MEM_TRACE_SIZE];
+static uint32_t             zenoh_trace_head  = 0; /* Next record to log */
+static uint32_t             zenoh_trace_count = 0;
+static uint32_t             zenoh_trace_lost  = 0;
+
+static void zenoh_memory_trace(zenoh_trace_kind_t kind, const void *ptr, size_t size) {
+
+    TX_INTERRUPT_SAVE_AREA
+
+    TX_DISABLE
+    if (zenoh_trace_count < ZENOH_MEM_TRACE_SIZE) {
+        zenoh_trace_records[(zenoh_trace_head + zenoh_trace_count) % ZENOH_MEM_TRACE_SIZE] = (zenoh_trace_record_t) {kind, (uint32_t) (uintptr_t) ptr, (uint32_t) size};
+        zenoh_trace_count++;
+    } else {
+        zenoh_trace_lost++;
+    }
+    TX_RESTORE
+}
+
+#endif
+
+
+static const ULONG zenoh_memory_block_sizes[ZENOH_MEM_BLOCK_CLASSES]  = ZENOH_MEM_BLOCK_SIZES;
+static const ULONG zenoh_memory_block_counts[ZENOH_MEM_BLOCK_CLASSES] = ZENOH_MEM_BLOCK_COUNTS;
+
+static TX_BLOCK_POOL zenoh_block_pools[ZENOH_MEM_BLOCK_CLASSES];
+static bool          zenoh_block_pools_valid = false;
+
+zenoh_memory_stats_t zenoh_memory_stats = {
+    .byte_pool_low_watermark = ZENOH_MEM_POOL_SIZE,
+};
+
+
+/* Create the block pools. Must be called straight after zenoh_byte_pool is created */
+void zenoh_memory_init(void) {
+
+    tx_status_t tx_status = TX_SUCCESS;
+
+    void *pointer;
+    ULONG pool_size;
+
+    for (uint32_t i = 0; i < ZENOH_MEM_BLOCK_CLASSES; i++) {
+
+        /* Each block carries a pointer back to its pool */
+        pool_size = zenoh_memory_block_counts[i] * (zenoh_memory_block_sizes[i] + sizeof(void *));
+
+        tx_status = tx_byte_allocate(&zenoh_byte_pool, &pointer, pool_size, TX_NO_WAIT);
+        if (tx_status != TX_SUCCESS) Error_Handler();
+
+        tx_status = tx_block_pool_create(&zenoh_block_pools[i], "Zenoh Pico block pool", zenoh_memory_block_sizes[i], pointer, pool_size);
+        if (tx_status != TX_SUCCESS) Error_Handler();
+
+        zenoh_memory_stats.classes[i].block_size = zenoh_memory_block_sizes[i];
+        zenoh_memory_stats.classes[i].total      = zenoh_block_pools[i].tx_block_pool_total;
+    }
+
+    zenoh_block_pools_valid = true;
+
+#if ZENOH_MEM_TRACE == true
+    zenoh_memory_trace(ZENOH_TRACE_INIT, NULL, 0);
+#endif
+}
+
+
+/* Delete the block pools. Must be called before zenoh_byte_pool is deleted (which frees their memory) */
+void zenoh_memory_deinit(void) {
+
+    if (!zenoh_block_pools_valid) return;
+    zenoh_block_pools_valid = false;
+
+    for (uint32_t i = 0; i < ZENOH_MEM_BLOCK_CLASSES; i++) {
+        if (tx_block_pool_delete(&zenoh_block_pools[i]) != TX_SUCCESS) Error_Handler();
+    }
+}
+
+
+/* Take a block from the smallest class that fits. If that class is empty, spill into the bigger classes and then the
+ * byte pool. Returns NULL only if the byte pool allocation fails */
+void *zenoh_memory_allocate(size_t size) {
+
+    TX_INTERRUPT_SAVE_AREA
+
+    void *ptr    = NULL;
+    bool  fitted = false;
+    ULONG in_use;
+
+    for (uint32_t i = 0; zenoh_block_pools_valid && (i < ZENOH_MEM_BLOCK_CLASSES); i++) {
+
+        if (size > zenoh_memory_block_sizes[i]) continue;
+
+        if (tx_block_allocate(&zenoh_block_pools[i], &ptr, TX_NO_WAIT) == TX_SUCCESS) {
+            TX_DISABLE
+            in_use = zenoh_block_pools[i].tx_block_pool_total - zenoh_block_pools[i].tx_block_pool_available;
+            if (in_use > zenoh_memory_stats.classes[i].high_watermark) {
+                zenoh_memory_stats.classes[i].high_watermark = in_use;
+            }
+            TX_RESTORE
+#if ZENOH_MEM_TRACE == true
+            zenoh_memory_trace(ZENOH_TRACE_ALLOCATE, ptr, size);
+#endif
+            return ptr;
+        }
+
+        /* Only the class the allocation belongs in counts the failure */
+        if (!fitted) {
+            TX_DISABLE
+            zenoh_memory_stats.classes[i].failures++;
+            TX_RESTORE
+            fitted = true;
+        }
+    }
+
+    if (tx_byte_allocate(&zenoh_byte_pool, &ptr, size + ZENOH_BYTE_HEADER_SIZE, TX_WAIT_FOREVER) != TX_SUCCESS) return NULL;
+    ptr                  = (UCHAR *) ptr + ZENOH_BYTE_HEADER_SIZE;
+    ZENOH_BYTE_SIZE(ptr) = size;
+
+    TX_DISABLE
+    zenoh_memory_stats.byte_pool_allocations++;
+    if (zenoh_byte_pool.tx_byte_pool_available < zenoh_memory_stats.byte_pool_low_watermark) {
+        zenoh_memory_stats.byte_pool_low_watermark = zenoh_byte_pool.tx_byte_pool_available;
+    }
+    TX_RESTORE
+
+#if ZENOH_MEM_TRACE == true
+    zenoh_memory_trace(ZENOH_TRACE_ALLOCATE, ptr, size);
+#endif
+
+    return ptr;
+}
+
+
+/* Returns the block pool ptr came from, or NULL if it is from the byte pool */
+static TX_BLOCK_POOL *zenoh_memory_block_pool_get(const void *ptr) {
+
+    TX_BLOCK_POOL *pool;
+
+    for (uint32_t i = 0; zenoh_block_pools_valid && (i < ZENOH_MEM_BLOCK_CLASSES); i++) {
+        pool = &zenoh_block_pools[i];
+        if (((UCHAR *) ptr >= pool->tx_block_pool_start) && ((UCHAR *) ptr < (pool->tx_block_pool_start + pool->tx_block_pool_size))) {
+            return pool;
+        }
+    }
+
+    return NULL;
+}
+
+
+/* Return ptr to whichever pool it came from */
+void zenoh_memory_release(void *ptr) {
+
+#if ZENOH_MEM_TRACE == true
+    zenoh_memory_trace(ZENOH_TRACE_RELEASE, ptr, 0);
+#endif
+
+    if (zenoh_memory_block_pool_get(ptr) != NULL) {
+        tx_block_release(ptr);
+    } else {
+        tx_byte_release(ZENOH_BYTE_HEADER(ptr));
+    }
+}
+
+
+/* Number of bytes that can be used at ptr. For a block that is the whole block, which may be more than was asked for */
+size_t zenoh_memory_usable_size(const void *ptr) {
+
+    TX_BLOCK_POOL *pool = zenoh_memory_block_pool_get(ptr);
+
+    if (pool != NULL) return pool->tx_block_pool_block_size;
+
+    return ZENOH_BYTE_SIZE(ptr);
+}
+
+
+/* Check whether the allocation at ptr can be resized without moving it, which it can as long as the new size fits in
+ * its usable size. Blocks stay within their class and byte pool allocations can only shrink, ThreadX has no API to grow
+ * a byte pool block. The recorded size isn't changed on a shrink since the memory behind it is still there */
+bool zenoh_memory_resize(void *ptr, size_t size) {
+    return size <= zenoh_memory_usable_size(ptr);
+}
+
+
+/* Log the allocations and releases traced since the last call with ZENOH_MEM_TRACE enabled, one per line as replayed by
+ * Tests/zenoh_memory. Only call from the comms thread, Zenoh Pico's tasks can't log */
+void zenoh_memory_trace_log(void) {
+
+#if ZENOH_MEM_TRACE == true
+
+    TX_INTERRUPT_SAVE_AREA
+
+    zenoh_trace_record_t record;
+    uint32_t             lost;
+
+    while (1) {
+
+        TX_DISABLE
+        if (zenoh_trace_count == 0) {
+            TX_RESTORE
+            break;
+        }
+        record           = zenoh_trace_records[zenoh_trace_head];
+        zenoh_trace_head = (zenoh_trace_head + 1) % ZENOH_MEM_TRACE_SIZE;
+        zenoh_trace_count--;
+        TX_RESTORE
+
+        switch (record.kind) {
+            case ZENOH_TRACE_INIT:
+                log_write("Zenoh memory trace: init\n");
+                break;
+            case ZENOH_TRACE_ALLOCATE:
+                log_write("Zenoh memory trace: a %08lx %lu\n", record.ptr, record.size);
+                break;
+            case ZENOH_TRACE_RELEASE:
+                log_write("Zenoh memory trace: f %08lx\n", record.ptr);
+                break;
+        }
+    }
+
+    TX_DISABLE
+    lost             = zenoh_trace_lost;
+    zenoh_trace_lost = 0;
+    TX_RESTORE
+
+    if (lost > 0) log_write("Zenoh memory trace: lost %lu\n", lost);
+
+#endif
+}
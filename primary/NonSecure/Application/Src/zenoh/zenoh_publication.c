@@ -0,0 +1,59 @@
+/*
+ * zenoh_publication.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+#include "stdint.h"
+#include "stddef.h"
+
+#include "zenoh-pico.h"
+
+#include "zenoh_publication.h"
+
+
+/* Declare the key expression and the publisher. Must be called again on every new session */
+z_result_t zenoh_publication_declare(const z_loaned_session_t *session, zenoh_publication_t *publication) {
+
+    _z_res_t z_status = Z_OK;
+
+    z_publisher_options_t options;
+    z_owned_encoding_t    encoding;
+    z_owned_keyexpr_t     key;
+    z_view_keyexpr_t      view_key;
+
+    /* Take the QoS from the template and parse the encoding once here instead of on every put */
+    if (publication->options != NULL) {
+        options = *publication->options;
+    } else {
+        z_publisher_options_default(&options);
+    }
+    z_status = z_encoding_from_str(&encoding, publication->encoding);
+    if (z_status < Z_OK) return z_status;
+    options.encoding = z_move(encoding);
+
+    z_view_keyexpr_from_str(&view_key, publication->keyexpr);
+    z_status = z_declare_keyexpr(session, &key, z_loan(view_key));
+    if (z_status < Z_OK) {
+        z_drop(z_move(encoding));
+        return z_status;
+    }
+
+    return z_declare_publisher(session, &publication->publisher, z_loan(key), &options);
+}
+
+
+/* Publish len bytes from buf with the settings the publication was declared with. buf is not copied so it must not
+ * change until this returns */
+z_result_t zenoh_publication_put(zenoh_publication_t *publication, const uint8_t *buf, size_t len) {
+
+    _z_res_t        z_status = Z_OK;
+    z_owned_bytes_t payload;
+
+    z_status = z_bytes_from_static_buf(&payload, (uint8_t *) buf, len);
+    if (z_status < Z_OK) return z_status;
+
+    /* No options so the publisher's encoding, priority and congestion control are used */
+    return z_publisher_put(z_loan(publication->publisher), z_move(payload), NULL);
+}
@@ -0,0 +1,118 @@
+/*
+ * zenoh_random.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+#include "stdint.h"
+#include "stddef.h"
+#include "string.h"
+
+#include "tx_api.h"
+#include "secure_nsc.h"
+
+#include "zenoh_random.h"
+
+
+/* The RNG peripheral belongs to the secure world and Zenoh Pico's tasks have no secure stack, so they can't call
+ * into it. Instead a ChaCha20 keystream is used as the generator, keyed from the hardware RNG by the comms thread
+ * before each session is opened. Output is unpredictable across reboots and costs one block (64 bytes) per 16 words */
+
+#define ZENOH_RANDOM_BLOCK_WORDS (16)
+#define ZENOH_RANDOM_SEED_WORDS  (10) /* 256 bit key and 64 bit nonce */
+
+#define ZENOH_RANDOM_ROTL(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+#define ZENOH_RANDOM_QUARTER_ROUND(a, b, c, d)                             \
+    do {                                                                   \
+        (a) += (b); (d) ^= (a); (d) = ZENOH_RANDOM_ROTL((d), 16);          \
+        (c) += (d); (b) ^= (c); (b) = ZENOH_RANDOM_ROTL((b), 12);          \
+        (a) += (b); (d) ^= (a); (d) = ZENOH_RANDOM_ROTL((d), 8);           \
+        (c) += (d); (b) ^= (c); (b) = ZENOH_RANDOM_ROTL((b), 7);           \
+    } while (0)
+
+
+/* Words 0-3 are the constants, 4-11 the key, 12-13 the block counter and 14-15 the nonce */
+static uint32_t zenoh_random_state[ZENOH_RANDOM_BLOCK_WORDS] = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574};
+static uint32_t zenoh_random_block[ZENOH_RANDOM_BLOCK_WORDS];
+static size_t   zenoh_random_available = 0; /* Unused bytes at the end of zenoh_random_block */
+
+
+/* Generate the next block of keystream. Must be called with interrupts disabled */
+static void zenoh_random_next_block(void) {
+
+    uint32_t *x = zenoh_random_block;
+
+    memcpy(x, zenoh_random_state, sizeof(zenoh_random_block));
+
+    for (uint32_t i = 0; i < 10; i++) {
+        ZENOH_RANDOM_QUARTER_ROUND(x[0], x[4], x[8], x[12]);
+        ZENOH_RANDOM_QUARTER_ROUND(x[1], x[5], x[9], x[13]);
+        ZENOH_RANDOM_QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+        ZENOH_RANDOM_QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+        ZENOH_RANDOM_QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+        ZENOH_RANDOM_QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+        ZENOH_RANDOM_QUARTER_ROUND(x[2], x[7], x[8], x[13]);
+        ZENOH_RANDOM_QUARTER_ROUND(x[3], x[4], x[9], x[14]);
+    }
+
+    for (uint32_t i = 0; i < ZENOH_RANDOM_BLOCK_WORDS; i++) {
+        x[i] += zenoh_random_state[i];
+    }
+
+    /* 64-bit block counter */
+    if (++zenoh_random_state[12] == 0) zenoh_random_state[13]++;
+
+    zenoh_random_available = sizeof(zenoh_random_block);
+}
+
+
+/* Mix fresh hardware randomness into the key and nonce. Must be called from a thread with a secure stack */
+void zenoh_random_seed(void) {
+
+    TX_INTERRUPT_SAVE_AREA
+
+    uint32_t seed[ZENOH_RANDOM_SEED_WORDS];
+
+    s_random_fill(seed, ZENOH_RANDOM_SEED_WORDS);
+
+    TX_DISABLE
+    for (uint32_t i = 0; i < 8; i++) {
+        zenoh_random_state[4 + i] ^= seed[i];
+    }
+    zenoh_random_state[14] ^= seed[8];
+    zenoh_random_state[15] ^= seed[9];
+    zenoh_random_state[12]  = 0;
+    zenoh_random_state[13]  = 0;
+    zenoh_random_available  = 0;
+    TX_RESTORE
+
+    memset(seed, 0, sizeof(seed));
+}
+
+
+/* Copy keystream into buf a block at a time. Used bytes are cleared so earlier output can't be read back */
+void zenoh_random_fill(void *buf, size_t len) {
+
+    TX_INTERRUPT_SAVE_AREA
+
+    uint8_t *out = buf;
+    uint8_t *src;
+    size_t   n;
+
+    while (len > 0) {
+
+        TX_DISABLE
+        if (zenoh_random_available == 0) zenoh_random_next_block();
+
+        n   = (len < zenoh_random_available) ? len : zenoh_random_available;
+        src = (uint8_t *) zenoh_random_block + (sizeof(zenoh_random_block) - zenoh_random_available);
+        memcpy(out, src, n);
+        memset(src, 0, n);
+        zenoh_random_available -= n;
+        TX_RESTORE
+
+        out += n;
+        len -= n;
+    }
+}
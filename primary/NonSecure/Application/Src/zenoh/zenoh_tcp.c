@@ -8,8 +8,11 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <string.h>
+#include <stdio.h>
 
 #include "hal.h"
+#include "main.h"
+
 #include "zenoh-pico/collections/slice.h"
 #include "zenoh-pico/collections/string.h"
 #include "zenoh-pico/protocol/codec/serial.h"
@@ -22,18 +25,322 @@
 #include "zenoh-pico/utils/pointers.h"
 
 #include "zenoh_generic_config.h"
+#include "config.h"
+#include "nx_app.h"
+#include "comms_thread.h"
+#include "zenoh_tcp.h"
+#include "zenoh_udp.h"
 
 
 #if Z_FEATURE_LINK_TCP == 1
-#error "Z_FEATURE_LINK_TCP is not supported"
-
-z_result_t _z_create_endpoint_tcp(_z_sys_net_endpoint_t *ep, const char *s_address, const char *s_port);
-void       _z_free_endpoint_tcp(_z_sys_net_endpoint_t *ep);
-
-z_result_t _z_open_tcp(_z_sys_net_socket_t *sock, const _z_sys_net_endpoint_t rep, uint32_t tout);
-z_result_t _z_listen_tcp(_z_sys_net_socket_t *sock, const _z_sys_net_endpoint_t rep);
-void       _z_close_tcp(_z_sys_net_socket_t *sock);
-size_t     _z_read_exact_tcp(const _z_sys_net_socket_t sock, uint8_t *ptr, size_t len);
-size_t     _z_read_tcp(const _z_sys_net_socket_t sock, uint8_t *ptr, size_t len);
-size_t     _z_send_tcp(const _z_sys_net_socket_t sock, const uint8_t *ptr, size_t len);
-#endif
\ No newline at end of file
+
+/* Get the segment currently being read from the socket, receiving a new one if the last has been consumed */
+static NX_PACKET *zenoh_tcp_rx_packet_get(zenoh_tcp_socket_t *socket_ptr, ULONG wait_option) {
+
+    if (socket_ptr->rx_packet == NULL) {
+        if (nx_tcp_socket_receive(&socket_ptr->socket, &socket_ptr->rx_packet, wait_option) != NX_SUCCESS) {
+            socket_ptr->rx_packet = NULL;
+            return NULL;
+        }
+        socket_ptr->rx_offset = 0;
+        zenoh_events.packets_received++;
+    }
+
+    return socket_ptr->rx_packet;
+}
+
+
+/* Copy up to len bytes from the segment being read straight into ptr. The segment is released once it has been fully
+ * consumed. Returns the number of bytes copied or SIZE_MAX on error */
+static size_t zenoh_tcp_rx_consume(zenoh_tcp_socket_t *socket_ptr, uint8_t *ptr, size_t len) {
+
+    TX_INTERRUPT_SAVE_AREA
+
+    ULONG bytes_copied = 0;
+
+    if (socket_ptr->rx_offset < socket_ptr->rx_packet->nx_packet_length) {
+        if (nx_packet_data_extract_offset(socket_ptr->rx_packet, socket_ptr->rx_offset, ptr, len, &bytes_copied) != NX_SUCCESS) {
+            zenoh_tcp_socket_rx_flush(socket_ptr);
+            return SIZE_MAX;
+        }
+        socket_ptr->rx_offset += bytes_copied;
+    }
+
+    if (socket_ptr->rx_offset >= socket_ptr->rx_packet->nx_packet_length) {
+        zenoh_tcp_socket_rx_flush(socket_ptr);
+    }
+
+    /* Atomically increment 64-bit counter */
+    TX_DISABLE
+    zenoh_events.bytes_received += bytes_copied;
+    TX_RESTORE
+
+    return bytes_copied;
+}
+
+
+/* Release the segment being read (if any) */
+void zenoh_tcp_socket_rx_flush(zenoh_tcp_socket_t *socket_ptr) {
+
+    if (socket_ptr->rx_packet != NULL) {
+        if (nx_packet_release(socket_ptr->rx_packet) != NX_SUCCESS) Error_Handler();
+        socket_ptr->rx_packet = NULL;
+    }
+    socket_ptr->rx_offset = 0;
+}
+
+
+z_result_t _z_create_endpoint_tcp(_z_sys_net_endpoint_t *ep, const char *s_address, const char *s_port) {
+
+    _z_res_t status = Z_OK;
+
+    /* Parse and check the validity of the port */
+    uint32_t port = strtoul(s_port, NULL, 10);
+    if ((port == 0) || (port > NX_MAX_PORT)) {
+        status = _Z_ERR_GENERIC;
+        _Z_ERROR_LOG(status);
+        return status;
+    }
+
+    /* Parse and check the validity of the IP(v4) address */
+    uint32_t b1, b2, b3, b4;
+    if (sscanf(s_address, "%lu.%lu.%lu.%lu", &b1, &b2, &b3, &b4) != 4) {
+        status = _Z_ERR_GENERIC;
+        _Z_ERROR_LOG(status);
+        return status;
+    }
+    if (((b1 > UINT8_MAX) || (b2 > UINT8_MAX) || (b3 > UINT8_MAX) || (b4 > UINT8_MAX)) || ((b1 == 0) && (b2 == 0) && (b3 == 0) && (b4 == 0))) {
+        status = _Z_ERR_GENERIC;
+        _Z_ERROR_LOG(status);
+        return status;
+    }
+
+    /* Assign the parsed values */
+    ep->port       = port;
+    ep->ip_address = IP_ADDRESS(b1, b2, b3, b4);
+
+    return status;
+}
+
+
+void _z_free_endpoint_tcp(_z_sys_net_endpoint_t *ep) {
+    memset(ep, 0, sizeof(_z_sys_net_endpoint_t));
+}
+
+
+z_result_t _z_open_tcp(_z_sys_net_socket_t *sock, const _z_sys_net_endpoint_t rep, uint32_t tout) {
+
+    _z_res_t status = Z_OK;
+
+    /* Store the timeout */
+    sock->timeout = tout;
+
+    /* A UDP socket opened while scouting may have armed the transport buffer provider, TCP batches stay in the pool */
+    zenoh_udp_buffer_provider_disarm();
+
+    /* Allocate memory for the socket */
+    zenoh_tcp_socket_t *socket_ptr = z_malloc(sizeof(zenoh_tcp_socket_t));
+    if (socket_ptr == NULL) {
+        status = _Z_ERR_GENERIC;
+        _Z_ERROR_LOG(status);
+        return status;
+    }
+    socket_ptr->rx_packet = NULL;
+    socket_ptr->rx_offset = 0;
+    sock->tcp_socket      = &socket_ptr->socket;
+
+    /* Create the socket */
+    if (nx_tcp_socket_create(
+            &nx_ip_instance,
+            sock->tcp_socket,
+            "Zenoh TCP Socket",
+            NX_IP_NORMAL,
+            NX_FRAGMENT_OKAY,
+            NX_IP_TIME_TO_LIVE,
+            ZENOH_TCP_WINDOW_SIZE,
+            NX_NULL,
+            NX_NULL) != NX_SUCCESS) {
+        status = _Z_ERR_GENERIC;
+        _Z_ERROR_LOG(status);
+        z_free(socket_ptr);
+        return status;
+    }
+
+    /* Bind to any local port */
+    if (nx_tcp_client_socket_bind(sock->tcp_socket, NX_ANY_PORT, sock->timeout) != NX_SUCCESS) {
+        status = _Z_ERR_GENERIC;
+        _Z_ERROR_LOG(status);
+        nx_tcp_socket_delete(sock->tcp_socket);
+        z_free(socket_ptr);
+        return status;
+    }
+
+    /* Connect to the remote endpoint */
+    if (nx_tcp_client_socket_connect(sock->tcp_socket, rep.ip_address, rep.port, ZENOH_TCP_CONNECT_TIMEOUT) != NX_SUCCESS) {
+        status = _Z_ERR_GENERIC;
+        _Z_ERROR_LOG(status);
+        nx_tcp_client_socket_unbind(sock->tcp_socket);
+        nx_tcp_socket_delete(sock->tcp_socket);
+        z_free(socket_ptr);
+        return status;
+    }
+
+    /* Remember the router so the comms thread can reconnect without scouting */
+    zenoh_last_locator.protocol   = "tcp";
+    zenoh_last_locator.ip_address = rep.ip_address;
+    zenoh_last_locator.port       = rep.port;
+
+    return status;
+}
+
+
+z_result_t _z_listen_tcp(_z_sys_net_socket_t *sock, const _z_sys_net_endpoint_t rep) {
+
+    _z_res_t status = _Z_RES_OK;
+
+    UNUSED(sock);
+    UNUSED(rep);
+
+    /* TODO: To be implemented */
+    status = _Z_ERR_GENERIC;
+    _Z_ERROR_LOG(status);
+
+    return status;
+}
+
+
+void _z_close_tcp(_z_sys_net_socket_t *sock) {
+
+    _z_res_t status = Z_OK;
+
+    UNUSED(status);
+
+    /* Release any partially read segment */
+    zenoh_tcp_socket_rx_flush((zenoh_tcp_socket_t *) sock->tcp_socket);
+
+    /* Disconnect (sends a FIN, or a RST if it times out) */
+    if (nx_tcp_socket_disconnect(sock->tcp_socket, sock->timeout) != NX_SUCCESS) {
+        status = _Z_ERR_GENERIC;
+        _Z_ERROR_LOG(status);
+    }
+
+    /* Unbind from port */
+    if (nx_tcp_client_socket_unbind(sock->tcp_socket) != NX_SUCCESS) {
+        status = _Z_ERR_GENERIC;
+        _Z_ERROR_LOG(status);
+    }
+
+    /* Delete the socket */
+    if (nx_tcp_socket_delete(sock->tcp_socket) != NX_SUCCESS) {
+        status = _Z_ERR_GENERIC;
+        _Z_ERROR_LOG(status);
+    }
+
+    /* Free the memory */
+    z_free(sock->tcp_socket);
+}
+
+
+size_t _z_read_exact_tcp(const _z_sys_net_socket_t sock, uint8_t *ptr, size_t len) {
+
+    _z_res_t            status     = Z_OK;
+    size_t              bytes_read = 0;
+    size_t              bytes_copied;
+    zenoh_tcp_socket_t *socket_ptr = (zenoh_tcp_socket_t *) sock.tcp_socket;
+
+    UNUSED(status);
+
+    /* A message can span several segments and a segment can hold several messages */
+    while (bytes_read < len) {
+
+        /* Receive a segment if the last one has been consumed */
+        if (zenoh_tcp_rx_packet_get(socket_ptr, sock.timeout) == NULL) {
+            status = _Z_ERR_GENERIC;
+            _Z_ERROR_LOG(status);
+            return SIZE_MAX;
+        }
+
+        /* Extract the data from the segment */
+        bytes_copied = zenoh_tcp_rx_consume(socket_ptr, ptr + bytes_read, len - bytes_read);
+        if (bytes_copied == SIZE_MAX) {
+            status = _Z_ERR_GENERIC;
+            _Z_ERROR_LOG(status);
+            return SIZE_MAX;
+        }
+        bytes_read += bytes_copied;
+    }
+
+    return bytes_read;
+}
+
+
+size_t _z_read_tcp(const _z_sys_net_socket_t sock, uint8_t *ptr, size_t len) {
+
+    _z_res_t            status     = Z_OK;
+    size_t              bytes_read = 0;
+    zenoh_tcp_socket_t *socket_ptr = (zenoh_tcp_socket_t *) sock.tcp_socket;
+
+    UNUSED(status);
+
+    /* Receive a segment if there isn't one partially read */
+    if (zenoh_tcp_rx_packet_get(socket_ptr, sock.timeout) == NULL) {
+        status = _Z_ERR_GENERIC;
+        _Z_ERROR_LOG(status);
+        return SIZE_MAX;
+    }
+
+    /* Extract the data from the segment. Anything that doesn't fit is kept for the next read */
+    bytes_read = zenoh_tcp_rx_consume(socket_ptr, ptr, len);
+    if (bytes_read == SIZE_MAX) {
+        status = _Z_ERR_GENERIC;
+        _Z_ERROR_LOG(status);
+    }
+
+    return bytes_read;
+}
+
+
+size_t _z_send_tcp(const _z_sys_net_socket_t sock, const uint8_t *ptr, size_t len) {
+
+    TX_INTERRUPT_SAVE_AREA
+
+    _z_res_t   status      = Z_OK;
+    NX_PACKET *data_packet = NULL;
+
+    UNUSED(status);
+
+    /* Allocate a packet */
+    if (nx_packet_allocate(&nx_zenoh_packet_pool, &data_packet, NX_TCP_PACKET, sock.timeout) != NX_SUCCESS) {
+        status = _Z_ERR_GENERIC;
+        _Z_ERROR_LOG(status);
+        return SIZE_MAX;
+    }
+
+    /* Append the message to send. Batches bigger than one packet are chained and NetX splits them into segments */
+    if (nx_packet_data_append(data_packet, (uint8_t *) ptr, len, &nx_zenoh_packet_pool, sock.timeout) != NX_SUCCESS) {
+        status = _Z_ERR_GENERIC;
+        _Z_ERROR_LOG(status);
+        if (nx_packet_release(data_packet) != NX_SUCCESS) Error_Handler();
+        return SIZE_MAX;
+    }
+
+    /* Send the packet. This waits for space in the remote's receive window */
+    if (nx_tcp_socket_send(sock.tcp_socket, data_packet, sock.timeout) != NX_SUCCESS) {
+        status = _Z_ERR_GENERIC;
+        _Z_ERROR_LOG(status);
+        if (nx_packet_release(data_packet) != NX_SUCCESS) Error_Handler();
+        return SIZE_MAX;
+    }
+
+    /* Atomically increment 64-bit counter */
+    TX_DISABLE
+    zenoh_events.bytes_sent += len;
+    TX_RESTORE
+
+    /* Update other statistics */
+    zenoh_events.packets_sent++;
+
+    return len;
+}
+
+#endif
@@ -28,10 +28,237 @@
 #include "nx_app.h"
 #include "comms_thread.h"
 #include "zenoh_cleanup.h"
+#include "zenoh_udp.h"
+#include "utils.h"
 
 
 #if Z_FEATURE_LINK_UDP_UNICAST == 1 || Z_FEATURE_LINK_UDP_MULTICAST == 1
 
+#define ZENOH_UDP_BUFFER_PAYLOAD_SIZE ((NX_UDP_PACKET) + ((Z_BATCH_UNICAST_SIZE > Z_BATCH_MULTICAST_SIZE) ? Z_BATCH_UNICAST_SIZE : Z_BATCH_MULTICAST_SIZE))
+#define ZENOH_UDP_BUFFER_POOL_SIZE    (sizeof(NX_PACKET) + ZENOH_UDP_BUFFER_PAYLOAD_SIZE + (2 * NX_PACKET_ALIGNMENT))
+
+
+/* Each transport buffer is the payload of a packet from its own single packet pool. Zenoh Pico serialises straight
+ * into the packet, and after sending the packet is allocated again from the same pool, which returns the same memory
+ * once the driver has released it.
+ *
+ * Zenoh Pico has no hook for where its batch buffers come from, so the provider is armed explicitly. Opening a UDP link
+ * arms it for the opening thread, opening any other link disarms it, and the comms thread disarms it once z_open
+ * returns. Only batch sized allocations from that thread while armed become transport buffers. */
+typedef struct {
+    NX_PACKET_POOL pool;
+    NX_PACKET     *packet; /* Held packet, NULL while it is owned by NetX */
+    uint8_t       *buffer; /* Payload start lent to Zenoh Pico */
+    bool           in_use;
+} zenoh_udp_buffer_t;
+
+static zenoh_udp_buffer_t zenoh_udp_buffers[ZENOH_UDP_BUFFERS];
+static uint8_t            zenoh_udp_buffer_pool_memory[ZENOH_UDP_BUFFERS][ZENOH_UDP_BUFFER_POOL_SIZE] __attribute__((section(".ETH_Section"))) __ALIGNED(32);
+static TX_THREAD         *zenoh_udp_buffer_provider_thread = NULL; /* Thread the provider is armed for, NULL when disarmed */
+
+
+void zenoh_udp_buffers_init(void) {
+
+    zenoh_udp_buffer_provider_thread = NULL;
+
+    for (uint_fast8_t i = 0; i < ZENOH_UDP_BUFFERS; i++) {
+        if (nx_packet_pool_create(&zenoh_udp_buffers[i].pool, "Zenoh UDP Buffer", ZENOH_UDP_BUFFER_PAYLOAD_SIZE, zenoh_udp_buffer_pool_memory[i], ZENOH_UDP_BUFFER_POOL_SIZE) != NX_SUCCESS) {
+            Error_Handler();
+        }
+        if (zenoh_udp_buffers[i].pool.nx_packet_pool_total != 1) Error_Handler();
+        zenoh_udp_buffers[i].packet = NULL;
+        zenoh_udp_buffers[i].buffer = NULL;
+        zenoh_udp_buffers[i].in_use = false;
+    }
+}
+
+
+/* Return every buffer after the Zenoh Pico memory pool has been deleted */
+void zenoh_udp_buffers_reset(void) {
+
+    for (uint_fast8_t i = 0; i < ZENOH_UDP_BUFFERS; i++) {
+        if (zenoh_udp_buffers[i].packet != NULL) {
+            if (nx_packet_release(zenoh_udp_buffers[i].packet) != NX_SUCCESS) Error_Handler();
+        }
+        zenoh_udp_buffers[i].packet = NULL;
+        zenoh_udp_buffers[i].in_use = false;
+    }
+}
+
+
+/* Route the batch buffers of the transport about to be created on the calling thread into packets */
+void zenoh_udp_buffer_provider_arm(void) {
+    zenoh_udp_buffer_provider_thread = tx_thread_identify();
+}
+
+
+void zenoh_udp_buffer_provider_disarm(void) {
+    zenoh_udp_buffer_provider_thread = NULL;
+}
+
+
+/* Called from z_malloc. Returns NULL unless the provider is armed for this thread and the allocation is a batch, or if
+ * all buffers are taken */
+void *zenoh_udp_buffer_acquire(size_t size) {
+
+    TX_INTERRUPT_SAVE_AREA
+
+    zenoh_udp_buffer_t *slot = NULL;
+
+    if ((zenoh_udp_buffer_provider_thread == NULL) || (zenoh_udp_buffer_provider_thread != tx_thread_identify())) return NULL;
+    if ((size != Z_BATCH_UNICAST_SIZE) && (size != Z_BATCH_MULTICAST_SIZE)) return NULL;
+
+    /* Claim a free slot */
+    TX_DISABLE
+    for (uint_fast8_t i = 0; i < ZENOH_UDP_BUFFERS; i++) {
+        if (!zenoh_udp_buffers[i].in_use) {
+            slot         = &zenoh_udp_buffers[i];
+            slot->in_use = true;
+            break;
+        }
+    }
+    TX_RESTORE
+    if (slot == NULL) return NULL;
+
+    /* The packet may still be in flight from a previous session */
+    if (nx_packet_allocate(&slot->pool, &slot->packet, NX_UDP_PACKET, Z_CONFIG_SOCKET_TIMEOUT) != NX_SUCCESS) {
+        slot->packet = NULL;
+        slot->in_use = false;
+        return NULL;
+    }
+    slot->buffer = slot->packet->nx_packet_prepend_ptr;
+
+    return slot->buffer;
+}
+
+
+/* Called from z_free. Returns false if ptr isn't a transport buffer */
+bool zenoh_udp_buffer_release(void *ptr) {
+
+    for (uint_fast8_t i = 0; i < ZENOH_UDP_BUFFERS; i++) {
+        zenoh_udp_buffer_t *slot = &zenoh_udp_buffers[i];
+        if (!slot->in_use || (slot->buffer != ptr)) continue;
+        if (slot->packet != NULL) {
+            if (nx_packet_release(slot->packet) != NX_SUCCESS) Error_Handler();
+            slot->packet = NULL;
+        }
+        slot->in_use = false;
+        return true;
+    }
+
+    return false;
+}
+
+
+/* Called from z_realloc. Returns the capacity of a transport buffer, or 0 if ptr isn't one */
+size_t zenoh_udp_buffer_size(const void *ptr) {
+
+    for (uint_fast8_t i = 0; i < ZENOH_UDP_BUFFERS; i++) {
+        if (zenoh_udp_buffers[i].in_use && (zenoh_udp_buffers[i].buffer == ptr)) {
+            return ZENOH_UDP_BUFFER_PAYLOAD_SIZE - NX_UDP_PACKET;
+        }
+    }
+
+    return 0;
+}
+
+
+/* Send a transport buffer without copying it. Returns NX_NOT_FOUND if ptr isn't the start of a transport buffer */
+static nx_status_t zenoh_udp_buffer_send(NX_UDP_SOCKET *socket_ptr, const uint8_t *ptr, size_t len, ULONG ip_address, UINT port) {
+
+    nx_status_t         status = NX_NOT_FOUND;
+    zenoh_udp_buffer_t *slot   = NULL;
+
+    for (uint_fast8_t i = 0; i < ZENOH_UDP_BUFFERS; i++) {
+        if (zenoh_udp_buffers[i].in_use && (zenoh_udp_buffers[i].buffer == ptr)) {
+            slot = &zenoh_udp_buffers[i];
+            break;
+        }
+    }
+    if (slot == NULL) return status;
+
+    /* A previous send timed out waiting for the packet. If it still hasn't come back it can't be sent again */
+    if (slot->packet == NULL) {
+        status = nx_packet_allocate(&slot->pool, &slot->packet, NX_UDP_PACKET, NX_NO_WAIT);
+        if (status != NX_SUCCESS) {
+            slot->packet = NULL;
+            return status;
+        }
+        if (slot->packet->nx_packet_prepend_ptr != slot->buffer) Error_Handler();
+    }
+
+    /* The message is already in the packet, only the length needs setting */
+    slot->packet->nx_packet_prepend_ptr = slot->buffer;
+    slot->packet->nx_packet_append_ptr  = slot->buffer + len;
+    slot->packet->nx_packet_length      = len;
+
+    status = nx_udp_socket_send(socket_ptr, slot->packet, ip_address, port);
+    if (status != NX_SUCCESS) return status;
+
+    /* Get the buffer back before Zenoh Pico writes the next batch. This is a single frame time for a resolved
+     * destination, but the packet can be held much longer waiting for ARP or by a stalled TX ring. Rather than block the
+     * send path the wait is bounded and the send fails, so Zenoh Pico closes the transport. The slot stays detached
+     * until the packet comes back, and is only handed out again once it has */
+    slot->packet = NULL;
+    status       = nx_packet_allocate(&slot->pool, &slot->packet, NX_UDP_PACKET, MS_TO_TICKS(ZENOH_UDP_BUFFER_RETURN_TIMEOUT));
+    if (status != NX_SUCCESS) {
+        slot->packet = NULL;
+        return status;
+    }
+    if (slot->packet->nx_packet_prepend_ptr != slot->buffer) Error_Handler();
+
+    return status;
+}
+
+
+/* Get the packet currently being read from the socket, receiving a new one if the last has been consumed */
+static NX_PACKET *zenoh_udp_rx_packet_get(zenoh_udp_socket_t *socket_ptr, ULONG wait_option) {
+
+    if (socket_ptr->rx_packet == NULL) {
+        if (nx_udp_socket_receive(&socket_ptr->socket, &socket_ptr->rx_packet, wait_option) != NX_SUCCESS) {
+            socket_ptr->rx_packet = NULL;
+            return NULL;
+        }
+        socket_ptr->rx_offset = 0;
+    }
+
+    return socket_ptr->rx_packet;
+}
+
+
+/* Copy up to len bytes from the packet being read straight into ptr. The packet is released once it has been fully
+ * consumed. Returns the number of bytes copied or SIZE_MAX on error */
+static size_t zenoh_udp_rx_consume(zenoh_udp_socket_t *socket_ptr, uint8_t *ptr, size_t len) {
+
+    ULONG bytes_copied = 0;
+
+    if (socket_ptr->rx_offset < socket_ptr->rx_packet->nx_packet_length) {
+        if (nx_packet_data_extract_offset(socket_ptr->rx_packet, socket_ptr->rx_offset, ptr, len, &bytes_copied) != NX_SUCCESS) {
+            zenoh_udp_socket_rx_flush(socket_ptr);
+            return SIZE_MAX;
+        }
+        socket_ptr->rx_offset += bytes_copied;
+    }
+
+    if (socket_ptr->rx_offset >= socket_ptr->rx_packet->nx_packet_length) {
+        zenoh_udp_socket_rx_flush(socket_ptr);
+    }
+
+    return bytes_copied;
+}
+
+
+/* Release the packet being read (if any) */
+void zenoh_udp_socket_rx_flush(zenoh_udp_socket_t *socket_ptr) {
+
+    if (socket_ptr->rx_packet != NULL) {
+        if (nx_packet_release(socket_ptr->rx_packet) != NX_SUCCESS) Error_Handler();
+        socket_ptr->rx_packet = NULL;
+    }
+    socket_ptr->rx_offset = 0;
+}
+
+
 z_result_t _z_create_endpoint_udp(_z_sys_net_endpoint_t *ep, const char *s_address, const char *s_port) {
 
     _z_res_t status = Z_OK;
@@ -84,12 +311,15 @@ z_result_t _z_open_udp_unicast(_z_sys_net_socket_t *sock, const _z_sys_net_endpo
     sock->timeout = tout;
 
     /* Allocate memory for the socket */
-    sock->udp_socket = z_malloc(sizeof(NX_UDP_SOCKET));
-    if (sock->udp_socket == NULL) {
+    zenoh_udp_socket_t *socket_ptr = z_malloc(sizeof(zenoh_udp_socket_t));
+    if (socket_ptr == NULL) {
         status = _Z_ERR_GENERIC;
         _Z_ERROR_LOG(status);
         return status;
     }
+    socket_ptr->rx_packet = NULL;
+    socket_ptr->rx_offset = 0;
+    sock->udp_socket      = &socket_ptr->socket;
 
     /* Create the socket */
     if (nx_udp_socket_create(
@@ -112,6 +342,15 @@ z_result_t _z_open_udp_unicast(_z_sys_net_socket_t *sock, const _z_sys_net_endpo
         return status;
     }
 
+    /* The transport created on top of this link gets its batch buffers from packets */
+    zenoh_udp_buffer_provider_arm();
+
+    /* Remember the router so the comms thread can reconnect without scouting. Multicast sockets also pass through
+     * here while scouting, but the router link is always opened after them */
+    zenoh_last_locator.protocol   = "udp";
+    zenoh_last_locator.ip_address = rep.ip_address;
+    zenoh_last_locator.port       = rep.port;
+
     return status;
 }
 
@@ -138,6 +377,9 @@ void _z_close_udp_unicast(_z_sys_net_socket_t *sock) {
 
     UNUSED(status);
 
+    /* Release any partially read packet */
+    zenoh_udp_socket_rx_flush((zenoh_udp_socket_t *) sock->udp_socket);
+
     /* Unbind from port */
     if (nx_udp_socket_unbind(sock->udp_socket) != NX_SUCCESS) {
         status = _Z_ERR_GENERIC;
@@ -157,34 +399,31 @@ void _z_close_udp_unicast(_z_sys_net_socket_t *sock) {
 
 size_t _z_read_exact_udp_unicast(const _z_sys_net_socket_t sock, uint8_t *ptr, size_t len) {
 
-    _z_res_t   status      = Z_OK;
-    uint32_t   bytes_read  = 0;
-    NX_PACKET *data_packet = NULL;
+    _z_res_t            status     = Z_OK;
+    size_t              bytes_read = 0;
+    size_t              bytes_copied;
+    zenoh_udp_socket_t *socket_ptr = (zenoh_udp_socket_t *) sock.udp_socket;
 
     UNUSED(status);
 
-    /* Receive a packet */
-    if (nx_udp_socket_receive(sock.udp_socket, &data_packet, sock.timeout) != NX_SUCCESS) {
-        status = _Z_ERR_GENERIC;
-        _Z_ERROR_LOG(status);
-        return bytes_read;
-    }
+    /* Keep reading from the current packet (and then the next ones) until enough bytes have been read */
+    while (bytes_read < len) {
 
-    /* Extract the data from the packet */
-    if (nx_packet_data_extract_offset(data_packet, 0, ptr, len, &bytes_read) != NX_SUCCESS) {
-        status = _Z_ERR_GENERIC;
-        _Z_ERROR_LOG(status);
-        return bytes_read;
-    }
-
-    // FIXME: Don't drop the packet as there may be another read
-    Error_Handler();
+        /* Receive a packet if the last one has been consumed */
+        if (zenoh_udp_rx_packet_get(socket_ptr, sock.timeout) == NULL) {
+            status = _Z_ERR_GENERIC;
+            _Z_ERROR_LOG(status);
+            return bytes_read;
+        }
 
-    /* Release the packet */
-    if (nx_packet_release(data_packet) != NX_SUCCESS) {
-        status = _Z_ERR_GENERIC;
-        _Z_ERROR_LOG(status);
-        return 0;
+        /* Extract the data from the packet */
+        bytes_copied = zenoh_udp_rx_consume(socket_ptr, ptr + bytes_read, len - bytes_read);
+        if (bytes_copied == SIZE_MAX) {
+            status = _Z_ERR_GENERIC;
+            _Z_ERROR_LOG(status);
+            return bytes_read;
+        }
+        bytes_read += bytes_copied;
     }
 
     return bytes_read;
@@ -193,28 +432,22 @@ size_t _z_read_exact_udp_unicast(const _z_sys_net_socket_t sock, uint8_t *ptr, s
 
 size_t _z_read_udp_unicast(const _z_sys_net_socket_t sock, uint8_t *ptr, size_t len) {
 
-    _z_res_t   status      = Z_OK;
-    uint32_t   bytes_read  = 0;
-    NX_PACKET *data_packet = NULL;
+    _z_res_t            status     = Z_OK;
+    size_t              bytes_read = 0;
+    zenoh_udp_socket_t *socket_ptr = (zenoh_udp_socket_t *) sock.udp_socket;
 
     UNUSED(status);
 
-    /* Receive a packet */
-    if (nx_udp_socket_receive(sock.udp_socket, &data_packet, sock.timeout) != NX_SUCCESS) {
-        status = _Z_ERR_GENERIC;
-        _Z_ERROR_LOG(status);
-        return bytes_read;
-    }
-
-    /* Extract the data from the packet */
-    if (nx_packet_data_retrieve(data_packet, ptr, &bytes_read) != NX_SUCCESS) {
+    /* Receive a packet if there isn't one partially read */
+    if (zenoh_udp_rx_packet_get(socket_ptr, sock.timeout) == NULL) {
         status = _Z_ERR_GENERIC;
         _Z_ERROR_LOG(status);
         return bytes_read;
     }
 
-    /* Release the packet */
-    if (nx_packet_release(data_packet) != NX_SUCCESS) {
+    /* Extract the data from the packet. Anything that doesn't fit is kept for the next read */
+    bytes_read = zenoh_udp_rx_consume(socket_ptr, ptr, len);
+    if (bytes_read == SIZE_MAX) {
         status = _Z_ERR_GENERIC;
         _Z_ERROR_LOG(status);
         return 0;
@@ -228,21 +461,39 @@ size_t _z_send_udp_unicast(const _z_sys_net_socket_t sock, const uint8_t *ptr, s
 
     TX_INTERRUPT_SAVE_AREA
 
-    _z_res_t   status      = Z_OK;
-    uint32_t   bytes_sent  = 0;
-    NX_PACKET *data_packet = NULL;
+    _z_res_t        status      = Z_OK;
+    nx_status_t     nx_status   = NX_SUCCESS;
+    uint32_t        bytes_sent  = 0;
+    NX_PACKET      *data_packet = NULL;
+    NX_PACKET_POOL *pool_ptr    = &nx_zenoh_packet_pool;
 
     UNUSED(status);
 
-    /* Allocate a packet TODO: Use two packet pools */
-    if (nx_packet_allocate(&nx_packet_pool, &data_packet, NX_UDP_PACKET, sock.timeout) != NX_SUCCESS) {
+    /* Zenoh Pico normally sends straight out of its transport buffer, which is already a packet */
+    nx_status = zenoh_udp_buffer_send(sock.udp_socket, ptr, len, rep.ip_address, rep.port);
+    if (nx_status == NX_SUCCESS) {
+        goto sent;
+    } else if (nx_status != NX_NOT_FOUND) {
+        status = _Z_ERR_GENERIC;
+        _Z_ERROR_LOG(status);
+        return bytes_sent;
+    }
+
+    /* Short messages (e.g. heartbeats) go in a small packet if one is free, otherwise use the Zenoh pool */
+    if ((len <= (NX_APP_SMALL_PAYLOAD_SIZE - NX_UDP_PACKET)) &&
+        (nx_packet_allocate(&nx_small_packet_pool, &data_packet, NX_UDP_PACKET, NX_NO_WAIT) == NX_SUCCESS)) {
+        pool_ptr = &nx_small_packet_pool;
+    }
+
+    /* Allocate a packet */
+    else if (nx_packet_allocate(&nx_zenoh_packet_pool, &data_packet, NX_UDP_PACKET, sock.timeout) != NX_SUCCESS) {
         status = _Z_ERR_GENERIC;
         _Z_ERROR_LOG(status);
         return bytes_sent;
     }
 
     /* Append the message to send */
-    if (nx_packet_data_append(data_packet, (uint8_t *) ptr, len, &nx_packet_pool, sock.timeout) != NX_SUCCESS) {
+    if (nx_packet_data_append(data_packet, (uint8_t *) ptr, len, pool_ptr, sock.timeout) != NX_SUCCESS) {
         status = _Z_ERR_GENERIC;
         _Z_ERROR_LOG(status);
         if (nx_packet_release(data_packet) != NX_SUCCESS) Error_Handler();
@@ -257,6 +508,8 @@ size_t _z_send_udp_unicast(const _z_sys_net_socket_t sock, const uint8_t *ptr, s
         return bytes_sent;
     }
 
+sent:
+
     /* Atomically increment 64-bit counter */
     TX_DISABLE
     zenoh_events.bytes_sent += len;
@@ -403,41 +656,28 @@ void _z_close_udp_multicast(_z_sys_net_socket_t *sockrecv, _z_sys_net_socket_t *
 }
 
 
-size_t _z_read_exact_udp_multicast(const _z_sys_net_socket_t sock, uint8_t *ptr, size_t len, const _z_sys_net_endpoint_t lep, _z_slice_t *ep) {
-
-    _z_res_t   status      = Z_OK;
-    uint32_t   bytes_read  = 0;
-    NX_PACKET *data_packet = NULL;
-
-    UNUSED(status);
-    UNUSED(lep);
-
-    /* Receive a packet */
-    if (nx_udp_socket_receive(sock.udp_socket, &data_packet, sock.timeout) != NX_SUCCESS) {
-        status = _Z_ERR_GENERIC;
-        _Z_ERROR_LOG(status);
-        return bytes_read;
-    }
+/* Allocate and fill in the endpoint (IP address and port) of the sender of a packet */
+static z_result_t zenoh_udp_endpoint_from_packet(NX_PACKET *packet, _z_slice_t *ep) {
 
-    /* Extract the data from the packet */
-    if (nx_packet_data_extract_offset(data_packet, 0, ptr, len, &bytes_read) != NX_SUCCESS) {
-        status = _Z_ERR_GENERIC;
-        _Z_ERROR_LOG(status);
-        return 0;
-    }
+    _z_res_t status     = Z_OK;
+    ULONG    ip_address = 0;
+    UINT     port       = 0;
 
     /* Extract the packet info */
-    ULONG ip_address = 0;
-    UINT  port       = 0;
-    if (nx_udp_packet_info_extract(data_packet, &ip_address, NULL, &port, NULL) != NX_SUCCESS) {
+    if (nx_udp_packet_info_extract(packet, &ip_address, NULL, &port, NULL) != NX_SUCCESS) {
         status = _Z_ERR_GENERIC;
         _Z_ERROR_LOG(status);
-        return 0;
+        return status;
     }
 
     /* Allocate and format the endpoint data -TODO: Check endianess */
     uint8_t  ep_len = 6;
     uint8_t *ep_ptr = z_malloc(ep_len);
+    if (ep_ptr == NULL) {
+        status = _Z_ERR_GENERIC;
+        _Z_ERROR_LOG(status);
+        return status;
+    }
     ep_ptr[0]       = (ip_address & 0x000000ff) >> 0;
     ep_ptr[1]       = (ip_address & 0x0000ff00) >> 8;
     ep_ptr[2]       = (ip_address & 0x00ff0000) >> 16;
@@ -451,14 +691,47 @@ size_t _z_read_exact_udp_multicast(const _z_sys_net_socket_t sock, uint8_t *ptr,
     ep->_delete_context.deleter = z_free_with_context;
     ep->_delete_context.context = NULL;
 
-    // FIXME: Don't drop the packet as there may be another read
-    Error_Handler();
+    return status;
+}
 
-    /* Release the packet */
-    if (nx_packet_release(data_packet) != NX_SUCCESS) {
-        status = _Z_ERR_GENERIC;
-        _Z_ERROR_LOG(status);
-        return 0;
+
+size_t _z_read_exact_udp_multicast(const _z_sys_net_socket_t sock, uint8_t *ptr, size_t len, const _z_sys_net_endpoint_t lep, _z_slice_t *ep) {
+
+    _z_res_t            status     = Z_OK;
+    size_t              bytes_read = 0;
+    size_t              bytes_copied;
+    bool                ep_filled  = false;
+    NX_PACKET          *packet;
+    zenoh_udp_socket_t *socket_ptr = (zenoh_udp_socket_t *) sock.udp_socket;
+
+    UNUSED(status);
+    UNUSED(lep);
+
+    while (bytes_read < len) {
+
+        /* Receive a packet if the last one has been consumed */
+        packet = zenoh_udp_rx_packet_get(socket_ptr, sock.timeout);
+        if (packet == NULL) {
+            status = _Z_ERR_GENERIC;
+            _Z_ERROR_LOG(status);
+            return bytes_read;
+        }
+
+        /* The endpoint is the sender of the first packet. That packet can be empty, so whether the endpoint has been
+         * filled in is tracked separately from the bytes read or it would be allocated again for the next packet */
+        if (!ep_filled) {
+            if (zenoh_udp_endpoint_from_packet(packet, ep) != Z_OK) return 0;
+            ep_filled = true;
+        }
+
+        /* Extract the data from the packet */
+        bytes_copied = zenoh_udp_rx_consume(socket_ptr, ptr + bytes_read, len - bytes_read);
+        if (bytes_copied == SIZE_MAX) {
+            status = _Z_ERR_GENERIC;
+            _Z_ERROR_LOG(status);
+            return bytes_read;
+        }
+        bytes_read += bytes_copied;
     }
 
     return bytes_read;
@@ -467,54 +740,28 @@ size_t _z_read_exact_udp_multicast(const _z_sys_net_socket_t sock, uint8_t *ptr,
 
 size_t _z_read_udp_multicast(const _z_sys_net_socket_t sock, uint8_t *ptr, size_t len, const _z_sys_net_endpoint_t lep, _z_slice_t *ep) {
 
-    _z_res_t   status      = Z_OK;
-    uint32_t   bytes_read  = 0;
-    NX_PACKET *data_packet = NULL;
+    _z_res_t            status     = Z_OK;
+    size_t              bytes_read = 0;
+    NX_PACKET          *packet;
+    zenoh_udp_socket_t *socket_ptr = (zenoh_udp_socket_t *) sock.udp_socket;
 
     UNUSED(status);
     UNUSED(lep);
 
-    /* Receive a packet */
-    if (nx_udp_socket_receive(sock.udp_socket, &data_packet, sock.timeout) != NX_SUCCESS) {
-        status = _Z_ERR_GENERIC;
-        _Z_ERROR_LOG(status);
-        return bytes_read;
-    }
-
-    /* Extract the data from the packet */
-    if (nx_packet_data_retrieve(data_packet, ptr, &bytes_read) != NX_SUCCESS) {
+    /* Receive a packet if there isn't one partially read */
+    packet = zenoh_udp_rx_packet_get(socket_ptr, sock.timeout);
+    if (packet == NULL) {
         status = _Z_ERR_GENERIC;
         _Z_ERROR_LOG(status);
         return bytes_read;
     }
 
     /* Extract the packet info */
-    ULONG ip_address = 0;
-    UINT  port       = 0;
-    if (nx_udp_packet_info_extract(data_packet, &ip_address, NULL, &port, NULL) != NX_SUCCESS) {
-        status = _Z_ERR_GENERIC;
-        _Z_ERROR_LOG(status);
-        return 0;
-    }
-
-    /* Allocate and format the endpoint data -TODO: Check endianess */
-    uint8_t  ep_len = 6;
-    uint8_t *ep_ptr = z_malloc(ep_len);
-    ep_ptr[0]       = (ip_address & 0x000000ff) >> 0;
-    ep_ptr[1]       = (ip_address & 0x0000ff00) >> 8;
-    ep_ptr[2]       = (ip_address & 0x00ff0000) >> 16;
-    ep_ptr[3]       = (ip_address & 0xff000000) >> 24;
-    ep_ptr[4]       = (port & 0x00ff) >> 0;
-    ep_ptr[5]       = (port & 0xff00) >> 8;
-
-    /* Save the endpoint data into the slice */
-    ep->start                   = ep_ptr;
-    ep->len                     = ep_len;
-    ep->_delete_context.deleter = z_free_with_context;
-    ep->_delete_context.context = NULL;
+    if (zenoh_udp_endpoint_from_packet(packet, ep) != Z_OK) return 0;
 
-    /* Release the packet */
-    if (nx_packet_release(data_packet) != NX_SUCCESS) {
+    /* Extract the data from the packet. Anything that doesn't fit is kept for the next read */
+    bytes_read = zenoh_udp_rx_consume(socket_ptr, ptr, len);
+    if (bytes_read == SIZE_MAX) {
         status = _Z_ERR_GENERIC;
         _Z_ERROR_LOG(status);
         return 0;
@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+"""
+Decode a raw dump of the secure log ring buffer (or the log area of the FRAM) into text.
+
+Deferred entries only contain the address of the format string and the raw arguments, so the format strings are looked
+up in the ELF files given. Secure logs need the secure image. Non-secure logs are only deferred when their format string
+is in the non-secure flash, so the non-secure image is needed for those. Non-secure logs with a format string anywhere
+else are stored as text. Without the right image an entry is printed as its format address and raw arguments.
+
+Usage: decode_log.py <dump.bin> [--elf primary_Secure.elf] [--elf primary_NonSecure.elf] [--cpu-freq 250000000]
+"""
+import argparse
+import re
+import struct
+from elftools.elf.elffile import ELFFile
+
+# Must match logging.h
+LOG_TYPE_SIZE = 1
+LOG_LENGTH_SIZE = 1
+LOG_TIMESTAMP_SIZE = 4
+LOG_HEADER_SIZE = LOG_TYPE_SIZE + LOG_LENGTH_SIZE + LOG_TIMESTAMP_SIZE
+LOG_FORMAT_ADDR_SIZE = 4
+
+LOG_INVALID = 0
+LOG_EMPTY = 1
+LOG_END = 2
+LOG_COMMITTED = 3
+LOG_COMMITTED_DEFERRED = 4
+
+# Conversion specification (same grammar as log_parse_spec() in logging.c)
+SPEC_RE = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|j|z|t|L)?([diouxXfFeEgGaAcspn%])")
+
+
+class FormatStrings:
+    """Reads null terminated strings out of the loadable sections of one or more ELF files"""
+
+    def __init__(self, elf_files):
+        self.sections = []
+        for elf_file in elf_files:
+            with open(elf_file, "rb") as f:
+                elf = ELFFile(f)
+                for section in elf.iter_sections():
+                    if section["sh_type"] != "SHT_PROGBITS" or section["sh_size"] == 0:
+                        continue
+                    self.sections.append((section["sh_addr"], section.data()))
+
+    def get(self, addr):
+        for base, data in self.sections:
+            if base <= addr < base + len(data):
+                end = data.find(b"\0", addr - base)
+                if end < 0:
+                    end = len(data)
+                return data[addr - base:end].decode("utf-8", errors="replace")
+        return None
+
+
+def render(fmt, args):
+    """Rebuild the message from the format string and the packed arguments (little endian, 32-bit target)"""
+    out = []
+    offset = 0
+    pos = 0
+
+    def take(size, code):
+        nonlocal offset
+        if offset + size > len(args):
+            raise IndexError
+        value = struct.unpack_from(code, args, offset)[0]
+        offset += size
+        return value
+
+    try:
+        for match in SPEC_RE.finditer(fmt):
+            out.append(fmt[pos:match.start()])
+            pos = match.end()
+            flags, width, precision, length, conversion = match.groups()
+
+            if conversion == "%":
+                out.append("%")
+                continue
+            if conversion == "n":
+                continue
+
+            if width == "*":
+                width = str(take(4, "<i"))
+            if precision == "*":
+                precision = str(take(4, "<i"))
+
+            spec = "%" + flags + (width or "") + ("." + precision if precision is not None else "")
+
+            if conversion in "diouxX":
+                long_long = length in ("ll", "j")
+                signed = conversion in "di"
+                value = take(8, "<q" if signed else "<Q") if long_long else take(4, "<i" if signed else "<I")
+                out.append((spec + conversion.replace("u", "d")) % value)
+            elif conversion in "fFeEgGaA":
+                value = take(8, "<d")
+                if conversion in "aA":
+                    out.append(value.hex())
+                else:
+                    out.append((spec + conversion) % value)
+            elif conversion == "c":
+                out.append((spec + "c") % chr(take(4, "<I") & 0xff))
+            elif conversion == "p":
+                out.append((spec + "s") % hex(take(4, "<I")))
+            elif conversion == "s":
+                end = args.find(b"\0", offset)
+                if end < 0:
+                    end = len(args)
+                out.append((spec + "s") % args[offset:end].decode("utf-8", errors="replace"))
+                offset = end + 1
+    except IndexError:
+        out.append("<truncated>")
+        return "".join(out)
+
+    out.append(fmt[pos:])
+    return "".join(out)
+
+
+def decode(dump, strings, cpu_freq):
+    offset = 0
+    while offset + LOG_HEADER_SIZE <= len(dump):
+        entry_type, entry_length = dump[offset], dump[offset + LOG_TYPE_SIZE]
+        timestamp = struct.unpack_from("<I", dump, offset + LOG_TYPE_SIZE + LOG_LENGTH_SIZE)[0]
+
+        if entry_type == LOG_END:
+            break
+
+        # Skip over erased or corrupt memory one byte at a time until a plausible entry is found
+        if entry_length < LOG_HEADER_SIZE or entry_type > LOG_COMMITTED_DEFERRED:
+            offset += 1
+            continue
+
+        payload = dump[offset + LOG_HEADER_SIZE:offset + entry_length]
+        offset += entry_length
+
+        if entry_type == LOG_COMMITTED:
+            message = payload.split(b"\0", 1)[0].decode("utf-8", errors="replace")
+        elif entry_type == LOG_COMMITTED_DEFERRED:
+            format_addr = struct.unpack_from("<I", payload, 0)[0]
+            fmt = strings.get(format_addr)
+            if fmt is None:
+                message = f"<unknown format string at 0x{format_addr:08x}> {payload[LOG_FORMAT_ADDR_SIZE:].hex()}\n"
+            else:
+                message = render(fmt, payload[LOG_FORMAT_ADDR_SIZE:])
+        else:
+            continue
+
+        print(f"{timestamp / cpu_freq:12.6f}: {message}", end="" if message.endswith("\n") else "\n")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Decode a raw log dump")
+    parser.add_argument("dump", help="Raw binary dump of the log ring buffer or FRAM log area")
+    parser.add_argument("--elf", action="append", default=[], help="ELF file(s) containing the format strings")
+    parser.add_argument("--cpu-freq", type=float, default=250e6, help="DWT CYCCNT frequency used for timestamps")
+    args = parser.parse_args()
+
+    with open(args.dump, "rb") as f:
+        dump = f.read()
+
+    decode(dump, FormatStrings(args.elf), args.cpu_freq)
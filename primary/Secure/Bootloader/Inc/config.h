@@ -21,6 +21,13 @@
 #define DISABLE_S_SYSTICK_IN_NS (false) /* Whether or not to disable the secure systick when in a non-secure context */
 
 #define ENABLE_UART_LOGGING     (true)
+#define ENABLE_DEFERRED_LOGGING (true)  /* Store the format string address and raw arguments instead of formatting when logging */
+
+#define LOG_UART_BUFFER_SIZE    (1024)       /* Size of the DMA buffer used to drain the log to the UART */
+#define LOG_UART_MAX_BACKLOG    (8 * 1024)   /* Entries further than this behind the head are dropped rather than sent to the UART */
+#define LOG_NS_TEXT_ARGS_SIZE   (128)        /* Argument space for non-secure logs whose format string isn't in flash. These are formatted on the caller's secure stack */
+
+#define RANDOM_FILL_MAX_WORDS   (64)         /* Largest request s_random_fill() will serve for the non-secure world */
 
 /* ---------------------------------------------------------------------------- */
 /* Flash Config (must be updated if the linker file is changed) */
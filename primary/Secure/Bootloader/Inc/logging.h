@@ -70,10 +70,14 @@
 
 #define LOG_MAX_ENTRY_SIZE       (LOG_HEADER_SIZE + LOG_MAX_MESSAGE_LENGTH)
 
+#define LOG_FORMAT_ADDR_SIZE     (4) /* Deferred entries start with the address of the format string */
+#define LOG_MAX_ARGS_SIZE        (LOG_MAX_MESSAGE_LENGTH - LOG_FORMAT_ADDR_SIZE)
+
 #define LOG_INVALID              (0)
 #define LOG_EMPTY                (1)
 #define LOG_END                  (2)
-#define LOG_COMMITTED            (3)
+#define LOG_COMMITTED            (3) /* Payload is the formatted null terminated message */
+#define LOG_COMMITTED_DEFERRED   (4) /* Payload is the format string address followed by the raw arguments */
 
 
 typedef enum {
@@ -89,7 +93,9 @@ typedef struct {
     uint32_t tail_offset;
     uint8_t *log_buffer;
     uint32_t buffer_size;
-    uint32_t offset_mask; /* E.g 0x0001ffff for 128KiB buffer */
+    uint32_t offset_mask;  /* E.g 0x0001ffff for 128KiB buffer */
+    uint32_t uart_offset;  /* Read cursor of the UART drain (independent of the head and tail) */
+    uint32_t uart_dropped; /* Entries that were never sent to the UART because it fell behind */
 } log_handle_t;
 
 
@@ -99,7 +105,12 @@ extern log_handle_t hlog;
 log_status_t log_init(log_handle_t *self, uint8_t *log_buffer, uint32_t buffer_size);
 log_status_t log_write(log_handle_t *self, const char *format, ...);
 log_status_t log_vwrite(log_handle_t *self, const char *format, va_list args);
+log_status_t log_vwrite_text(log_handle_t *self, const char *format, va_list args);
+log_status_t log_vwrite_ns(log_handle_t *self, const char *format, va_list args);
 log_status_t log_dump_to_fram(log_handle_t *self, metadata_handle_t *meta);
+uint32_t     log_format_entry(const uint8_t *entry, char *buffer, uint32_t size);
+void         log_uart_drain(log_handle_t *self);
+void         log_uart_flush(log_handle_t *self);
 
 uint8_t u4_to_hex(char *buffer, uint8_t num);
 uint8_t u8_to_hex(char *buffer, uint8_t num);
@@ -24,6 +24,9 @@ void error_handler(error_t major_error_code, uint8_t minor_error_code) {
     /* NO_CHECK required to prevent recursion */
     LOG_ERROR_NO_CHECK("Error handler :(\n");
 
+    /* Interrupts are disabled so the UART drain has to be run manually */
+    log_uart_flush(&hlog);
+
     /* Store the most recent logs into the FRAM */
     log_dump_to_fram(&hlog, &hmeta);
 
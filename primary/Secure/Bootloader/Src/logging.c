@@ -6,12 +6,15 @@
  */
 
 #include "stdint.h"
+#include "stdbool.h"
 #include "stdio.h"
 #include "stdarg.h"
 #include "stdatomic.h"
 #include "memory.h"
+#include "string.h"
 #include "hal.h"
 #include "usart.h"
+#include "arm_cmse.h"
 
 #include "logging.h"
 #include "integrity.h"
@@ -29,19 +32,7 @@ extern UART_HandleTypeDef huart4;
 
 
 #if ENABLE_UART_LOGGING == true
-int _write(int file, char *ptr, int len) {
-
-    hal_status_t status = HAL_OK;
-
-    while (huart4.gState != HAL_UART_STATE_READY);
-    status = HAL_UART_Transmit(&huart4, (uint8_t *) ptr, len, 1000);
-
-    if (status == HAL_OK) {
-        return len;
-    } else {
-        return -1;
-    }
-}
+static uint8_t log_uart_buffer[LOG_UART_BUFFER_SIZE];
 #endif
 
 
@@ -62,8 +53,10 @@ log_status_t log_init(log_handle_t *self, uint8_t *log_buffer, uint32_t buffer_s
     self->offset_mask = buffer_size - 1;
 
     /* Reset parameters */
-    self->head_offset = 0;
-    self->tail_offset = 0;
+    self->head_offset  = 0;
+    self->tail_offset  = 0;
+    self->uart_offset  = 0;
+    self->uart_dropped = 0;
 
 #ifdef DEBUG
     memset(log_buffer, 0, buffer_size);
@@ -131,10 +124,6 @@ log_status_t log_write(log_handle_t *self, const char *format, ...) {
 
     log_status_t status = LOGGING_OK;
 
-#if ENABLE_UART_LOGGING == true
-    printf("S  %10lu: ", HAL_GetTick());
-#endif
-
     va_list args;
     va_start(args, format);
     status = log_vwrite(self, format, args);
@@ -144,61 +133,426 @@ log_status_t log_write(log_handle_t *self, const char *format, ...) {
 }
 
 
-log_status_t log_vwrite(log_handle_t *self, const char *format, va_list args) {
+/* Reserve an entry of the given size that doesn't cross over the end of the buffer. If the reserved space would wrap
+ * then it is published as an empty entry and a new space is reserved at the start of the buffer. */
+static log_status_t log_acquire_entry(log_handle_t *self, uint32_t size, uint32_t *old_head_offset, uint32_t *new_head_offset) {
 
     log_status_t status = LOGGING_OK;
+    uint8_t     *write_ptr;
 
-    uint32_t old_head_offset;
-    uint32_t new_head_offset;
-    uint32_t new_new_head_offset;
-    uint32_t message_length;
-    uint8_t *write_ptr;
-
-    /* Timestamp using CYCCNT (32-bit free running 250MHz counter). This is the same as TraceX */
-    uint32_t timestamp = atomic_load(&DWT->CYCCNT);
-
-    /* Reserve the maximum space initially. If the message is shorter and isn't interrupted by another
-     * log then this will be shrunk later. */
-    status = log_acquire_space(self, LOG_MAX_ENTRY_SIZE, &old_head_offset, &new_head_offset);
+    status = log_acquire_space(self, size, old_head_offset, new_head_offset);
     if (status != LOGGING_OK) return status;
 
-    /* Get the write pointer */
-    write_ptr = PTR_FROM_OFFSET(old_head_offset);
-
     /* Check if the buffer wraps */
-    if ((new_head_offset & self->offset_mask) < (old_head_offset & self->offset_mask)) {
+    if ((*new_head_offset & self->offset_mask) < (*old_head_offset & self->offset_mask)) {
+
+        /* Get the write pointer */
+        write_ptr = PTR_FROM_OFFSET(*old_head_offset);
 
         /* Set the log type to invalid */
         atomic_store_explicit(write_ptr, LOG_INVALID, memory_order_release);
 
-        /* Write the max length (with wrap safe behaviour) */
-        *PTR_FROM_OFFSET(old_head_offset + LOG_TYPE_SIZE) = LOG_MAX_ENTRY_SIZE;
+        /* Write the length (with wrap safe behaviour) */
+        *PTR_FROM_OFFSET(*old_head_offset + LOG_TYPE_SIZE) = size;
 
         /* Write LOG_EMPTY in the type to publish it */
         atomic_store_explicit(write_ptr, LOG_EMPTY, memory_order_release);
 
         /* Acquire a new buffer */
-        status = log_acquire_space(self, LOG_MAX_ENTRY_SIZE, &old_head_offset, &new_head_offset);
+        status = log_acquire_space(self, size, old_head_offset, new_head_offset);
         if (status != LOGGING_OK) return status;
-
-        /* Get the write pointer */
-        write_ptr = PTR_FROM_OFFSET(old_head_offset);
     }
 
+    return status;
+}
+
+
+/* Write the entry type (invalid until committed), length and timestamp */
+static void log_write_header(uint8_t *write_ptr, uint32_t size, uint32_t timestamp) {
+
     /* Set the log type to invalid */
     atomic_store_explicit(write_ptr, LOG_INVALID, memory_order_release);
 
     /* Write the message length */
-    *(write_ptr + LOG_TYPE_SIZE) = LOG_MAX_ENTRY_SIZE;
+    *(write_ptr + LOG_TYPE_SIZE) = size;
 
     /* Write the message timestamp. Byte access ensures no memory alignment faults */
     for (uint_fast8_t i = 0; i < sizeof(timestamp); i++) {
         *(write_ptr + LOG_TYPE_SIZE + LOG_LENGTH_SIZE + i) = ((uint8_t *) (&timestamp))[i];
     }
+}
 
-    /* Write the message */
-    message_length = vsnprintf((char *) write_ptr + LOG_HEADER_SIZE, LOG_MAX_MESSAGE_LENGTH, format, args);
-    message_length++; /* Account for the null terminator */
+
+/* How an argument is stored in a deferred entry */
+typedef enum {
+    LOG_ARG_NONE,   /* Nothing is stored (e.g. %%) */
+    LOG_ARG_SKIP,   /* The argument is consumed but not stored (%n) */
+    LOG_ARG_WORD,   /* 32-bit integer, character or pointer */
+    LOG_ARG_DWORD,  /* 64-bit integer */
+    LOG_ARG_DOUBLE, /* 64-bit double (floats are promoted) */
+    LOG_ARG_STRING, /* Null terminated string copied inline */
+} log_arg_t;
+
+
+/* Parse a conversion specification. spec must point to the '%'. Returns a pointer to the conversion character and
+ * sets the number of '*' fields (each consumes an int argument) and the storage class of the argument. */
+static const char *log_parse_spec(const char *spec, uint_fast8_t *stars, log_arg_t *arg) {
+
+    bool long_long = false;
+
+    *stars = 0;
+    spec++;
+
+    /* Flags */
+    while (*spec == '-' || *spec == '+' || *spec == ' ' || *spec == '#' || *spec == '0') spec++;
+
+    /* Width */
+    if (*spec == '*') {
+        (*stars)++;
+        spec++;
+    }
+    while (*spec >= '0' && *spec <= '9') spec++;
+
+    /* Precision */
+    if (*spec == '.') {
+        spec++;
+        if (*spec == '*') {
+            (*stars)++;
+            spec++;
+        }
+        while (*spec >= '0' && *spec <= '9') spec++;
+    }
+
+    /* Length modifiers (int, long, size_t, ptrdiff_t and pointers are all 32-bit) */
+    while (*spec == 'h' || *spec == 'l' || *spec == 'z' || *spec == 't' || *spec == 'j' || *spec == 'L') {
+        if (*spec == 'j' || (spec[0] == 'l' && spec[1] == 'l')) long_long = true;
+        spec++;
+    }
+
+    switch (*spec) {
+        case '%':
+            *arg = LOG_ARG_NONE;
+            break;
+        case 'n':
+            *arg = LOG_ARG_SKIP;
+            break;
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+            *arg = long_long ? LOG_ARG_DWORD : LOG_ARG_WORD;
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            *arg = LOG_ARG_DOUBLE;
+            break;
+        case 's':
+            *arg = LOG_ARG_STRING;
+            break;
+        case '\0':
+            *arg = LOG_ARG_NONE;
+            spec--; /* Don't run off the end of a truncated format string */
+            break;
+        default: /* 'c', 'p' */
+            *arg = LOG_ARG_WORD;
+            break;
+    }
+
+    return spec;
+}
+
+
+/* Length of a string from the non-secure world up to max_length, checking the non-secure world can read every byte up to
+ * the null terminator. SAU and MPU regions are at least 32 bytes so each 32 byte block only has to be checked once.
+ * Returns -1 if the non-secure world can't read the string */
+static int32_t log_ns_strnlen(const char *str, uint32_t max_length) {
+
+    for (uint32_t i = 0; i < max_length; i++) {
+        if ((i == 0) || ((((uint32_t) &str[i]) & 0x1f) == 0)) {
+            if (cmse_check_address_range((void *) &str[i], 1, CMSE_NONSECURE | CMSE_MPU_READ) == NULL) return -1;
+        }
+        if (str[i] == '\0') return i;
+    }
+
+    return max_length;
+}
+
+
+/* Copy the raw arguments into buffer (or just measure them if buffer is NULL). Arguments that don't fit are
+ * dropped and strings are truncated. Strings from the non-secure world are only copied if it can read them itself,
+ * otherwise they are replaced. Returns the number of bytes used. */
+static uint32_t log_pack_args(uint8_t *buffer, uint32_t size, const char *format, va_list args, bool non_secure) {
+
+    uint32_t     length = 0;
+    uint_fast8_t stars;
+    log_arg_t    arg;
+    uint32_t     word;
+    uint64_t     dword;
+    double       dbl;
+    const char  *str;
+    int32_t      str_length;
+
+    for (const char *p = format; *p != '\0'; p++) {
+        if (*p != '%') continue;
+
+        p = log_parse_spec(p, &stars, &arg);
+
+        /* Width and precision arguments */
+        for (uint_fast8_t i = 0; i < stars; i++) {
+            word = va_arg(args, int);
+            if (length + sizeof(word) > size) return length;
+            if (buffer) memcpy(buffer + length, &word, sizeof(word));
+            length += sizeof(word);
+        }
+
+        switch (arg) {
+            case LOG_ARG_SKIP:
+                (void) va_arg(args, void *);
+                break;
+
+            case LOG_ARG_WORD:
+                word = va_arg(args, uint32_t);
+                if (length + sizeof(word) > size) return length;
+                if (buffer) memcpy(buffer + length, &word, sizeof(word));
+                length += sizeof(word);
+                break;
+
+            case LOG_ARG_DWORD:
+                dword = va_arg(args, uint64_t);
+                if (length + sizeof(dword) > size) return length;
+                if (buffer) memcpy(buffer + length, &dword, sizeof(dword));
+                length += sizeof(dword);
+                break;
+
+            case LOG_ARG_DOUBLE:
+                dbl = va_arg(args, double);
+                if (length + sizeof(dbl) > size) return length;
+                if (buffer) memcpy(buffer + length, &dbl, sizeof(dbl));
+                length += sizeof(dbl);
+                break;
+
+            case LOG_ARG_STRING:
+                str = va_arg(args, const char *);
+                if (str == NULL) str = "(null)";
+                if (length >= size) return length;
+                str_length = non_secure ? log_ns_strnlen(str, size - length - 1) : (int32_t) strnlen(str, size - length - 1);
+                if (str_length < 0) {
+                    str        = "(invalid)";
+                    str_length = strnlen(str, size - length - 1);
+                }
+                if (buffer) {
+                    memcpy(buffer + length, str, str_length);
+                    buffer[length + str_length] = '\0';
+                }
+                length += str_length + 1;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    return length;
+}
+
+
+/* Format a deferred payload (raw arguments) using the original format string */
+static uint32_t log_render(char *buffer, uint32_t size, const char *format, const uint8_t *args, uint32_t args_length) {
+
+    uint32_t     length = 0;
+    uint32_t     offset = 0;
+    uint_fast8_t stars;
+    log_arg_t    arg;
+    int32_t      star[2];
+    char         spec[16];
+    uint32_t     spec_length;
+    int          written;
+    uint32_t     word;
+    uint64_t     dword;
+    double       dbl;
+
+    if (size == 0) return 0;
+
+/* Format a single argument with the width/precision arguments that preceded it */
+#define LOG_RENDER_ARG(value)                                                                                                  \
+    ((stars == 0)   ? snprintf(buffer + length, size - length, spec, (value))                                                   \
+     : (stars == 1) ? snprintf(buffer + length, size - length, spec, (int) star[0], (value))                                    \
+                    : snprintf(buffer + length, size - length, spec, (int) star[0], (int) star[1], (value)))
+
+    for (const char *p = format; (*p != '\0') && (length < (size - 1)); p++) {
+
+        /* Literal characters */
+        if (*p != '%') {
+            buffer[length++] = *p;
+            continue;
+        }
+
+        const char *start = p;
+        p                 = log_parse_spec(p, &stars, &arg);
+
+        if (arg == LOG_ARG_NONE) {
+            if (*p == '%') buffer[length++] = '%';
+            continue;
+        }
+
+        /* Copy the conversion specification so it can be passed to snprintf on its own */
+        spec_length = p - start + 1;
+        if (spec_length >= sizeof(spec)) break;
+        memcpy(spec, start, spec_length);
+        spec[spec_length] = '\0';
+
+        /* Width and precision arguments */
+        for (uint_fast8_t i = 0; i < stars; i++) {
+            if (offset + sizeof(star[i]) > args_length) goto end;
+            memcpy(&star[i], args + offset, sizeof(star[i]));
+            offset += sizeof(star[i]);
+        }
+
+        switch (arg) {
+            case LOG_ARG_WORD:
+                if (offset + sizeof(word) > args_length) goto end;
+                memcpy(&word, args + offset, sizeof(word));
+                offset  += sizeof(word);
+                written  = LOG_RENDER_ARG(word);
+                break;
+
+            case LOG_ARG_DWORD:
+                if (offset + sizeof(dword) > args_length) goto end;
+                memcpy(&dword, args + offset, sizeof(dword));
+                offset  += sizeof(dword);
+                written  = LOG_RENDER_ARG(dword);
+                break;
+
+            case LOG_ARG_DOUBLE:
+                if (offset + sizeof(dbl) > args_length) goto end;
+                memcpy(&dbl, args + offset, sizeof(dbl));
+                offset  += sizeof(dbl);
+                written  = LOG_RENDER_ARG(dbl);
+                break;
+
+            case LOG_ARG_STRING:
+                if (offset >= args_length) goto end;
+                written  = LOG_RENDER_ARG((const char *) (args + offset));
+                offset  += strnlen((const char *) (args + offset), args_length - offset) + 1;
+                break;
+
+            default:
+                written = 0;
+                break;
+        }
+
+        if (written < 0) break;
+        length += written;
+        if (length > (size - 1)) length = size - 1;
+    }
+
+#undef LOG_RENDER_ARG
+
+end:
+    buffer[length] = '\0';
+
+    return length;
+}
+
+
+#if ENABLE_DEFERRED_LOGGING == true
+
+/* Whether all of [addr, addr + size) is in the non-secure flash region of one of the banks */
+static bool log_in_ns_flash(const void *addr, uint32_t size) {
+
+    uint32_t start = (uint32_t) addr;
+    uint32_t end   = start + size;
+
+    return ((start >= (FLASH_NS_BANK1_BASE_ADDR + FLASH_NS_REGION_OFFSET)) && (end <= (FLASH_NS_BANK1_BASE_ADDR + FLASH_NS_REGION_OFFSET + FLASH_NS_REGION_SIZE))) ||
+           ((start >= (FLASH_NS_BANK2_BASE_ADDR + FLASH_NS_REGION_OFFSET)) && (end <= (FLASH_NS_BANK2_BASE_ADDR + FLASH_NS_REGION_OFFSET + FLASH_NS_REGION_SIZE)));
+}
+
+
+/* Store the format string address and the raw arguments. Formatting is done when the log is read out */
+static log_status_t log_vwrite_deferred(log_handle_t *self, const char *format, va_list args, bool non_secure) {
+
+    log_status_t status = LOGGING_OK;
+
+    uint32_t old_head_offset;
+    uint32_t new_head_offset;
+    uint32_t args_length;
+    uint32_t entry_length;
+    uint32_t format_addr = (uint32_t) format;
+    uint8_t *write_ptr;
+    va_list  args_copy;
+
+    /* Timestamp using CYCCNT (32-bit free running 250MHz counter). This is the same as TraceX */
+    uint32_t timestamp = atomic_load(&DWT->CYCCNT);
+
+    /* Measure the arguments so only the exact space is reserved */
+    va_copy(args_copy, args);
+    args_length = log_pack_args(NULL, LOG_MAX_ARGS_SIZE, format, args_copy, non_secure);
+    va_end(args_copy);
+    entry_length = LOG_HEADER_SIZE + LOG_FORMAT_ADDR_SIZE + args_length;
+
+    status = log_acquire_entry(self, entry_length, &old_head_offset, &new_head_offset);
+    if (status != LOGGING_OK) return status;
+
+    /* Get the write pointer */
+    write_ptr = PTR_FROM_OFFSET(old_head_offset);
+
+    log_write_header(write_ptr, entry_length, timestamp);
+
+    /* Write the format string address. Byte access ensures no memory alignment faults */
+    for (uint_fast8_t i = 0; i < sizeof(format_addr); i++) {
+        *(write_ptr + LOG_HEADER_SIZE + i) = ((uint8_t *) (&format_addr))[i];
+    }
+
+    /* Write the arguments */
+    log_pack_args(write_ptr + LOG_HEADER_SIZE + LOG_FORMAT_ADDR_SIZE, args_length, format, args, non_secure);
+
+    /* Write the message type to signify it is valid */
+    atomic_store_explicit(write_ptr, LOG_COMMITTED_DEFERRED, memory_order_release);
+
+#if ENABLE_UART_LOGGING == true
+    /* Wake up the UART drain if it is idle */
+    if (huart4.gState == HAL_UART_STATE_READY) HAL_NVIC_SetPendingIRQ(UART4_IRQn);
+#endif
+
+    return status;
+}
+
+#endif /* ENABLE_DEFERRED_LOGGING == true */
+
+
+/* Reserve the maximum space for a text entry. If the message is shorter and isn't interrupted by another log then this
+ * will be shrunk when it is committed */
+static log_status_t log_text_acquire(log_handle_t *self, uint32_t *old_head_offset, uint32_t *new_head_offset, uint8_t **write_ptr) {
+
+    log_status_t status = LOGGING_OK;
+
+    /* Timestamp using CYCCNT (32-bit free running 250MHz counter). This is the same as TraceX */
+    uint32_t timestamp = atomic_load(&DWT->CYCCNT);
+
+    status = log_acquire_entry(self, LOG_MAX_ENTRY_SIZE, old_head_offset, new_head_offset);
+    if (status != LOGGING_OK) return status;
+
+    /* Get the write pointer */
+    *write_ptr = PTR_FROM_OFFSET(*old_head_offset);
+
+    log_write_header(*write_ptr, LOG_MAX_ENTRY_SIZE, timestamp);
+
+    return status;
+}
+
+
+/* Publish a text entry once the message (including the null terminator) has been written */
+static void log_text_commit(log_handle_t *self, uint32_t old_head_offset, uint32_t new_head_offset, uint8_t *write_ptr, uint32_t message_length) {
+
+    uint32_t new_new_head_offset;
 
     /* Attempt to reduce the length field if the max size isn't needed */
     if (message_length < LOG_MAX_MESSAGE_LENGTH) {
@@ -218,14 +572,125 @@ log_status_t log_vwrite(log_handle_t *self, const char *format, va_list args) {
     atomic_store_explicit(write_ptr, LOG_COMMITTED, memory_order_release);
 
 #if ENABLE_UART_LOGGING == true
-    /* Write the message contents to UART as well */
-    printf((char *) write_ptr + LOG_HEADER_SIZE, message_length);
+    /* Wake up the UART drain if it is idle */
+    if (huart4.gState == HAL_UART_STATE_READY) HAL_NVIC_SetPendingIRQ(UART4_IRQn);
+#endif
+}
+
+
+log_status_t log_vwrite(log_handle_t *self, const char *format, va_list args) {
+#if ENABLE_DEFERRED_LOGGING == true
+    return log_vwrite_deferred(self, format, args, false);
+#else
+    return log_vwrite_text(self, format, args);
 #endif
+}
+
+
+/* Format the message now and store the text */
+log_status_t log_vwrite_text(log_handle_t *self, const char *format, va_list args) {
+
+    log_status_t status = LOGGING_OK;
+
+    uint32_t old_head_offset;
+    uint32_t new_head_offset;
+    uint32_t message_length;
+    uint8_t *write_ptr;
+
+    status = log_text_acquire(self, &old_head_offset, &new_head_offset, &write_ptr);
+    if (status != LOGGING_OK) return status;
+
+    /* Write the message */
+    message_length = vsnprintf((char *) write_ptr + LOG_HEADER_SIZE, LOG_MAX_MESSAGE_LENGTH, format, args);
+    message_length++; /* Account for the null terminator */
+
+    log_text_commit(self, old_head_offset, new_head_offset, write_ptr, message_length);
+
+    return status;
+}
+
+
+/* Log for the non-secure world. The format string must be shorter than LOG_MAX_MESSAGE_LENGTH and, like any string
+ * arguments, readable by the non-secure world itself. A format string in the non-secure flash can't change under us, so
+ * it is stored as a deferred entry like secure logs. Anything else is copied and formatted now on the caller's secure
+ * stack, with the arguments limited to LOG_NS_TEXT_ARGS_SIZE bytes. vsnprintf() is never used since it would follow
+ * string arguments and %n with secure privileges */
+log_status_t log_vwrite_ns(log_handle_t *self, const char *format, va_list args) {
+
+    log_status_t status = LOGGING_OK;
+
+    uint32_t old_head_offset;
+    uint32_t new_head_offset;
+    int32_t  format_length = log_ns_strnlen(format, LOG_MAX_MESSAGE_LENGTH);
+    uint32_t args_length;
+    uint32_t message_length;
+    uint8_t *write_ptr;
+    char     format_copy[LOG_MAX_MESSAGE_LENGTH];
+    uint8_t  args_copy[LOG_NS_TEXT_ARGS_SIZE];
+
+    if ((format_length < 0) || (format_length >= LOG_MAX_MESSAGE_LENGTH)) return LOGGING_PARAMETER_ERROR;
+
+#if ENABLE_DEFERRED_LOGGING == true
+    if (log_in_ns_flash(format, format_length + 1)) return log_vwrite_deferred(self, format, args, true);
+#endif
+
+    /* Take a copy of the format so the non-secure world can't change it while it is parsed */
+    memcpy(format_copy, format, format_length);
+    format_copy[format_length] = '\0';
+
+    args_length = log_pack_args(args_copy, sizeof(args_copy), format_copy, args, true);
+
+    status = log_text_acquire(self, &old_head_offset, &new_head_offset, &write_ptr);
+    if (status != LOGGING_OK) return status;
+
+    /* Write the message */
+    message_length = log_render((char *) write_ptr + LOG_HEADER_SIZE, LOG_MAX_MESSAGE_LENGTH, format_copy, args_copy, args_length);
+    message_length++; /* Account for the null terminator */
+
+    log_text_commit(self, old_head_offset, new_head_offset, write_ptr, message_length);
 
     return status;
 }
 
 
+/* Convert a committed entry (of either type) to text. The entry must not cross over the end of the buffer */
+uint32_t log_format_entry(const uint8_t *entry, char *buffer, uint32_t size) {
+
+    uint32_t entry_length = *(entry + LOG_TYPE_SIZE);
+    uint32_t length       = 0;
+
+    if (size == 0) return 0;
+
+    switch (*entry) {
+
+        case LOG_COMMITTED:
+            length = entry_length - LOG_HEADER_SIZE;
+            if (length > (size - 1)) length = size - 1;
+            length = strnlen((const char *) entry + LOG_HEADER_SIZE, length);
+            memcpy(buffer, entry + LOG_HEADER_SIZE, length);
+            break;
+
+#if ENABLE_DEFERRED_LOGGING == true
+        case LOG_COMMITTED_DEFERRED: {
+            uint32_t format_addr = 0;
+            for (uint_fast8_t i = 0; i < sizeof(format_addr); i++) {
+                ((uint8_t *) (&format_addr))[i] = *(entry + LOG_HEADER_SIZE + i);
+            }
+            return log_render(buffer, size, (const char *) format_addr, entry + LOG_HEADER_SIZE + LOG_FORMAT_ADDR_SIZE,
+                              entry_length - LOG_HEADER_SIZE - LOG_FORMAT_ADDR_SIZE);
+        }
+#endif
+
+        default:
+            break;
+    }
+
+    buffer[length] = '\0';
+
+    return length;
+}
+
+
 log_status_t log_dump_to_fram(log_handle_t *self, metadata_handle_t *meta) {
 
     log_status_t status = LOGGING_OK;
@@ -274,6 +739,110 @@ log_status_t log_dump_to_fram(log_handle_t *self, metadata_handle_t *meta) {
     return status;
 }
 
+#if ENABLE_UART_LOGGING == true
+
+/* Render as many committed entries as fit into the UART buffer, starting at the UART read cursor. Returns the number
+ * of bytes to send. Only one context may call this at a time (the UART interrupt or the error handler). */
+static uint32_t log_uart_fill(log_handle_t *self) {
+
+    uint32_t head_offset = atomic_load(&self->head_offset);
+    uint32_t tail_offset = atomic_load(&self->tail_offset);
+    uint32_t length      = 0;
+    uint32_t entry_length;
+    uint32_t timestamp;
+    uint8_t *entry;
+    uint8_t  type;
+
+    /* The writers have lapped the drain. The number of entries lost is unknown so count it as one */
+    if ((int32_t) (tail_offset - self->uart_offset) > 0) {
+        self->uart_offset = tail_offset;
+        self->uart_dropped++;
+    }
+
+    /* Drop the oldest entries rather than fall further behind */
+    while ((head_offset - self->uart_offset) > LOG_UART_MAX_BACKLOG) {
+        entry_length = *PTR_FROM_OFFSET(self->uart_offset + LOG_TYPE_SIZE);
+        if (entry_length < LOG_HEADER_SIZE || entry_length > LOG_MAX_ENTRY_SIZE) break;
+        if (*PTR_FROM_OFFSET(self->uart_offset) >= LOG_COMMITTED) self->uart_dropped++;
+        self->uart_offset += entry_length;
+    }
+
+    while (self->uart_offset != head_offset) {
+
+        entry = PTR_FROM_OFFSET(self->uart_offset);
+        type  = atomic_load_explicit(entry, memory_order_acquire);
+
+        /* Stop at the first entry that is still being written, the writer will wake the drain again */
+        if (type == LOG_INVALID) break;
+
+        entry_length = *PTR_FROM_OFFSET(self->uart_offset + LOG_TYPE_SIZE);
+        if (entry_length < LOG_HEADER_SIZE || entry_length > LOG_MAX_ENTRY_SIZE) break;
+
+        if (type >= LOG_COMMITTED) {
+
+            /* Leave the entry for the next transfer if it might not fit */
+            if ((LOG_UART_BUFFER_SIZE - length) < (LOG_MAX_MESSAGE_LENGTH + 16)) break;
+
+            /* Entries never cross over the end of the buffer so the timestamp can be read directly (byte access) */
+            for (uint_fast8_t i = 0; i < sizeof(timestamp); i++) {
+                ((uint8_t *) (&timestamp))[i] = *(entry + LOG_TYPE_SIZE + LOG_LENGTH_SIZE + i);
+            }
+
+            length += snprintf((char *) log_uart_buffer + length, LOG_UART_BUFFER_SIZE - length, "%10lu: ", timestamp);
+            length += log_format_entry(entry, (char *) log_uart_buffer + length, LOG_UART_BUFFER_SIZE - length);
+        }
+
+        self->uart_offset += entry_length;
+    }
+
+    return length;
+}
+
+
+/* Send the next batch of log entries to the UART by DMA. Called from the UART interrupt so it never runs in the
+ * context of the thread that wrote the log. Writers only pend the interrupt. */
+void log_uart_drain(log_handle_t *self) {
+
+    uint32_t length;
+
+    /* Already sending, this will be called again when the transfer completes */
+    if (huart4.gState != HAL_UART_STATE_READY) return;
+
+    length = log_uart_fill(self);
+    if (length == 0) return;
+
+    if (HAL_UART_Transmit_DMA(&huart4, log_uart_buffer, length) != HAL_OK) {
+        self->uart_dropped++;
+    }
+}
+
+
+/* Send everything that hasn't been sent yet by polling. Used by the error handler when interrupts are disabled */
+void log_uart_flush(log_handle_t *self) {
+
+    uint32_t length;
+
+    /* The in progress transfer can't complete without interrupts */
+    if (huart4.gState != HAL_UART_STATE_READY) HAL_UART_AbortTransmit(&huart4);
+
+    while ((length = log_uart_fill(self)) > 0) {
+        if (HAL_UART_Transmit(&huart4, log_uart_buffer, length, 1000) != HAL_OK) return;
+    }
+}
+
+#else
+
+void log_uart_drain(log_handle_t *self) {
+    UNUSED(self);
+}
+
+void log_uart_flush(log_handle_t *self) {
+    UNUSED(self);
+}
+
+#endif /* ENABLE_UART_LOGGING == true */
+
+
 uint8_t u4_to_hex(char *buffer, uint8_t num) {
 
     if (num < 10) {
@@ -5,11 +5,14 @@
  *      Author: bens1
  */
 
+#include "arm_cmse.h"
+
 #include "secure_nsc.h"
 #include "metadata.h"
 #include "error.h"
 #include "logging.h"
 #include "config.h"
+#include "rng.h"
 
 
 #if DISABLE_S_SYSTICK_IN_NS == true
@@ -65,14 +68,37 @@ CMSE_NS_ENTRY void s_log_vwrite(const char *format, va_list args) {
 
     START_NSC;
 
-#if ENABLE_UART_LOGGING == true
-    printf("NS %10lu: ", HAL_GetTick());
-#endif
-
     log_status_t status = LOGGING_OK;
 
-    status = log_vwrite(&hlog, format, args);
+    /* Fails if the format string can't be read by the non-secure world */
+    status = log_vwrite_ns(&hlog, format, args);
     CHECK_STATUS_LOG(status);
 
     END_NSC;
 }
+
+
+/* Fill buf with words from the hardware RNG. This is only used to seed the random generator in the non-secure world
+ * so it isn't called often */
+CMSE_NS_ENTRY void s_random_fill(uint32_t *buf, uint32_t words) {
+
+    START_NSC;
+
+    HAL_StatusTypeDef status = HAL_OK;
+
+    /* The non-secure world must not be able to use this to overwrite secure memory. The size is limited first so the
+     * byte count can't overflow and make the range check pass for a smaller buffer than is written */
+    if (words > RANDOM_FILL_MAX_WORDS) {
+        error_handler(ERROR_GENERIC, 0);
+    }
+    if (cmse_check_address_range(buf, words * sizeof(uint32_t), CMSE_NONSECURE | CMSE_MPU_READWRITE) == NULL) {
+        error_handler(ERROR_GENERIC, 0);
+    }
+
+    for (uint32_t i = 0; i < words; i++) {
+        status = HAL_RNG_GenerateRandomNumber(&hrng, &buf[i]);
+        CHECK_STATUS(status, HAL_OK, ERROR_HAL);
+    }
+
+    END_NSC;
+}
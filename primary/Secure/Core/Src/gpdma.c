@@ -41,6 +41,10 @@ void MX_GPDMA1_Init(void)
 
   /* USER CODE BEGIN GPDMA1_Init 1 */
 
+  /* UART4 TX (log drain) */
+  HAL_NVIC_SetPriority(GPDMA1_Channel1_IRQn, 12, 0);
+  HAL_NVIC_EnableIRQ(GPDMA1_Channel1_IRQn);
+
   /* USER CODE END GPDMA1_Init 1 */
   /* USER CODE BEGIN GPDMA1_Init 2 */
 
@@ -71,7 +71,7 @@ extern UART_HandleTypeDef huart4;
 extern TIM_HandleTypeDef htim2;
 
 /* USER CODE BEGIN EV */
-
+extern DMA_HandleTypeDef handle_GPDMA1_Channel1;
 /* USER CODE END EV */
 
 /******************************************************************************/
@@ -348,6 +348,8 @@ void UART4_IRQHandler(void)
   HAL_UART_IRQHandler(&huart4);
   /* USER CODE BEGIN UART4_IRQn 1 */
 
+  /* Also pended by log writers to start draining the log */
+  log_uart_drain(&hlog);
   /* USER CODE END UART4_IRQn 1 */
 }
 
@@ -408,4 +410,12 @@ void PKA_IRQHandler(void)
 
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief This function handles GPDMA1 Channel 1 global interrupt (UART4 TX).
+  */
+void GPDMA1_Channel1_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&handle_GPDMA1_Channel1);
+}
+
 /* USER CODE END 1 */
@@ -45,6 +45,7 @@ void s_save_dhcp_client_record(const NX_DHCP_CLIENT_RECORD *record);
 void s_load_dhcp_client_record(NX_DHCP_CLIENT_RECORD *record);
 void s_background_task(void);
 void s_log_vwrite(const char *format, va_list args);
+void s_random_fill(uint32_t *buf, uint32_t words);
 
 
 #endif /* SECURE_NSC_H */
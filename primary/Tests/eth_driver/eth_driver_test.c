@@ -0,0 +1,961 @@
+/*
+ * eth_driver_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+/* Host test for the error recovery and transmit path in nx_stm32_eth_driver.c. The real driver and the real ETH HAL are built against a
+ * fake ETH peripheral held in RAM, with a small model of the DMA that fills and drains the descriptor rings, suspends
+ * reception when it runs out of descriptors and raises the same status bits the hardware would. NetX and ThreadX are
+ * replaced by a counting packet pool, a manually stepped timer and a loop standing in for the IP thread.
+ *
+ * The DMA model can't see register writes, so it watches for them by poisoning the registers it cares about. The list
+ * address registers are cleared once read, so a new non-zero value means the ring was set up again and the DMA starts
+ * from its first descriptor. The receive tail pointer is cleared when reception suspends, so a new value means the
+ * software handed descriptors back and reception resumes.
+ *
+ * The stand-in core header claims a data cache so the cache maintenance the driver asks for is recorded, the transmit
+ * tests check only the bytes each packet holds are cleaned.
+ *
+ * Each test runs in its own process so it starts from a freshly initialised driver. Built and run with make in this
+ * directory. The HAL casts buffer addresses to uint32_t, so everything the DMA touches is static and the binary is linked
+ * without PIE to keep it in the low 4 GB */
+
+#include "stdio.h"
+#include "stdint.h"
+#include "time.h"
+#include "stdbool.h"
+#include "string.h"
+#include "unistd.h"
+#include "sys/wait.h"
+
+#include "nx_stm32_eth_driver.h"
+#include "nx_stm32_phy_driver.h"
+#include "nx_stp.h"
+#include "config.h"
+#include "main.h"
+
+
+#define TEST_PACKET_SIZE  (1536 + 64)
+#define TEST_POOL_PACKETS (12)
+#define TEST_FRAME_LENGTH (60)
+#define TEST_TIMER_TICKS  (100)
+#define TEST_CACHE_LINE   (32)
+#define TEST_MAX_CLEANS   (16)
+#define TEST_TIMED_SENDS  (100000)
+
+
+#define CHECK(condition)                                                         \
+    do {                                                                         \
+        if (!(condition)) {                                                      \
+            printf("    FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition);    \
+            test_failures++;                                                     \
+        }                                                                        \
+    } while (0)
+
+
+typedef struct {
+    NX_PACKET_POOL pool;
+    NX_PACKET     *packets[TEST_POOL_PACKETS];
+    bool           in_use[TEST_POOL_PACKETS];
+    UINT           count;
+    UINT           double_frees;
+    uint8_t        memory[TEST_POOL_PACKETS][TEST_PACKET_SIZE] __attribute__((aligned(32)));
+} test_pool_t;
+
+
+/* Fake peripherals and the handle the driver and HAL share */
+ETH_HandleTypeDef heth;
+SBS_TypeDef       fake_sbs;
+EXTI_TypeDef      fake_exti;
+
+static ETH_TypeDef        fake_eth;
+static ETH_DMADescTypeDef rx_descriptors[ETH_RX_DESC_CNT] __attribute__((aligned(32)));
+static ETH_DMADescTypeDef tx_descriptors[ETH_TX_DESC_CNT] __attribute__((aligned(32)));
+
+/* DMA model state */
+static UINT     dma_rx_index;
+static UINT     dma_tx_index;
+static bool     dma_rx_suspended;
+static bool     dma_stopped;
+static uint32_t dma_status;
+static UINT     dma_frames_received;
+static UINT     dma_frames_dropped;
+static UINT     dma_frames_sent;
+
+/* NetX and ThreadX stand-ins */
+static NX_IP        ip;
+static NX_INTERFACE interface;
+static test_pool_t  rx_pool;
+static test_pool_t  tx_pool;
+static UINT         ip_thread_wakeups;
+static NX_PACKET   *delivered[TEST_POOL_PACKETS * 4];
+static UINT         delivered_count;
+static bool         hold_delivered;
+static NX_PACKET   *drained[TEST_POOL_PACKETS];
+static UINT         drained_count;
+static UINT         storm_frames; /* Frames the DMA receives while the IP thread is passing earlier ones up */
+
+static TX_TIMER *timer_ptr;
+static VOID (*timer_function)(ULONG);
+static ULONG timer_input;
+static ULONG timer_period;
+static bool  timer_active;
+static ULONG timer_remaining;
+
+/* Cache maintenance the driver asked for */
+static uintptr_t cache_clean_start[TEST_MAX_CLEANS];
+static int32_t   cache_clean_size[TEST_MAX_CLEANS];
+static UINT      cache_clean_count;
+static UINT      cache_clean_bytes;
+static UINT      cache_clean_lines;
+
+static uint32_t tick;
+static UINT     test_failures;
+
+const uint8_t bpdu_dest_address[BPDU_DST_ADDR_SIZE]      = {0x01, 0x80, 0xC2, 0x00, 0x00, 0x00};
+const uint8_t bpdu_dest_address_mask[BPDU_DST_ADDR_SIZE] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0};
+
+
+/* HAL and board */
+
+uint32_t HAL_GetTick(void) {
+    /* The fake finishes a software reset as soon as time moves on */
+    CLEAR_BIT(fake_eth.DMAMR, ETH_DMAMR_SWR);
+    return tick++;
+}
+
+uint32_t HAL_RCC_GetHCLKFreq(void) {
+    return 250000000;
+}
+
+void HAL_SBS_ETHInterfaceSelect(uint32_t SBS_ETHInterface) {
+    (void) SBS_ETHInterface;
+}
+
+void Error_Handler(void) {
+    printf("Error_Handler() called\n");
+    exit(1);
+}
+
+bool compare_mac_addrs_with_mask(const uint8_t *addr1, const uint8_t *addr2, const uint8_t *mask) {
+    for (UINT i = 0; i < 6; i++) {
+        if ((addr1[i] & mask[i]) != (addr2[i] & mask[i])) return false;
+    }
+    return true;
+}
+
+int32_t nx_eth_phy_init(void) {
+    return ETH_PHY_STATUS_OK;
+}
+
+int32_t nx_eth_phy_get_link_state(void) {
+    return ETH_PHY_STATUS_100MBITS_FULLDUPLEX;
+}
+
+
+/* Packet pools */
+
+static void test_pool_init(test_pool_t *test_pool) {
+    memset(test_pool, 0, sizeof(test_pool_t));
+    test_pool->pool.nx_packet_pool_start = (CHAR *) test_pool->memory;
+    for (UINT i = 0; i < TEST_POOL_PACKETS; i++) {
+        test_pool->packets[i] = (NX_PACKET *) test_pool->memory[i];
+    }
+}
+
+static test_pool_t *test_pool_of(NX_PACKET *packet_ptr, UINT *index) {
+    test_pool_t *pools[] = {&rx_pool, &tx_pool};
+
+    for (UINT i = 0; i < 2; i++) {
+        uint8_t *start = pools[i]->memory[0];
+        if (((uint8_t *) packet_ptr >= start) && ((uint8_t *) packet_ptr < start + sizeof(pools[i]->memory))) {
+            *index = (UINT) (((uint8_t *) packet_ptr - start) / TEST_PACKET_SIZE);
+            return pools[i];
+        }
+    }
+    printf("Released a packet that isn't from a pool\n");
+    exit(1);
+}
+
+static UINT test_pool_in_use(test_pool_t *test_pool) {
+    return test_pool->count;
+}
+
+UINT _nxe_packet_allocate(NX_PACKET_POOL *pool_ptr, NX_PACKET **packet_ptr, ULONG packet_type, ULONG wait_option) {
+    test_pool_t *test_pool = (test_pool_t *) pool_ptr;
+    NX_PACKET   *packet;
+    UINT         header_size;
+
+    (void) wait_option;
+
+    for (UINT i = 0; i < TEST_POOL_PACKETS; i++) {
+        if (test_pool->in_use[i]) continue;
+
+        /* Same layout as a NetX pool, the payload follows the aligned header */
+        header_size = (sizeof(NX_PACKET) + NX_PACKET_ALIGNMENT - 1) / NX_PACKET_ALIGNMENT * NX_PACKET_ALIGNMENT;
+        packet      = test_pool->packets[i];
+        memset(packet, 0, sizeof(NX_PACKET));
+        packet->nx_packet_pool_owner  = pool_ptr;
+        packet->nx_packet_data_start  = test_pool->memory[i] + header_size;
+        packet->nx_packet_data_end    = test_pool->memory[i] + TEST_PACKET_SIZE;
+        packet->nx_packet_prepend_ptr = packet->nx_packet_data_start + packet_type;
+        packet->nx_packet_append_ptr  = packet->nx_packet_prepend_ptr;
+
+        test_pool->in_use[i] = true;
+        test_pool->count++;
+        *packet_ptr = packet;
+        return NX_SUCCESS;
+    }
+
+    return NX_NO_PACKET;
+}
+
+UINT _nxe_packet_release(NX_PACKET **packet_ptr_ptr) {
+    NX_PACKET   *packet_ptr = *packet_ptr_ptr;
+    NX_PACKET   *next_ptr;
+    test_pool_t *test_pool;
+    UINT         index;
+
+    while (packet_ptr != NX_NULL) {
+        next_ptr  = packet_ptr->nx_packet_next;
+        test_pool = test_pool_of(packet_ptr, &index);
+        if (!test_pool->in_use[index]) {
+            test_pool->double_frees++;
+        } else {
+            test_pool->in_use[index] = false;
+            test_pool->count--;
+        }
+        packet_ptr = next_ptr;
+    }
+
+    *packet_ptr_ptr = NX_NULL;
+    return NX_SUCCESS;
+}
+
+UINT _nxe_packet_transmit_release(NX_PACKET **packet_ptr_ptr) {
+    return _nxe_packet_release(packet_ptr_ptr);
+}
+
+
+/* NetX link layer, frames passed up are released straight away unless the test is holding them to starve the pool */
+
+static bool dma_receive(void);
+
+VOID nx_link_ethernet_packet_received(NX_IP *ip_ptr, UINT interface_index, NX_PACKET *packet_ptr, NX_LINK_TIME *time_ptr) {
+    (void) ip_ptr;
+    (void) interface_index;
+    (void) time_ptr;
+
+    if (hold_delivered) {
+        delivered[delivered_count] = packet_ptr;
+    } else {
+        nx_packet_release(packet_ptr);
+    }
+    delivered_count++;
+
+    if (storm_frames > 0) {
+        storm_frames--;
+        dma_receive();
+    }
+}
+
+UINT nx_link_ethernet_header_parse(NX_PACKET *packet_ptr, ULONG *destination_msb, ULONG *destination_lsb,
+                                   ULONG *source_msb, ULONG *source_lsb, USHORT *ether_type, USHORT *vlan_tag,
+                                   UCHAR *vlan_tag_valid, UINT *header_size) {
+    (void) packet_ptr;
+    (void) destination_msb;
+    (void) destination_lsb;
+    (void) source_msb;
+    (void) source_lsb;
+    (void) ether_type;
+    (void) vlan_tag;
+    (void) vlan_tag_valid;
+
+    *header_size = NX_LINK_ETHERNET_HEADER_SIZE;
+    return NX_SUCCESS;
+}
+
+UINT nx_link_driver_request_preprocess(NX_IP_DRIVER *driver_request, NX_INTERFACE **actual_interface) {
+    *actual_interface = driver_request->nx_ip_driver_interface;
+    return NX_SUCCESS;
+}
+
+UINT nx_stp_packet_deferred_receive(NX_IP *ip_ptr, NX_PACKET *packet_ptr) {
+    (void) ip_ptr;
+    nx_packet_release(packet_ptr);
+    return NX_SUCCESS;
+}
+
+VOID _nx_ip_driver_deferred_processing(NX_IP *ip_ptr) {
+    (void) ip_ptr;
+    ip_thread_wakeups++;
+}
+
+
+/* ThreadX timer, only advanced when the test says so */
+
+UINT _txe_timer_create(TX_TIMER *timer, CHAR *name_ptr, VOID (*expiration_function)(ULONG input), ULONG expiration_input,
+                       ULONG initial_ticks, ULONG reschedule_ticks, UINT auto_activate, UINT timer_control_block_size) {
+    (void) name_ptr;
+    (void) initial_ticks;
+    (void) timer_control_block_size;
+
+    timer_ptr       = timer;
+    timer_function  = expiration_function;
+    timer_input     = expiration_input;
+    timer_period    = reschedule_ticks;
+    timer_active    = (auto_activate == TX_AUTO_ACTIVATE);
+    timer_remaining = timer_period;
+    return TX_SUCCESS;
+}
+
+UINT _txe_timer_activate(TX_TIMER *timer) {
+    if (timer != timer_ptr) return TX_TIMER_ERROR;
+    if (timer_active) return TX_ACTIVATE_ERROR;
+    timer_active    = true;
+    timer_remaining = timer_period;
+    return TX_SUCCESS;
+}
+
+UINT _txe_timer_deactivate(TX_TIMER *timer) {
+    if (timer != timer_ptr) return TX_TIMER_ERROR;
+    timer_active = false;
+    return TX_SUCCESS;
+}
+
+static void timer_advance(ULONG ticks) {
+    while (ticks-- > 0) {
+        if (!timer_active) return;
+        if (--timer_remaining == 0) {
+            timer_remaining = timer_period;
+            timer_function(timer_input);
+        }
+    }
+}
+
+
+/* Cache maintenance, recorded rather than performed. Lines are what costs on a cached core, one operation each */
+
+static UINT cache_lines(uintptr_t start, int32_t size) {
+    uintptr_t first = start & ~(uintptr_t) (TEST_CACHE_LINE - 1);
+    uintptr_t end   = (start + (uintptr_t) size + TEST_CACHE_LINE - 1) & ~(uintptr_t) (TEST_CACHE_LINE - 1);
+    return (UINT) ((end - first) / TEST_CACHE_LINE);
+}
+
+void test_dcache_invalidate(volatile void *addr, int32_t dsize) {
+    (void) addr;
+    (void) dsize;
+}
+
+void test_dcache_clean(volatile void *addr, int32_t dsize) {
+    if (cache_clean_count < TEST_MAX_CLEANS) {
+        cache_clean_start[cache_clean_count] = (uintptr_t) addr;
+        cache_clean_size[cache_clean_count]  = dsize;
+    }
+    cache_clean_count++;
+    cache_clean_bytes += (UINT) dsize;
+    cache_clean_lines += cache_lines((uintptr_t) addr, dsize);
+}
+
+static void cache_reset(void) {
+    cache_clean_count = 0;
+    cache_clean_bytes = 0;
+    cache_clean_lines = 0;
+}
+
+
+/* DMA model */
+
+static void dma_poll(void) {
+
+    /* A new list address means the ring was set up again, start from the first descriptor */
+    if (fake_eth.DMACRDLAR != 0) {
+        dma_rx_index       = (UINT) ((ETH_DMADescTypeDef *) (uintptr_t) fake_eth.DMACRDLAR - rx_descriptors);
+        fake_eth.DMACRDLAR = 0;
+        dma_rx_suspended   = false;
+        dma_stopped        = false;
+    }
+    if (fake_eth.DMACTDLAR != 0) {
+        dma_tx_index       = (UINT) ((ETH_DMADescTypeDef *) (uintptr_t) fake_eth.DMACTDLAR - tx_descriptors);
+        fake_eth.DMACTDLAR = 0;
+    }
+
+    /* Writing the tail pointer makes a suspended receive DMA look at the ring again */
+    if (dma_rx_suspended && (fake_eth.DMACRDTPR != 0)) {
+        dma_rx_suspended = false;
+    }
+}
+
+/* Deliver every pending status bit that is enabled, the same way the NVIC would once the IRQ is unmasked */
+static void dma_interrupt(void) {
+    uint32_t enabled = fake_eth.DMACIER;
+    uint32_t handled = 0;
+
+    if ((dma_status & ETH_DMACSR_RI) && (enabled & ETH_DMACIER_RIE)) handled |= ETH_DMACSR_RI;
+    if ((dma_status & ETH_DMACSR_TI) && (enabled & ETH_DMACIER_TIE)) handled |= ETH_DMACSR_TI;
+    if ((dma_status & ETH_DMACSR_AIS) && (enabled & ETH_DMACIER_AIE)) {
+        handled |= ETH_DMACSR_AIS | ETH_DMACSR_RBU | ETH_DMACSR_FBE | ETH_DMACSR_RWT | ETH_DMACSR_ETI | ETH_DMACSR_CDE;
+    }
+    if (handled == 0) return;
+
+    fake_eth.DMACSR = dma_status;
+    HAL_ETH_IRQHandler(&heth);
+    fake_eth.DMACSR = 0;
+    dma_status     &= ~handled;
+}
+
+/* Receive one frame into the next descriptor, or drop it and suspend if the software hasn't given one back */
+static bool dma_receive(void) {
+    ETH_DMADescTypeDef *desc;
+
+    dma_poll();
+    if (dma_stopped || dma_rx_suspended) {
+        dma_frames_dropped++;
+        return false;
+    }
+
+    desc = &rx_descriptors[dma_rx_index];
+    if (!(desc->DESC3 & ETH_DMARXNDESCRF_OWN)) {
+        dma_rx_suspended   = true;
+        fake_eth.DMACRDTPR = 0;
+        dma_status        |= ETH_DMACSR_RBU | ETH_DMACSR_AIS;
+        dma_frames_dropped++;
+        dma_interrupt();
+        return false;
+    }
+
+    memset((uint8_t *) (uintptr_t) desc->DESC0, 0xA5, TEST_FRAME_LENGTH);
+    desc->DESC1  = 0;
+    desc->DESC3  = ETH_DMARXNDESCWBF_FD | ETH_DMARXNDESCWBF_LD | TEST_FRAME_LENGTH;
+    dma_rx_index = (dma_rx_index + 1) % ETH_RX_DESC_CNT;
+    dma_frames_received++;
+
+    dma_status |= ETH_DMACSR_RI;
+    dma_interrupt();
+    return true;
+}
+
+/* Send every frame the software has queued */
+static void dma_transmit(void) {
+    ETH_DMADescTypeDef *desc;
+    bool                sent = false;
+
+    dma_poll();
+    if (dma_stopped) return;
+
+    desc = &tx_descriptors[dma_tx_index];
+    while (desc->DESC3 & ETH_DMATXNDESCRF_OWN) {
+        if (desc->DESC3 & ETH_DMATXNDESCRF_LD) dma_frames_sent++;
+        desc->DESC3 &= ~(ETH_DMATXNDESCRF_OWN | ETH_DMATXNDESCWBF_TTSS);
+        dma_tx_index = (dma_tx_index + 1) % ETH_TX_DESC_CNT;
+        desc         = &tx_descriptors[dma_tx_index];
+        sent         = true;
+    }
+
+    if (sent) {
+        dma_status |= ETH_DMACSR_TI;
+        dma_interrupt();
+    }
+}
+
+static void dma_fatal_bus_error(void) {
+    dma_stopped = true;
+    dma_status |= ETH_DMACSR_FBE | ETH_DMACSR_AIS;
+    dma_interrupt();
+}
+
+
+/* Driver */
+
+static UINT driver_request(UINT command, NX_PACKET *packet_ptr) {
+    NX_IP_DRIVER request = {0};
+
+    request.nx_ip_driver_command   = command;
+    request.nx_ip_driver_ptr       = &ip;
+    request.nx_ip_driver_interface = &interface;
+    request.nx_ip_driver_packet    = packet_ptr;
+    nx_stm32_eth_driver(&request);
+    return request.nx_ip_driver_status;
+}
+
+/* Stand-in for the IP thread, run the deferred processing once. Any interrupts it unmasked are left pending */
+static void ip_thread_step(void) {
+    ip_thread_wakeups = 0;
+    driver_request(NX_LINK_DEFERRED_PROCESSING, NX_NULL);
+    dma_poll();
+}
+
+/* And for as long as the driver keeps asking for it */
+static void ip_thread_run(void) {
+    while (ip_thread_wakeups > 0) {
+        ip_thread_step();
+        dma_interrupt();
+    }
+}
+
+/* No receive descriptor is left waiting for a buffer */
+static bool rx_ring_built(void) {
+    for (UINT i = 0; i < ETH_RX_DESC_CNT; i++) {
+        if (rx_descriptors[i].BackupAddr0 == 0) return false;
+    }
+    return heth.RxDescList.RxBuildDescCnt == 0;
+}
+
+/* Send a frame split over a chain of packets, the way NetX hands over a payload too big for one packet */
+static void driver_send_chain(NX_PACKET **packets, const UINT *lengths, UINT count) {
+    ULONG total = 0;
+
+    for (UINT i = 0; i < count; i++) {
+        if (nx_packet_allocate(&tx_pool.pool, &packets[i], NX_RECEIVE_PACKET, NX_NO_WAIT) != NX_SUCCESS) {
+            printf("TX pool empty\n");
+            exit(1);
+        }
+        memset(packets[i]->nx_packet_prepend_ptr, 0x5A, lengths[i]);
+        packets[i]->nx_packet_append_ptr = packets[i]->nx_packet_prepend_ptr + lengths[i];
+        if (i > 0) packets[i - 1]->nx_packet_next = packets[i];
+        total += lengths[i];
+    }
+    packets[0]->nx_packet_length = total;
+    driver_request(NX_LINK_RAW_PACKET_SEND, packets[0]);
+}
+
+static void driver_send(void) {
+    NX_PACKET *packet_ptr;
+    UINT       length = TEST_FRAME_LENGTH;
+
+    driver_send_chain(&packet_ptr, &length, 1);
+}
+
+static NX_DRIVER_ERROR_COUNTERS driver_counters(void) {
+    NX_DRIVER_ERROR_COUNTERS counters;
+
+    nx_stm32_eth_driver_error_counters_get(&counters);
+    return counters;
+}
+
+static void release_delivered(void) {
+    for (UINT i = 0; i < delivered_count; i++) {
+        if (delivered[i] != NX_NULL) nx_packet_release(delivered[i]);
+    }
+    memset(delivered, 0, sizeof(delivered));
+    delivered_count = 0;
+}
+
+/* Take every free packet, like the rest of the application sitting on its buffers */
+static void rx_pool_drain(void) {
+    while (nx_packet_allocate(&rx_pool.pool, &drained[drained_count], NX_RECEIVE_PACKET, NX_NO_WAIT) == NX_SUCCESS) {
+        drained_count++;
+    }
+}
+
+static void rx_pool_undrain(void) {
+    while (drained_count > 0) {
+        nx_packet_release(drained[--drained_count]);
+    }
+}
+
+/* Bring the HAL and driver up the way the application does, with the link already up */
+static void setup(void) {
+    test_pool_init(&rx_pool);
+    test_pool_init(&tx_pool);
+
+    static uint8_t mac_address[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+    memset(&heth, 0, sizeof(heth));
+    heth.Instance            = &fake_eth;
+    heth.Init.MACAddr        = mac_address;
+    heth.Init.MediaInterface = HAL_ETH_RMII_MODE;
+    heth.Init.TxDesc         = tx_descriptors;
+    heth.Init.RxDesc         = rx_descriptors;
+    heth.Init.RxBuffLen      = 1536;
+    if (HAL_ETH_Init(&heth) != HAL_OK) {
+        printf("HAL_ETH_Init() failed\n");
+        exit(1);
+    }
+
+    ip.nx_ip_default_packet_pool = &rx_pool.pool;
+    driver_request(NX_LINK_INTERFACE_ATTACH, NX_NULL);
+    if (driver_request(NX_LINK_INITIALIZE, NX_NULL) != NX_SUCCESS) {
+        printf("Driver initialize failed\n");
+        exit(1);
+    }
+    if (driver_request(NX_LINK_ENABLE, NX_NULL) != NX_SUCCESS) {
+        printf("Driver enable failed\n");
+        exit(1);
+    }
+    dma_poll();
+}
+
+
+/* Tests */
+
+static void test_receive(void) {
+    setup();
+
+    for (UINT i = 0; i < 3; i++) CHECK(dma_receive());
+    ip_thread_run();
+
+    CHECK(delivered_count == 3);
+    CHECK(rx_pool.double_frees == 0);
+    CHECK(fake_eth.DMACIER & ETH_DMACIER_RIE);
+}
+
+/* A storm keeps the DMA busy while the IP thread is passing frames up. Each deferred call stops at the budget and
+ * re-arms itself with the receive interrupt still masked, the interrupt only comes back once the backlog has drained.
+ * The ring is rebuilt in full after every call, the refill never leaves a descriptor without a buffer */
+static void test_receive_budget(void) {
+    NX_DRIVER_ERROR_COUNTERS counters;
+    UINT                     total = ETH_RX_DESC_CNT + (3 * NX_DRIVER_RX_BUDGET);
+    UINT                     calls = 0;
+    UINT                     before;
+
+    setup();
+
+    for (UINT i = 0; i < ETH_RX_DESC_CNT; i++) CHECK(dma_receive());
+    CHECK(!(fake_eth.DMACIER & ETH_DMACIER_RIE));
+
+    storm_frames = total - ETH_RX_DESC_CNT;
+    while (ip_thread_wakeups > 0) {
+        before = delivered_count;
+        ip_thread_step();
+        calls++;
+
+        CHECK(delivered_count - before <= NX_DRIVER_RX_BUDGET);
+        CHECK(rx_ring_built());
+        if (fake_eth.DMACIER & ETH_DMACIER_RIE) {
+            CHECK(delivered_count == total);
+        } else {
+            CHECK(delivered_count - before == NX_DRIVER_RX_BUDGET);
+            CHECK(ip_thread_wakeups == 1);
+        }
+        dma_interrupt();
+    }
+
+    /* One call per budget and one to find the end. The receive interrupt that latched during the storm may cost one more
+     * call that finds nothing once it is unmasked */
+    CHECK(storm_frames == 0);
+    CHECK(delivered_count == total);
+    CHECK((calls >= (total / NX_DRIVER_RX_BUDGET) + 1) && (calls <= (total / NX_DRIVER_RX_BUDGET) + 2));
+    CHECK(fake_eth.DMACIER & ETH_DMACIER_RIE);
+    CHECK(dma_frames_dropped == 0);
+
+    /* Once idle the stash is empty, only the ring and the reserve hold packets */
+    CHECK(test_pool_in_use(&rx_pool) == ETH_RX_DESC_CNT + NX_DRIVER_RX_RESERVE);
+
+    /* Back to interrupt driven reception */
+    CHECK(dma_receive());
+    CHECK(ip_thread_wakeups == 1);
+    ip_thread_run();
+    CHECK(delivered_count == total + 1);
+
+    counters = driver_counters();
+    CHECK(counters.nx_driver_error_rx_buffer_unavailable == 0);
+    CHECK(rx_pool.double_frees == 0);
+}
+
+/* A backlog that is exactly a multiple of the budget. The last full call can't tell the backlog has gone so it re-arms,
+ * and the next one finds nothing and unmasks the interrupt */
+static void test_receive_budget_exact(void) {
+    UINT total = 2 * NX_DRIVER_RX_BUDGET;
+    UINT calls = 0;
+
+    setup();
+
+    for (UINT i = 0; i < ETH_RX_DESC_CNT; i++) CHECK(dma_receive());
+    storm_frames = total - ETH_RX_DESC_CNT;
+    while (ip_thread_wakeups > 0) {
+        ip_thread_step();
+        calls++;
+        CHECK(rx_ring_built());
+        if (fake_eth.DMACIER & ETH_DMACIER_RIE) CHECK(delivered_count == total);
+        dma_interrupt();
+    }
+
+    CHECK(delivered_count == total);
+    CHECK((calls >= 3) && (calls <= 4));
+    CHECK(fake_eth.DMACIER & ETH_DMACIER_RIE);
+    CHECK(dma_frames_dropped == 0);
+    CHECK(test_pool_in_use(&rx_pool) == ETH_RX_DESC_CNT + NX_DRIVER_RX_RESERVE);
+}
+
+/* The pool runs dry while the DMA outruns the IP thread. The reserve restarts reception the first time, and once that is
+ * used up the retry timer keeps trying until the application frees packets, with nothing else to wake the IP thread */
+static void test_receive_buffer_unavailable(void) {
+    NX_DRIVER_ERROR_COUNTERS counters;
+
+    setup();
+
+    /* One frame so the driver fills its reserve */
+    CHECK(dma_receive());
+    ip_thread_run();
+
+    /* Fill the ring before the IP thread gets to run, the next frame finds no descriptor */
+    hold_delivered = true;
+    rx_pool_drain();
+    while (dma_receive()) {
+    }
+    CHECK(dma_rx_suspended);
+
+    /* The application is holding every packet, so only the reserve can restart reception */
+    ip_thread_run();
+    CHECK(!dma_rx_suspended);
+
+    /* Starve it again, this time there is nothing left to rebuild the ring with */
+    while (dma_receive()) {
+    }
+    CHECK(dma_rx_suspended);
+    ip_thread_run();
+    CHECK(dma_rx_suspended);
+    CHECK(timer_active);
+
+    /* Nothing is received and nothing is sent, only the timer can bring reception back */
+    release_delivered();
+    rx_pool_undrain();
+    CHECK(ip_thread_wakeups == 0);
+    timer_advance(TEST_TIMER_TICKS);
+    ip_thread_run();
+    CHECK(!dma_rx_suspended);
+    CHECK(!timer_active);
+
+    hold_delivered = false;
+    CHECK(dma_receive());
+    ip_thread_run();
+    CHECK(delivered_count == 1);
+    CHECK(test_pool_in_use(&rx_pool) == ETH_RX_DESC_CNT + NX_DRIVER_RX_RESERVE);
+
+    counters = driver_counters();
+    CHECK(counters.nx_driver_error_rx_buffer_unavailable == 2);
+    CHECK(counters.nx_driver_error_recoveries == 2);
+    CHECK(counters.nx_driver_error_recovery_failures > 0);
+    CHECK(rx_pool.double_frees == 0);
+}
+
+/* A fatal bus error with frames queued for transmit and half a frame received. The restart has to give back every
+ * packet the rings hold and start both rings from their first descriptor, like the DMA does */
+static void test_fatal_bus_error(void) {
+    NX_DRIVER_ERROR_COUNTERS counters;
+    ETH_DMADescTypeDef      *desc;
+
+    setup();
+
+    /* Two frames the DMA never gets to send */
+    driver_send();
+    driver_send();
+    CHECK(test_pool_in_use(&tx_pool) == 2);
+
+    /* The first half of a frame */
+    desc         = &rx_descriptors[dma_rx_index];
+    desc->DESC3  = ETH_DMARXNDESCWBF_FD | 1000;
+    dma_rx_index = (dma_rx_index + 1) % ETH_RX_DESC_CNT;
+    dma_status  |= ETH_DMACSR_RI;
+    dma_interrupt();
+    ip_thread_run();
+    CHECK(heth.RxDescList.pRxStart != NULL);
+
+    dma_fatal_bus_error();
+    CHECK(heth.gState == HAL_ETH_STATE_ERROR);
+    ip_thread_run();
+
+    CHECK(heth.gState == HAL_ETH_STATE_STARTED);
+    CHECK(test_pool_in_use(&tx_pool) == 0);
+    CHECK(test_pool_in_use(&rx_pool) == ETH_RX_DESC_CNT + NX_DRIVER_RX_RESERVE);
+    CHECK(heth.TxDescList.CurTxDesc == 0);
+    CHECK(heth.TxDescList.BuffersInUse == 0);
+    CHECK(dma_tx_index == 0);
+    CHECK(dma_rx_index == 0);
+
+    /* Both directions work again */
+    driver_send();
+    dma_transmit();
+    ip_thread_run();
+    CHECK(dma_frames_sent == 1);
+    CHECK(test_pool_in_use(&tx_pool) == 0);
+
+    CHECK(dma_receive());
+    ip_thread_run();
+    CHECK(delivered_count == 1);
+
+    counters = driver_counters();
+    CHECK(counters.nx_driver_error_fatal_bus == 1);
+    CHECK(counters.nx_driver_error_recoveries == 1);
+    CHECK(rx_pool.double_frees == 0);
+    CHECK(tx_pool.double_frees == 0);
+}
+
+/* A MAC status error leaves the DMA running but the HAL refuses to read or send until the handle is restarted */
+static void test_mac_error(void) {
+    NX_DRIVER_ERROR_COUNTERS counters;
+
+    setup();
+
+    fake_eth.MACISR     = ETH_MACIER_RXSTSIE;
+    fake_eth.MACRXTXSR  = ETH_MACRXTXSR_RWT;
+    HAL_ETH_IRQHandler(&heth);
+    fake_eth.MACISR     = 0;
+    CHECK(heth.gState == HAL_ETH_STATE_ERROR);
+    ip_thread_run();
+    CHECK(heth.gState == HAL_ETH_STATE_STARTED);
+
+    CHECK(dma_receive());
+    ip_thread_run();
+    CHECK(delivered_count == 1);
+
+    counters = driver_counters();
+    CHECK(counters.nx_driver_error_mac == 1);
+    CHECK(counters.nx_driver_error_recoveries == 1);
+}
+
+/* A small frame only cleans the bytes the DMA reads, not the whole packet buffer */
+static void test_transmit_clean(void) {
+    NX_PACKET      *packet_ptr;
+    UINT            length = TEST_FRAME_LENGTH;
+    struct timespec start;
+    struct timespec end;
+    double          ns;
+
+    setup();
+    cache_reset();
+
+    driver_send_chain(&packet_ptr, &length, 1);
+    CHECK(cache_clean_count == 1);
+    CHECK(cache_clean_start[0] == (uintptr_t) packet_ptr->nx_packet_prepend_ptr);
+    CHECK(cache_clean_size[0] == TEST_FRAME_LENGTH);
+    CHECK(cache_clean_lines == cache_lines((uintptr_t) packet_ptr->nx_packet_prepend_ptr, TEST_FRAME_LENGTH));
+    CHECK(cache_clean_lines <= (TEST_FRAME_LENGTH / TEST_CACHE_LINE) + 2);
+    dma_transmit();
+    ip_thread_run();
+    CHECK(dma_frames_sent == 1);
+    CHECK(test_pool_in_use(&tx_pool) == 0);
+
+    /* Host time for the whole send and completion path, only printed since it says little about the target */
+    cache_reset();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (UINT i = 0; i < TEST_TIMED_SENDS; i++) {
+        driver_send();
+        dma_transmit();
+        ip_thread_run();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ns = ((double) (end.tv_sec - start.tv_sec) * 1e9) + (double) (end.tv_nsec - start.tv_nsec);
+
+    CHECK(dma_frames_sent == 1 + TEST_TIMED_SENDS);
+    CHECK(cache_clean_bytes == TEST_TIMED_SENDS * TEST_FRAME_LENGTH);
+    CHECK(test_pool_in_use(&tx_pool) == 0);
+    printf("    %u bytes in %.1f lines cleaned per frame, %.0f ns per frame on the host\n", cache_clean_bytes / TEST_TIMED_SENDS, (double) cache_clean_lines / TEST_TIMED_SENDS, ns / TEST_TIMED_SENDS);
+}
+
+/* Check a chain was cleaned span by span and laid out two buffers to a descriptor from the given descriptor on */
+static void check_chain(NX_PACKET **packets, const UINT *lengths, UINT count, UINT first_desc) {
+    ETH_DMADescTypeDef *desc;
+    UINT                total = 0;
+    UINT                lines = 0;
+
+    CHECK(cache_clean_count == count);
+    for (UINT i = 0; i < count; i++) {
+        CHECK(cache_clean_start[i] == (uintptr_t) packets[i]->nx_packet_prepend_ptr);
+        CHECK(cache_clean_size[i] == (int32_t) lengths[i]);
+        total += lengths[i];
+        lines += cache_lines((uintptr_t) packets[i]->nx_packet_prepend_ptr, (int32_t) lengths[i]);
+    }
+    CHECK(cache_clean_bytes == total);
+    CHECK(cache_clean_lines == lines);
+
+    for (UINT i = 0; i < count; i += 2) {
+        desc = &tx_descriptors[(first_desc + (i / 2)) % ETH_TX_DESC_CNT];
+        CHECK(desc->DESC3 & ETH_DMATXNDESCRF_OWN);
+        CHECK(((desc->DESC3 & ETH_DMATXNDESCRF_FD) != 0) == (i == 0));
+        CHECK(((desc->DESC3 & ETH_DMATXNDESCRF_LD) != 0) == (i + 2 >= count));
+        CHECK((desc->DESC3 & ETH_DMATXNDESCRF_FL) == total);
+        CHECK(desc->DESC0 == (uint32_t) (uintptr_t) packets[i]->nx_packet_prepend_ptr);
+        CHECK((desc->DESC2 & ETH_DMATXNDESCRF_B1L) == lengths[i]);
+        if (i + 1 < count) {
+            CHECK(desc->DESC1 == (uint32_t) (uintptr_t) packets[i + 1]->nx_packet_prepend_ptr);
+            CHECK(((desc->DESC2 & ETH_DMATXNDESCRF_B2L) >> 16) == lengths[i + 1]);
+        } else {
+            CHECK(desc->DESC1 == 0);
+        }
+    }
+}
+
+/* A frame in three packets goes out as one frame, each packet cleaned over just its own data */
+static void test_transmit_chain(void) {
+    static const UINT lengths[] = {54, 1000, 300};
+    NX_PACKET        *packets[3];
+
+    setup();
+    cache_reset();
+
+    driver_send_chain(packets, lengths, 3);
+    check_chain(packets, lengths, 3, 0);
+    CHECK(heth.TxDescList.CurTxDesc == 2);
+
+    dma_transmit();
+    ip_thread_run();
+    CHECK(dma_frames_sent == 1);
+    CHECK(test_pool_in_use(&tx_pool) == 0);
+    CHECK(tx_pool.double_frees == 0);
+}
+
+/* A chain that starts on the last descriptor wraps round to the first */
+static void test_transmit_chain_wrap(void) {
+    static const UINT lengths[] = {54, 500, 500, 200};
+    NX_PACKET        *packets[4];
+
+    setup();
+
+    /* Move the ring on to its last descriptor */
+    for (UINT i = 0; i < ETH_TX_DESC_CNT - 1; i++) {
+        driver_send();
+        dma_transmit();
+        ip_thread_run();
+    }
+    CHECK(heth.TxDescList.CurTxDesc == ETH_TX_DESC_CNT - 1);
+
+    cache_reset();
+    driver_send_chain(packets, lengths, 4);
+    check_chain(packets, lengths, 4, ETH_TX_DESC_CNT - 1);
+    CHECK(heth.TxDescList.CurTxDesc == 1);
+
+    dma_transmit();
+    ip_thread_run();
+    CHECK(dma_frames_sent == ETH_TX_DESC_CNT);
+    CHECK(test_pool_in_use(&tx_pool) == 0);
+    CHECK(tx_pool.double_frees == 0);
+}
+
+
+int main(void) {
+    struct {
+        const char *name;
+        void (*function)(void);
+    } tests[] = {
+        {"receive", test_receive},
+        {"receive budget", test_receive_budget},
+        {"receive budget exact", test_receive_budget_exact},
+        {"receive buffer unavailable", test_receive_buffer_unavailable},
+        {"fatal bus error", test_fatal_bus_error},
+        {"mac error", test_mac_error},
+        {"transmit clean", test_transmit_clean},
+        {"transmit chain", test_transmit_chain},
+        {"transmit chain wrap", test_transmit_chain_wrap},
+    };
+
+    UINT failed = 0;
+    int  status;
+
+    for (UINT i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+        fflush(stdout);
+        if (fork() == 0) {
+            tests[i].function();
+            exit((test_failures == 0) ? 0 : 1);
+        }
+        wait(&status);
+
+        bool passed = WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+        printf("%s: %s\n", tests[i].name, passed ? "ok" : "FAILED");
+        if (!passed) failed++;
+    }
+
+    return (failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+/*
+ * core_cm33.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+/* Host stand-in for the CMSIS core header. The device header only needs the register qualifiers, and the barriers the
+ * HAL and driver use are no-ops against the fake peripheral. The M33 has no data cache so the driver's cache maintenance
+ * compiles out on the target, here a cache is claimed so the test can record the ranges the driver would maintain */
+
+#ifndef __CORE_CM33_H_GENERIC
+#define __CORE_CM33_H_GENERIC
+#define __CORE_CM33_H_DEPENDANT
+
+#include <stdint.h>
+
+#define __I  volatile const
+#define __O  volatile
+#define __IO volatile
+#define __IM volatile const
+#define __OM volatile
+#define __IOM volatile
+
+#define __ASM                  __asm
+#define __INLINE               inline
+#define __STATIC_INLINE        static inline
+#define __STATIC_FORCEINLINE   static inline
+#define __NO_RETURN            __attribute__((__noreturn__))
+#define __USED                 __attribute__((used))
+#define __WEAK                 __attribute__((weak))
+#define __PACKED               __attribute__((packed, aligned(1)))
+#define __ALIGNED(x)           __attribute__((aligned(x)))
+#define __RESTRICT             __restrict
+#define __COMPILER_BARRIER()   __asm volatile("" ::: "memory")
+
+#define __DMB()  __sync_synchronize()
+#define __DSB()  __sync_synchronize()
+#define __ISB()  __sync_synchronize()
+#define __NOP()  ((void) 0)
+
+#define __get_PRIMASK()     (0U)
+#define __set_PRIMASK(mask) ((void) (mask))
+#define __disable_irq() ((void) 0)
+#define __enable_irq()  ((void) 0)
+
+#define __CORTEX_M       (33U)
+#define __DCACHE_PRESENT (1U)
+
+void test_dcache_invalidate(volatile void *addr, int32_t dsize);
+void test_dcache_clean(volatile void *addr, int32_t dsize);
+
+#define SCB_InvalidateDCache_by_Addr(addr, size) test_dcache_invalidate((addr), (size))
+#define SCB_CleanDCache_by_Addr(addr, size)      test_dcache_clean((addr), (size))
+
+#endif /* __CORE_CM33_H_GENERIC */
@@ -0,0 +1,23 @@
+/*
+ * nx_stp.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+/* Host stand-in, the driver only recognises STP frames and hands them over */
+
+#ifndef INC_NX_STP_H_
+#define INC_NX_STP_H_
+
+#include "stdint.h"
+#include "nx_api.h"
+
+#define BPDU_DST_ADDR_SIZE (6)
+
+extern const uint8_t bpdu_dest_address[BPDU_DST_ADDR_SIZE];
+extern const uint8_t bpdu_dest_address_mask[BPDU_DST_ADDR_SIZE];
+
+UINT nx_stp_packet_deferred_receive(NX_IP *ip_ptr, NX_PACKET *packet_ptr);
+
+#endif /* INC_NX_STP_H_ */
@@ -0,0 +1,37 @@
+/*
+ * stm32h5xx_hal.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+/* Host stand-in for the HAL top level header. Only the ETH module is built, and its accesses to the clock, SBS and EXTI
+ * peripherals are redirected so the real ETH HAL runs unmodified against the fake peripheral */
+
+#ifndef __STM32H5xx_HAL_H
+#define __STM32H5xx_HAL_H
+
+#define HAL_ETH_MODULE_ENABLED
+#define USE_HAL_ETH_REGISTER_CALLBACKS 0U
+#define assert_param(expr)             ((void) 0U)
+
+#include "stm32h5xx_hal_def.h"
+#include "stm32h5xx_hal_eth.h"
+
+extern SBS_TypeDef  fake_sbs;
+extern EXTI_TypeDef fake_exti;
+#undef SBS
+#undef EXTI
+#define SBS  (&fake_sbs)
+#define EXTI (&fake_exti)
+
+#define __HAL_RCC_SBS_CLK_ENABLE() ((void) 0)
+
+#define SBS_ETH_MII  ((uint32_t) 0x00000000)
+#define SBS_ETH_RMII SBS_PMCR_ETH_SEL_PHY_2
+
+uint32_t HAL_GetTick(void);
+uint32_t HAL_RCC_GetHCLKFreq(void);
+void     HAL_SBS_ETHInterfaceSelect(uint32_t SBS_ETHInterface);
+
+#endif /* __STM32H5xx_HAL_H */
@@ -0,0 +1,15 @@
+/*
+ * stp_callbacks.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+/* Host stand-in, nothing from it is used by the driver */
+
+#ifndef INC_STP_CALLBACKS_H_
+#define INC_STP_CALLBACKS_H_
+
+#include "nx_stp.h"
+
+#endif /* INC_STP_CALLBACKS_H_ */
@@ -0,0 +1,104 @@
+/*
+ * tx_port.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+/* Host stand-in for the Cortex-M33 ThreadX port, just enough for tx_api.h to describe the kernel objects. Nothing here
+ * schedules, the test runs everything on one thread */
+
+#ifndef TX_PORT_H
+#define TX_PORT_H
+
+#ifdef TX_INCLUDE_USER_DEFINE_FILE
+#include "tx_user.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+/* The target is 32 bit, keep ULONG the same size so the driver's descriptor arithmetic matches */
+#define VOID void
+typedef char               CHAR;
+typedef unsigned char      UCHAR;
+typedef int                INT;
+typedef unsigned int       UINT;
+typedef int                LONG;
+typedef unsigned int       ULONG;
+typedef unsigned long long ULONG64;
+typedef short              SHORT;
+typedef unsigned short     USHORT;
+#define ULONG64_DEFINED
+
+#ifndef TX_MAX_PRIORITIES
+#define TX_MAX_PRIORITIES 32
+#endif
+#ifndef TX_MINIMUM_STACK
+#define TX_MINIMUM_STACK 200
+#endif
+#ifndef TX_TIMER_THREAD_STACK_SIZE
+#define TX_TIMER_THREAD_STACK_SIZE 1024
+#endif
+#ifndef TX_TIMER_THREAD_PRIORITY
+#define TX_TIMER_THREAD_PRIORITY 0
+#endif
+
+#define TX_INT_DISABLE 1
+#define TX_INT_ENABLE  0
+
+#define TX_TRACE_TIME_SOURCE 0
+#define TX_TRACE_TIME_MASK   0xFFFFFFFFUL
+
+#define TX_PORT_SPECIFIC_BUILD_OPTIONS (0)
+#define TX_INLINE_INITIALIZATION
+
+#define TX_THREAD_EXTENSION_0
+#define TX_THREAD_EXTENSION_1
+#define TX_THREAD_EXTENSION_2
+#define TX_THREAD_EXTENSION_3
+#define TX_BLOCK_POOL_EXTENSION
+#define TX_BYTE_POOL_EXTENSION
+#define TX_EVENT_FLAGS_GROUP_EXTENSION
+#define TX_MUTEX_EXTENSION
+#define TX_QUEUE_EXTENSION
+#define TX_SEMAPHORE_EXTENSION
+#define TX_TIMER_EXTENSION
+#ifndef TX_THREAD_USER_EXTENSION
+#define TX_THREAD_USER_EXTENSION
+#endif
+
+#define TX_THREAD_CREATE_EXTENSION(thread_ptr)
+#define TX_THREAD_DELETE_EXTENSION(thread_ptr)
+#define TX_THREAD_COMPLETED_EXTENSION(thread_ptr)
+#define TX_THREAD_TERMINATED_EXTENSION(thread_ptr)
+#define TX_THREAD_STARTED_EXTENSION(thread_ptr)
+#define TX_BLOCK_POOL_CREATE_EXTENSION(pool_ptr)
+#define TX_BYTE_POOL_CREATE_EXTENSION(pool_ptr)
+#define TX_EVENT_FLAGS_GROUP_CREATE_EXTENSION(group_ptr)
+#define TX_MUTEX_CREATE_EXTENSION(mutex_ptr)
+#define TX_QUEUE_CREATE_EXTENSION(queue_ptr)
+#define TX_SEMAPHORE_CREATE_EXTENSION(semaphore_ptr)
+#define TX_TIMER_CREATE_EXTENSION(timer_ptr)
+#define TX_BLOCK_POOL_DELETE_EXTENSION(pool_ptr)
+#define TX_BYTE_POOL_DELETE_EXTENSION(pool_ptr)
+#define TX_EVENT_FLAGS_GROUP_DELETE_EXTENSION(group_ptr)
+#define TX_MUTEX_DELETE_EXTENSION(mutex_ptr)
+#define TX_QUEUE_DELETE_EXTENSION(queue_ptr)
+#define TX_SEMAPHORE_DELETE_EXTENSION(semaphore_ptr)
+#define TX_TIMER_DELETE_EXTENSION(timer_ptr)
+
+/* Interrupts are never taken on the host, the test calls the handlers itself */
+#define TX_INTERRUPT_SAVE_AREA UINT interrupt_save = 0;
+#define TX_DISABLE             (void) interrupt_save;
+#define TX_RESTORE             (void) interrupt_save;
+
+#define TX_THREAD_GET_SYSTEM_STATE() (0)
+
+#ifdef TX_THREAD_INIT
+CHAR _tx_version_id[] = "ThreadX host test port";
+#else
+extern CHAR _tx_version_id[];
+#endif
+
+#endif /* TX_PORT_H */
@@ -0,0 +1,223 @@
+/*
+ * ptp_servo_replay.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+/* Replays a servo trace logged by the target with PTP_SERVO_TRACE enabled through the host build of the servo. Each
+ * trace line gives the local sync receive time, the measured offset and path delay, the frequency correction that was
+ * applied while it was measured and whether the clock was stepped afterwards. From these the raw oscillator interval
+ * between syncs is recovered, and a simulated local clock is run closed loop with the servo being tested so gain and
+ * threshold changes can be checked against real timestamps. Lines that don't contain a trace record are skipped, so
+ * whole logs can be replayed.
+ *
+ * The replay fails if the servo being tested has a higher rms offset over the locked samples than the servo that made
+ * the trace, or steps the clock more often than allowed. A limit on the rms offset itself is only applied when one is
+ * given, since it depends on the hardware the trace came from. Usage: ptp_servo_replay <trace> [max steps] [max rms
+ * offset in ns] */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "stdint.h"
+#include "stdbool.h"
+#include "string.h"
+#include "inttypes.h"
+#include "math.h"
+
+#include "ptp_servo.h"
+
+
+#define REPLAY_TRACE_TAG        "PTP servo trace:"
+#define REPLAY_NS_PER_SEC       (1000000000LL)
+#define REPLAY_DEFAULT_MAX_STEP (2)
+#define REPLAY_MAX_RMS_RATIO    (1.1) /* How much worse than the recorded rms offset the replayed one may be */
+
+
+typedef struct {
+    int64_t local_time;
+    int32_t offset;
+    int32_t path_delay;
+    int32_t frequency;
+    bool    stepped;
+} replay_sample_t;
+
+/* The simulated local clock, the fraction is kept separately so rounding doesn't accumulate */
+typedef struct {
+    int64_t time;
+    double  fraction;
+    float   frequency;
+} replay_clock_t;
+
+/* Offset stats of the recorded samples over the same window as the servo's, to compare against */
+typedef struct {
+    double   offset_sq;
+    int32_t  offset_max;
+    double   frequency;
+    uint32_t count;
+} replay_window_t;
+
+/* Offsets of the replayed and recorded servos over every locked sample, the replay is judged on these */
+typedef struct {
+    double   offset_sq;
+    double   recorded_offset_sq;
+    uint32_t count;
+} replay_total_t;
+
+
+static int32_t replay_clamp_offset(int64_t offset) {
+    if (offset > INT32_MAX) return INT32_MAX;
+    if (offset < -INT32_MAX) return -INT32_MAX;
+    return (int32_t) offset;
+}
+
+
+static void replay_clock_advance(replay_clock_t *clock, double raw_interval) {
+    double whole;
+    clock->fraction += raw_interval * (1.0 + ((double) clock->frequency * 1e-9));
+    clock->fraction  = modf(clock->fraction, &whole);
+    clock->time     += (int64_t) whole;
+}
+
+
+/* Returns 1 for a sample, 0 for a reset and -1 for anything else */
+static int replay_parse_line(const char *line, replay_sample_t *sample) {
+
+    const char   *record = strstr(line, REPLAY_TRACE_TAG);
+    unsigned long seconds, nanoseconds;
+    long          offset, path_delay, frequency;
+    unsigned int  stepped;
+
+    /* Bare records without the tag are accepted too */
+    record = (record != NULL) ? record + strlen(REPLAY_TRACE_TAG) : line;
+
+    if (strncmp(record + strspn(record, " \t"), "reset", 5) == 0) return 0;
+    if (sscanf(record, "%lu %lu %ld %ld %ld %u", &seconds, &nanoseconds, &offset, &path_delay, &frequency, &stepped) != 6) return -1;
+
+    sample->local_time = ((int64_t) seconds * REPLAY_NS_PER_SEC) + (int64_t) nanoseconds;
+    sample->offset     = (int32_t) offset;
+    sample->path_delay = (int32_t) path_delay;
+    sample->frequency  = (int32_t) frequency;
+    sample->stepped    = (stepped != 0);
+    return 1;
+}
+
+
+int main(int argc, char **argv) {
+
+    FILE              *file;
+    char               line[256];
+    replay_sample_t    sample;
+    replay_sample_t    last           = {0};
+    replay_clock_t     clock          = {0};
+    replay_window_t    window         = {0};
+    replay_total_t     total          = {0};
+    ptp_servo_t        servo;
+    ptp_servo_state_t  state;
+    ptp_servo_action_t action;
+    bool               anchored       = false;
+    uint32_t           max_steps      = (argc > 2) ? (uint32_t) strtoul(argv[2], NULL, 0) : REPLAY_DEFAULT_MAX_STEP;
+    double             max_rms        = (argc > 3) ? atof(argv[3]) : INFINITY;
+    uint32_t           recorded_steps = 0;
+    uint32_t           resets         = 0;
+    double             recorded_rms   = 0.0;
+    double             total_rms;
+    double             total_recorded_rms;
+    int64_t            local_interval;
+    int32_t            offset;
+    float              frequency;
+    int                result;
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <trace> [max steps] [max rms offset in ns]\n", argv[0]);
+        return 2;
+    }
+    file = fopen(argv[1], "r");
+    if (file == NULL) {
+        perror(argv[1]);
+        return 2;
+    }
+
+    ptp_servo_init(&servo, PTP_SERVO_KP, PTP_SERVO_KI, PTP_SERVO_MAX_FREQUENCY, PTP_SERVO_STEP_THRESHOLD, PTP_SERVO_STATS_WINDOW);
+    printf("kp %.3f, ki %.3f, max frequency %.0f ppb, step threshold %d ns, stats window %d\n", PTP_SERVO_KP, PTP_SERVO_KI, PTP_SERVO_MAX_FREQUENCY, PTP_SERVO_STEP_THRESHOLD, PTP_SERVO_STATS_WINDOW);
+    printf("%8s %10s %10s %10s %10s %12s %12s %8s\n", "samples", "rms", "recorded", "max", "recorded", "frequency", "recorded", "delay");
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+
+        result = replay_parse_line(line, &sample);
+        if (result < 0) continue;
+
+        /* The target clock may have been set, start again from the next recorded time */
+        if (result == 0) {
+            ptp_servo_reset(&servo);
+            anchored = false;
+            resets++;
+            continue;
+        }
+
+        /* Undo the frequency correction and any step the target applied to get the raw oscillator interval, then run
+         * the simulated clock over it at the replayed servo's frequency */
+        if (anchored) {
+            local_interval = sample.local_time - (last.local_time + (last.stepped ? last.offset : 0));
+            replay_clock_advance(&clock, (double) local_interval / (1.0 + ((double) sample.frequency * 1e-9)));
+        } else {
+            clock.time     = sample.local_time;
+            clock.fraction = 0.0;
+            anchored       = true;
+        }
+
+        /* The master time is the same whichever servo is steering the local clock */
+        offset = replay_clamp_offset(sample.local_time + sample.offset - clock.time);
+
+        state  = servo.state;
+        action = ptp_servo_sample(&servo, offset, clock.time, sample.path_delay, &frequency);
+        if (action == PTP_SERVO_ACTION_STEP) clock.time += offset;
+        if (action != PTP_SERVO_ACTION_NONE) clock.frequency = frequency;
+        if (sample.stepped) recorded_steps++;
+
+        /* Only locked samples that weren't stepped go in the servo's window, keep the recorded window in step with it */
+        if ((state == PTP_SERVO_LOCKED) && (action == PTP_SERVO_ACTION_ADJUST)) {
+            window.offset_sq  += (double) sample.offset * (double) sample.offset;
+            window.offset_max  = (abs(sample.offset) > window.offset_max) ? abs(sample.offset) : window.offset_max;
+            window.frequency  += (double) sample.frequency;
+            window.count++;
+            total.offset_sq          += (double) offset * (double) offset;
+            total.recorded_offset_sq += (double) sample.offset * (double) sample.offset;
+            total.count++;
+            if (servo.window_count == 0) {
+                recorded_rms = sqrt(window.offset_sq / (double) window.count);
+                printf("%8" PRIu32 " %10.1f %10.1f %10" PRId32 " %10" PRId32 " %12.1f %12.1f %8" PRId32 "\n", servo.stats.samples, servo.stats.offset_rms, recorded_rms, servo.stats.offset_max, window.offset_max, servo.stats.frequency_mean, window.frequency / (double) window.count, servo.stats.path_delay_mean);
+                window = (replay_window_t) {0};
+            }
+        }
+
+        last = sample;
+    }
+    fclose(file);
+
+    printf("%" PRIu32 " samples, %" PRIu32 " resets, %" PRIu32 " steps (%" PRIu32 " recorded), final rms %.1f ns (%.1f recorded), frequency %.1f ppb\n", servo.stats.samples, resets, servo.stats.steps, recorded_steps, servo.stats.offset_rms, recorded_rms, servo.stats.frequency);
+
+    if (total.count == 0) {
+        printf("FAIL: no locked trace samples found\n");
+        return 1;
+    }
+
+    total_rms          = sqrt(total.offset_sq / (double) total.count);
+    total_recorded_rms = sqrt(total.recorded_offset_sq / (double) total.count);
+    printf("%" PRIu32 " locked samples, rms %.1f ns (%.1f recorded)\n", total.count, total_rms, total_recorded_rms);
+
+    if (total_rms > (total_recorded_rms * REPLAY_MAX_RMS_RATIO)) {
+        printf("FAIL: rms offset more than %.0f%% above the recorded servo's\n", (REPLAY_MAX_RMS_RATIO - 1.0) * 100.0);
+        return 1;
+    }
+    if (servo.stats.steps > max_steps) {
+        printf("FAIL: step limit %" PRIu32 "\n", max_steps);
+        return 1;
+    }
+    if (total_rms > max_rms) {
+        printf("FAIL: rms offset limit %.1f ns\n", max_rms);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,309 @@
+/*
+ * scheduler_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+/* Host test for the periodic job scheduler. Time is virtual: each job advances the clock by the time it takes to run,
+ * and the loop that drives the scheduler sleeps the way the threads do, optionally waking a little late as a sleep on
+ * the target can. Checks the phases keep jobs apart, deadlines don't drift however late the jobs run, the 32-bit ms
+ * clock wrapping changes nothing, and a job that overruns skips the runs it missed instead of running them back to
+ * back.
+ *
+ * Each test runs in its own process so it starts from a fresh scheduler, and is killed if it runs too long. Built and
+ * run with make in this directory */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "stdint.h"
+#include "stdbool.h"
+#include "unistd.h"
+#include "sys/wait.h"
+
+#include "scheduler.h"
+#include "main.h"
+
+
+#define TEST_MAX_JOBS (8)
+#define TEST_MAX_RUNS (1100)
+#define TEST_SEED     (0x2545F491UL)
+#define TEST_TIMEOUT  (10) /* s, a scheduler that never returns fails the test instead of hanging it */
+
+
+#define CHECK(condition)                                                      \
+    do {                                                                      \
+        if (!(condition)) {                                                   \
+            printf("    FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            test_failures++;                                                  \
+        }                                                                     \
+    } while (0)
+
+
+/* A job that records when it ran. The periodic job comes first so the scheduler's job pointer is also the test's */
+typedef struct {
+    periodic_job_t job;
+    uint32_t       cost;     /* ms each run takes */
+    uint32_t       stall_at; /* Run that takes stall ms instead, if stall isn't 0 */
+    uint32_t       stall;
+    uint32_t       runs[TEST_MAX_RUNS];
+    uint32_t       count;
+} test_job_t;
+
+
+static scheduler_t     scheduler;
+static periodic_job_t *scheduler_heap[TEST_MAX_JOBS];
+
+static uint32_t test_now;       /* The virtual clock in ms */
+static uint32_t test_max_delay; /* Longest sleep the scheduler asked for */
+static uint32_t random_state;
+static uint32_t test_failures;
+
+
+void Error_Handler(void) {
+    printf("    Error_Handler() called\n");
+    exit(1);
+}
+
+
+static uint32_t random_next(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+
+static void test_job_function(void *arg) {
+
+    test_job_t *job = (test_job_t *) arg;
+
+    if (job->count < TEST_MAX_RUNS) job->runs[job->count] = test_now;
+    test_now += ((job->stall != 0) && (job->count == job->stall_at)) ? job->stall : job->cost;
+    job->count++;
+}
+
+
+static void setup(uint32_t start) {
+    scheduler_init(&scheduler, scheduler_heap, TEST_MAX_JOBS);
+    test_now       = start;
+    test_max_delay = 0;
+    random_state   = TEST_SEED;
+}
+
+
+static void add_job(test_job_t *job, const char *name, uint32_t period, uint32_t phase, uint32_t cost) {
+    *job = (test_job_t) {
+        .job  = {.name = name, .function = test_job_function, .arg = job, .period = period, .phase = phase},
+        .cost = cost,
+    };
+    scheduler_add(&scheduler, &job->job, test_now);
+}
+
+
+/* Drive the scheduler the way the threads do for duration ms. Each sleep overshoots by up to max_latency ms */
+static void run_for(uint32_t duration, uint32_t max_latency) {
+
+    uint32_t start = test_now;
+    uint32_t delay;
+
+    while ((uint32_t) (test_now - start) < duration) {
+        scheduler_run(&scheduler, test_now);
+        delay = scheduler_delay(&scheduler, test_now);
+        if (delay > test_max_delay) test_max_delay = delay;
+        test_now += delay + ((max_latency > 0) ? (random_next() % (max_latency + 1)) : 0);
+    }
+}
+
+
+/* Runs a job starting phase ms in with a period should have made in duration ms */
+static uint32_t expected_runs(uint32_t duration, uint32_t period, uint32_t phase) {
+    return (duration - phase + period - 1) / period;
+}
+
+
+/* Every run of a job is no more than max_late ms after its deadline, measured from start */
+static bool on_time(const test_job_t *job, uint32_t start, uint32_t max_late) {
+
+    uint32_t late;
+
+    for (uint32_t i = 0; (i < job->count) && (i < TEST_MAX_RUNS); i++) {
+        late = job->runs[i] - (start + job->job.phase + (i * job->job.period));
+        if (late > max_late) {
+            printf("    %s run %u was %ld ms from its deadline\n", job->job.name, i, (long) (int32_t) late);
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/* The switch thread's jobs */
+static void add_switch_jobs(test_job_t jobs[5], uint32_t cost) {
+    add_job(&jobs[0], "Switch tables", 500, 0, cost);
+    add_job(&jobs[1], "Switch tables verify", 10000, 375, cost);
+    add_job(&jobs[2], "Switch status", 500, 125, cost);
+    add_job(&jobs[3], "Switch temperature", 1000, 250, cost);
+    add_job(&jobs[4], "Switch publish stats", 1000, 750, cost);
+}
+
+
+static int compare_times(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *) a;
+    uint32_t y = *(const uint32_t *) b;
+    return (x > y) - (x < y);
+}
+
+
+/* Tests */
+
+/* The phases keep the switch jobs at least a quarter of the maintenance interval apart, and each runs on its deadline
+ * even though the others take time to run */
+static void test_phase_spread(void) {
+    test_job_t jobs[5];
+    uint32_t   start    = 12345;
+    uint32_t   duration = 20000;
+    uint32_t   all[TEST_MAX_RUNS];
+    uint32_t   count    = 0;
+    uint32_t   min_gap  = UINT32_MAX;
+
+    setup(start);
+    add_switch_jobs(jobs, 3);
+    run_for(duration, 0);
+
+    for (uint32_t i = 0; i < 5; i++) {
+        CHECK(jobs[i].count == expected_runs(duration, jobs[i].job.period, jobs[i].job.phase));
+        CHECK(jobs[i].runs[0] == start + jobs[i].job.phase);
+        CHECK(on_time(&jobs[i], start, 0));
+        for (uint32_t j = 0; j < jobs[i].count; j++) all[count++] = jobs[i].runs[j];
+    }
+
+    qsort(all, count, sizeof(all[0]), compare_times);
+    for (uint32_t i = 1; i < count; i++) {
+        if ((all[i] - all[i - 1]) < min_gap) min_gap = all[i] - all[i - 1];
+    }
+    CHECK(min_gap == 125);
+    CHECK(scheduler.overruns == 0);
+}
+
+
+/* Jobs that take a while and sleeps that wake late make each run late, but the next deadline is still counted from the
+ * last one so a thousand periods later the job hasn't slipped */
+static void test_period_drift(void) {
+    test_job_t job;
+    test_job_t other;
+    uint32_t   start    = 1000;
+    uint32_t   duration = 100000;
+
+    setup(start);
+    add_job(&job, "Drift", 100, 0, 7);
+    add_job(&other, "Other", 300, 50, 20);
+    run_for(duration, 20);
+
+    CHECK(job.count == expected_runs(duration, 100, 0));
+    CHECK(other.count == expected_runs(duration, 300, 50));
+    CHECK(on_time(&job, start, 20 + 20)); /* Up to the sleep overshoot, plus the other job if they wake together */
+    CHECK(on_time(&other, start, 20 + 7));
+    CHECK(job.runs[job.count - 1] - job.runs[0] >= (job.count - 1) * 100);
+    CHECK(scheduler.overruns == 0);
+}
+
+
+/* Starting shortly before the ms clock wraps, the runs either side of the wrap are a period apart and no sleep is
+ * anywhere near the 49 days the unsigned difference across the wrap would suggest */
+static void test_wrap(void) {
+    test_job_t jobs[5];
+    uint32_t   start    = UINT32_MAX - 2500;
+    uint32_t   duration = 25000;
+    uint32_t   gap;
+    bool       gaps_ok  = true;
+
+    setup(start);
+    add_switch_jobs(jobs, 1);
+    run_for(duration, 2);
+
+    CHECK((uint32_t) (test_now - start) >= duration);
+    CHECK(test_now < start); /* The clock did wrap */
+    CHECK(test_max_delay <= 500);
+
+    for (uint32_t i = 0; i < 5; i++) {
+        CHECK(jobs[i].count == expected_runs(duration, jobs[i].job.period, jobs[i].job.phase));
+        CHECK(on_time(&jobs[i], start, 2));
+        for (uint32_t j = 1; j < jobs[i].count; j++) {
+            gap = jobs[i].runs[j] - jobs[i].runs[j - 1];
+            if ((gap + 2 < jobs[i].job.period) || (gap > jobs[i].job.period + 2)) gaps_ok = false;
+        }
+    }
+    CHECK(gaps_ok);
+    CHECK(scheduler.overruns == 0);
+}
+
+
+/* A run that takes less than a period only makes the next one late. One that takes several periods makes the next run
+ * late once, the deadlines it covered are skipped and counted as an overrun, and the job carries on in its old phase */
+static void test_overrun(void) {
+    test_job_t job;
+    test_job_t other;
+
+    setup(0);
+    add_job(&job, "Overrun", 100, 0, 1);
+    add_job(&other, "Other", 1000, 250, 1);
+
+    /* Run 2 at 200 takes 120 ms, so the other job and run 3 are late but nothing is skipped */
+    job.stall_at = 2;
+    job.stall    = 120;
+    run_for(1000, 0);
+
+    CHECK(job.runs[2] == 200);
+    CHECK(other.runs[0] == 320);
+    CHECK(job.runs[3] == 321);
+    CHECK(job.runs[4] == 400);
+    CHECK(scheduler.overruns == 0);
+
+    /* Run 15 at 1500 takes 350 ms, covering the deadlines at 1600, 1700 and 1800. The one at 1600 runs late and the
+     * other two are dropped */
+    job.stall_at = 15;
+    job.stall    = 350;
+    run_for(2000, 0);
+
+    CHECK(job.runs[15] == 1500);
+    CHECK(job.runs[16] == 1850);
+    CHECK(job.runs[17] == 1900);
+    CHECK(job.runs[18] == 2000);
+    CHECK(job.runs[19] == 2100);
+    CHECK(scheduler.overruns == 1);
+    CHECK(other.runs[1] == 1250);
+    CHECK(other.runs[2] == 2250);
+}
+
+
+int main(void) {
+    struct {
+        const char *name;
+        void (*function)(void);
+    } tests[] = {
+        {"phase spread", test_phase_spread},
+        {"period drift", test_period_drift},
+        {"wrap", test_wrap},
+        {"overrun", test_overrun},
+    };
+
+    uint32_t failed = 0;
+    int      status;
+
+    for (uint32_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+        fflush(stdout);
+        if (fork() == 0) {
+            alarm(TEST_TIMEOUT);
+            tests[i].function();
+            exit((test_failures == 0) ? 0 : 1);
+        }
+        wait(&status);
+
+        bool passed = WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+        printf("%s: %s\n", tests[i].name, passed ? "ok" : "FAILED");
+        if (!passed) failed++;
+    }
+
+    return (failed == 0) ? 0 : 1;
+}
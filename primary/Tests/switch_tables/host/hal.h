@@ -0,0 +1,72 @@
+/*
+ * hal.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+/* Host stand-in for the HAL, just the SPI, CRC and GPIO calls the switch callbacks make. The SPI calls are implemented by
+ * the test, which logs every transaction */
+
+#ifndef INC_HAL_H_
+#define INC_HAL_H_
+
+#include "stdint.h"
+
+#define __ALIGNED(x) __attribute__((aligned(x)))
+#define CRC_CR_RESET (1UL << 0)
+
+typedef enum {
+    HAL_OK      = 0x00,
+    HAL_ERROR   = 0x01,
+    HAL_BUSY    = 0x02,
+    HAL_TIMEOUT = 0x03
+} HAL_StatusTypeDef;
+
+typedef HAL_StatusTypeDef hal_status_t;
+
+typedef enum {
+    RESET = 0,
+    SET   = !RESET
+} FlagStatus;
+
+typedef enum {
+    GPIO_PIN_RESET = 0,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct {
+    uint32_t ODR;
+} GPIO_TypeDef;
+
+typedef struct {
+    uint32_t CR1;
+} SPI_TypeDef;
+
+typedef struct {
+    SPI_TypeDef *Instance;
+} SPI_HandleTypeDef;
+
+typedef struct {
+    volatile uint32_t CR;
+    volatile uint32_t INIT;
+    volatile uint32_t POL;
+} CRC_TypeDef;
+
+typedef struct {
+    CRC_TypeDef *Instance;
+} CRC_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, const uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef *hspi, const uint8_t *pTxData, uint8_t *pRxData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_SPI_Transmit_IT(SPI_HandleTypeDef *hspi, const uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_Receive_IT(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_IT(SPI_HandleTypeDef *hspi, const uint8_t *pTxData, uint8_t *pRxData, uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi);
+uint32_t          HAL_CRC_Accumulate(CRC_HandleTypeDef *hcrc, uint32_t pBuffer[], uint32_t BufferLength);
+void              HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+uint32_t          HAL_GetTick(void);
+void              HAL_Delay(uint32_t Delay);
+
+#endif /* INC_HAL_H_ */
@@ -0,0 +1,22 @@
+/*
+ * main.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+/* Host stand-in for the CubeMX main header */
+
+#ifndef __MAIN_H
+#define __MAIN_H
+
+#include "hal.h"
+
+extern GPIO_TypeDef fake_gpio;
+
+#define SWCH_CS_Pin       (1U << 0)
+#define SWCH_CS_GPIO_Port (&fake_gpio)
+
+void Error_Handler(void);
+
+#endif /* __MAIN_H */
@@ -0,0 +1,21 @@
+/*
+ * nx_link_thread.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+/* Host stand-in for the NetX link thread header, without NetX. The test records the events the switch thread sends */
+
+#ifndef INC_NX_LINK_THREAD_H_
+#define INC_NX_LINK_THREAD_H_
+
+#include "tx_api.h"
+
+#define NX_LINK_ALL_EVENTS   ((ULONG) 0xffffffff)
+#define NX_LINK_PHY_EVENT    ((ULONG) 1 << 0)
+#define NX_LINK_SWITCH_EVENT ((ULONG) 1 << 1)
+
+extern TX_EVENT_FLAGS_GROUP nx_link_events_handle;
+
+#endif /* INC_NX_LINK_THREAD_H_ */
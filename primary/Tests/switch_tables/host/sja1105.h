@@ -0,0 +1,60 @@
+/*
+ * sja1105.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+/* Host stand-in for the SJA1105 driver library. The test implements the driver calls the switch thread makes by
+ * replaying the SPI transactions they would issue through sja1105_callbacks */
+
+#ifndef SJA1105_H
+#define SJA1105_H
+
+#include "stdint.h"
+#include "stdbool.h"
+
+typedef enum {
+    SJA1105_OK = 0,
+    SJA1105_ERROR,
+    SJA1105_BUSY,
+    SJA1105_TIMEOUT,
+    SJA1105_PARAMETER_ERROR,
+    SJA1105_SPI_ERROR,
+    SJA1105_MUTEX_ERROR,
+    SJA1105_DYNAMIC_MEMORY_ERROR,
+} sja1105_status_t;
+
+typedef enum {
+    SJA1105_PIN_RESET = 0,
+    SJA1105_PIN_SET,
+} sja1105_pinstate_t;
+
+typedef struct {
+    void (*callback_write_cs_pin)(sja1105_pinstate_t state, void *context);
+    sja1105_status_t (*callback_spi_transmit)(const uint32_t *data, uint16_t size, uint32_t timeout, void *context);
+    sja1105_status_t (*callback_spi_receive)(uint32_t *data, uint16_t size, uint32_t timeout, void *context);
+    sja1105_status_t (*callback_spi_transmit_receive)(const uint32_t *tx_data, uint32_t *rx_data, uint16_t size, uint32_t timeout, void *context);
+    uint32_t (*callback_get_time_ms)(void *context);
+    void (*callback_delay_ms)(uint32_t ms, void *context);
+    void (*callback_delay_ns)(uint32_t ns, void *context);
+    sja1105_status_t (*callback_take_mutex)(uint32_t timeout, void *context);
+    sja1105_status_t (*callback_give_mutex)(void *context);
+    sja1105_status_t (*callback_allocate)(uint32_t **memory_ptr, uint32_t size, void *context);
+    sja1105_status_t (*callback_free)(uint32_t *memory_ptr, void *context);
+    sja1105_status_t (*callback_free_all)(void *context);
+    sja1105_status_t (*callback_crc_reset)(void *context);
+    sja1105_status_t (*callback_crc_accumulate)(const uint32_t *buffer, uint32_t size, uint32_t *result, void *context);
+    void (*callback_write_log)(const char *format, ...);
+} sja1105_callbacks_t;
+
+typedef struct {
+    bool initialised;
+} sja1105_handle_t;
+
+sja1105_status_t SJA1105_ReadAllTables(sja1105_handle_t *dev);
+sja1105_status_t SJA1105_CheckStatusRegisters(sja1105_handle_t *dev);
+sja1105_status_t SJA1105_ManagementRouteFree(sja1105_handle_t *dev, bool force);
+sja1105_status_t SJA1105_ReadTemperature(sja1105_handle_t *dev, float *temperature);
+
+#endif /* SJA1105_H */
@@ -0,0 +1,61 @@
+/*
+ * tx_api.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+/* Host stand-in for the ThreadX API. Only the calls the switch code makes are declared, the test implements them on a
+ * single thread with a virtual clock */
+
+#ifndef TX_API_H
+#define TX_API_H
+
+#include "stdint.h"
+
+#define VOID void
+typedef char     CHAR;
+typedef uint8_t  UCHAR;
+typedef uint32_t UINT;
+typedef uint32_t ULONG;
+
+#define TX_NULL                   ((void *) 0)
+#define TX_SUCCESS                ((UINT) 0x00)
+#define TX_NOT_AVAILABLE          ((UINT) 0x1D)
+#define TX_OR                     ((UINT) 0)
+#define TX_NO_WAIT                ((ULONG) 0)
+#define TX_WAIT_FOREVER           ((ULONG) 0xFFFFFFFFUL)
+#define TX_TIMER_TICKS_PER_SECOND (1000)
+
+typedef struct {
+    const char *name;
+} TX_THREAD;
+
+typedef struct {
+    UINT count;
+} TX_SEMAPHORE;
+
+typedef struct {
+    TX_THREAD *owner;
+} TX_MUTEX;
+
+typedef struct {
+    ULONG size;
+} TX_BYTE_POOL;
+
+typedef struct {
+    ULONG flags;
+} TX_EVENT_FLAGS_GROUP;
+
+UINT       tx_byte_pool_create(TX_BYTE_POOL *pool_ptr, CHAR *name_ptr, VOID *pool_start, ULONG pool_size);
+UINT       tx_byte_pool_delete(TX_BYTE_POOL *pool_ptr);
+UINT       tx_byte_allocate(TX_BYTE_POOL *pool_ptr, VOID **memory_ptr, ULONG memory_size, ULONG wait_option);
+UINT       tx_byte_release(VOID *memory_ptr);
+UINT       tx_event_flags_set(TX_EVENT_FLAGS_GROUP *group_ptr, ULONG flags_to_set, UINT set_option);
+UINT       tx_mutex_get(TX_MUTEX *mutex_ptr, ULONG wait_option);
+UINT       tx_mutex_put(TX_MUTEX *mutex_ptr);
+UINT       tx_semaphore_get(TX_SEMAPHORE *semaphore_ptr, ULONG wait_option);
+UINT       tx_semaphore_put(TX_SEMAPHORE *semaphore_ptr);
+TX_THREAD *tx_thread_identify(VOID);
+
+#endif /* TX_API_H */
@@ -0,0 +1,13 @@
+/*
+ * zenoh_generic_platform.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+/* Host stand-in, only config.h includes it */
+
+#ifndef INC_ZENOH_GENERIC_PLATFORM_H_
+#define INC_ZENOH_GENERIC_PLATFORM_H_
+
+#endif /* INC_ZENOH_GENERIC_PLATFORM_H_ */
@@ -0,0 +1,488 @@
+/*
+ * switch_tables_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+/* Host test for the switch table dirty tracking. The real switch thread, scheduler and SPI callbacks are run against a
+ * fake SJA1105 driver, whose calls replay a log of the SPI transactions the real driver issues for them through
+ * sja1105_callbacks. Time is virtual: the thread's sleeps advance the clock and run any transactions other threads are
+ * scripted to make at that time, and the thread is left with a longjmp once the test has run for long enough. The
+ * link events the thread sends to NetX are recorded too.
+ *
+ * Table reads are started by writing the control word of a dynamic reconfiguration register, so the logs for the table
+ * reads and management route housekeeping contain writes to table addresses just like a real reconfiguration does.
+ *
+ * Each test runs in its own process so it starts from a freshly initialised thread. Built and run with make in this
+ * directory */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "stdint.h"
+#include "stdbool.h"
+#include "setjmp.h"
+#include "unistd.h"
+#include "sys/wait.h"
+
+#include "switch_thread.h"
+#include "switch_callbacks.h"
+#include "switch_diagnostics.h"
+#include "nx_link_thread.h"
+#include "config.h"
+#include "main.h"
+
+
+#define TEST_MAX_READS     (32)
+#define TEST_MAX_LINK      (4)
+#define TEST_MAX_EVENTS    (4)
+#define TEST_SPI_CMD_WRITE (1UL << 31)
+
+
+#define CHECK(condition)                                                      \
+    do {                                                                      \
+        if (!(condition)) {                                                   \
+            printf("    FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            test_failures++;                                                  \
+        }                                                                     \
+    } while (0)
+
+
+typedef struct {
+    bool     write;
+    uint32_t address;
+    uint16_t words;
+} spi_transaction_t;
+
+/* Transactions another thread makes at a given time, or something else that happens then */
+typedef struct {
+    uint32_t                 time;
+    const spi_transaction_t *log;
+    uint32_t                 length;
+    void (*action)(void);
+} test_event_t;
+
+
+/* Reading every table back. Each dynamic table is read by writing its control word with RDWRSET clear, polling it until
+ * the switch clears VALID and then reading the entry. The static configuration area is only ever read */
+static const spi_transaction_t read_all_tables_log[] = {
+    {true, 0x29, 1}, {false, 0x29, 1}, {false, 0x24, 5},
+    {true, 0x2d, 1}, {false, 0x2d, 1}, {false, 0x2c, 1},
+    {true, 0x30, 1}, {false, 0x30, 1}, {false, 0x2e, 2},
+    {true, 0x36, 1}, {false, 0x36, 1}, {false, 0x4b, 8},
+    {true, 0x34, 1}, {false, 0x34, 1}, {false, 0x3e, 11},
+    {false, 0x20000, 64},
+};
+
+/* Freeing a management route reads its entry through the L2 lookup reconfiguration registers and clears it */
+static const spi_transaction_t management_route_free_log[] = {
+    {true, 0x29, 1}, {false, 0x29, 1}, {false, 0x24, 5},
+    {true, 0x24, 5}, {true, 0x29, 1}, {false, 0x29, 1},
+};
+
+/* Status, temperature and diagnostics only read, apart from the temperature sensor set up which is outside the tables */
+static const spi_transaction_t check_status_log[] = {
+    {false, 0x01, 4},
+    {false, 0x100, 16},
+};
+static const spi_transaction_t read_temperature_log[] = {
+    {true, 0x100c00, 1}, {false, 0x100c01, 1},
+};
+static const spi_transaction_t publish_diagnostics_log[] = {
+    {false, 0x200, 16}, {false, 0x400, 16}, {false, 0x1000, 16},
+};
+
+/* Another thread changing a port's MAC configuration, a table write */
+static const spi_transaction_t mac_config_write_log[] = {
+    {true, 0x4b, 8}, {true, 0x36, 1}, {false, 0x36, 1},
+};
+
+/* Another thread adjusting the PTP clock, outside the tables */
+static const spi_transaction_t ptp_clock_write_log[] = {
+    {true, 0x18, 2}, {true, 0x17, 1},
+};
+
+
+/* Fake peripherals and the driver handle */
+sja1105_handle_t     hsja1105;
+TX_EVENT_FLAGS_GROUP nx_link_events_handle;
+SPI_HandleTypeDef    hspi2;
+CRC_HandleTypeDef    hcrc;
+GPIO_TypeDef         fake_gpio;
+
+static SPI_TypeDef fake_spi;
+static CRC_TypeDef fake_crc;
+
+static TX_THREAD switch_thread = {.name = "Switch thread"};
+static TX_THREAD other_thread  = {.name = "Other thread"};
+static TX_THREAD *current_thread;
+
+static uint32_t     now;
+static uint32_t     end_time;
+static jmp_buf      end_jump;
+static test_event_t events[TEST_MAX_EVENTS];
+static uint32_t     event_count;
+static uint32_t     read_times[TEST_MAX_READS];
+static uint32_t     read_count;
+static uint32_t     link_event_times[TEST_MAX_LINK];
+static uint32_t     link_event_count;
+static test_event_t during_read; /* Transactions another thread makes while the switch thread is reading the tables at that time */
+static uint32_t     test_failures;
+
+
+/* Issue one logged transaction the way the driver does, command word first */
+static void spi_replay(const spi_transaction_t *log, uint32_t length) {
+
+    uint32_t data[1 + 64] = {0};
+
+    for (uint32_t i = 0; i < length; i++) {
+        if (sja1105_callbacks.callback_take_mutex(SWITCH_TIMEOUT_MS, NULL) != SJA1105_OK) Error_Handler();
+        sja1105_callbacks.callback_write_cs_pin(SJA1105_PIN_RESET, NULL);
+        if (log[i].write) {
+            data[0] = TEST_SPI_CMD_WRITE | (log[i].address << 4);
+            if (sja1105_callbacks.callback_spi_transmit(data, 1 + log[i].words, SWITCH_TIMEOUT_MS, NULL) != SJA1105_OK) Error_Handler();
+        } else {
+            data[0] = ((uint32_t) (log[i].words & 0x3f) << 25) | (log[i].address << 4);
+            if (sja1105_callbacks.callback_spi_transmit(data, 1, SWITCH_TIMEOUT_MS, NULL) != SJA1105_OK) Error_Handler();
+            if (sja1105_callbacks.callback_spi_receive(data + 1, log[i].words, SWITCH_TIMEOUT_MS, NULL) != SJA1105_OK) Error_Handler();
+        }
+        sja1105_callbacks.callback_write_cs_pin(SJA1105_PIN_SET, NULL);
+        if (sja1105_callbacks.callback_give_mutex(NULL) != SJA1105_OK) Error_Handler();
+    }
+}
+
+static void other_thread_replay(const test_event_t *event) {
+    TX_THREAD *previous = current_thread;
+    current_thread      = &other_thread;
+    spi_replay(event->log, event->length);
+    current_thread = previous;
+}
+
+#define TEST_LOG(log) (log), (sizeof(log) / sizeof((log)[0]))
+
+static void add_event(uint32_t time, const spi_transaction_t *log, uint32_t length) {
+    events[event_count++] = (test_event_t) {.time = time, .log = log, .length = length};
+}
+
+static void add_action(uint32_t time, void (*action)(void)) {
+    events[event_count++] = (test_event_t) {.time = time, .action = action};
+}
+
+
+/* Fake driver */
+sja1105_status_t SJA1105_ReadAllTables(sja1105_handle_t *dev) {
+    if (read_count < TEST_MAX_READS) read_times[read_count] = now;
+    read_count++;
+    spi_replay(read_all_tables_log, 8);
+    if ((during_read.log != NULL) && (during_read.time == now)) other_thread_replay(&during_read);
+    spi_replay(read_all_tables_log + 8, (sizeof(read_all_tables_log) / sizeof(read_all_tables_log[0])) - 8);
+    return SJA1105_OK;
+}
+
+sja1105_status_t SJA1105_CheckStatusRegisters(sja1105_handle_t *dev) {
+    spi_replay(TEST_LOG(check_status_log));
+    return SJA1105_OK;
+}
+
+sja1105_status_t SJA1105_ManagementRouteFree(sja1105_handle_t *dev, bool force) {
+    spi_replay(TEST_LOG(management_route_free_log));
+    return SJA1105_OK;
+}
+
+sja1105_status_t SJA1105_ReadTemperature(sja1105_handle_t *dev, float *temperature) {
+    spi_replay(TEST_LOG(read_temperature_log));
+    *temperature = 40.0f;
+    return SJA1105_OK;
+}
+
+sja1105_status_t init_switch_diagnostics(void) {
+    return SJA1105_OK;
+}
+
+sja1105_status_t publish_switch_diagnostics(uint32_t current_time) {
+    spi_replay(TEST_LOG(publish_diagnostics_log));
+    return SJA1105_OK;
+}
+
+
+/* Fake ThreadX, everything runs on one thread */
+UINT tx_byte_pool_create(TX_BYTE_POOL *pool_ptr, CHAR *name_ptr, VOID *pool_start, ULONG pool_size) {
+    pool_ptr->size = pool_size;
+    return TX_SUCCESS;
+}
+
+UINT tx_byte_pool_delete(TX_BYTE_POOL *pool_ptr) {
+    return TX_SUCCESS;
+}
+
+UINT tx_byte_allocate(TX_BYTE_POOL *pool_ptr, VOID **memory_ptr, ULONG memory_size, ULONG wait_option) {
+    *memory_ptr = malloc(memory_size);
+    return TX_SUCCESS;
+}
+
+UINT tx_byte_release(VOID *memory_ptr) {
+    free(memory_ptr);
+    return TX_SUCCESS;
+}
+
+UINT tx_mutex_get(TX_MUTEX *mutex_ptr, ULONG wait_option) {
+    if (mutex_ptr->owner != TX_NULL) return TX_NOT_AVAILABLE;
+    mutex_ptr->owner = current_thread;
+    return TX_SUCCESS;
+}
+
+UINT tx_mutex_put(TX_MUTEX *mutex_ptr) {
+    mutex_ptr->owner = TX_NULL;
+    return TX_SUCCESS;
+}
+
+/* Interrupt driven transfers complete immediately */
+UINT tx_semaphore_get(TX_SEMAPHORE *semaphore_ptr, ULONG wait_option) {
+    return TX_SUCCESS;
+}
+
+UINT tx_semaphore_put(TX_SEMAPHORE *semaphore_ptr) {
+    return TX_SUCCESS;
+}
+
+UINT tx_event_flags_set(TX_EVENT_FLAGS_GROUP *group_ptr, ULONG flags_to_set, UINT set_option) {
+    if ((group_ptr == &nx_link_events_handle) && (flags_to_set & NX_LINK_SWITCH_EVENT)) {
+        if (link_event_count < TEST_MAX_LINK) link_event_times[link_event_count] = now;
+        link_event_count++;
+    }
+    group_ptr->flags |= flags_to_set;
+    return TX_SUCCESS;
+}
+
+TX_THREAD *tx_thread_identify(VOID) {
+    return current_thread;
+}
+
+uint32_t tx_time_get_ms() {
+    return now;
+}
+
+/* Advance the virtual clock, running whatever the other threads do in the meantime */
+uint32_t tx_thread_sleep_ms(uint32_t ms) {
+
+    uint32_t wake = now + ms;
+
+    for (uint32_t i = 0; i < event_count; i++) {
+        if ((events[i].time >= now) && (events[i].time < wake)) {
+            now = events[i].time;
+            if (events[i].log != NULL) other_thread_replay(&events[i]);
+            if (events[i].action != NULL) events[i].action();
+        }
+    }
+    now = wake;
+
+    if (now >= end_time) longjmp(end_jump, 1);
+
+    return 0;
+}
+
+void delay_ns(uint32_t ns) {
+}
+
+void log_write(const char *format, ...) {
+}
+
+
+/* Fake HAL, the transfers themselves go nowhere */
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, const uint8_t *pData, uint16_t Size, uint32_t Timeout) {
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size, uint32_t Timeout) {
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef *hspi, const uint8_t *pTxData, uint8_t *pRxData, uint16_t Size, uint32_t Timeout) {
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit_IT(SPI_HandleTypeDef *hspi, const uint8_t *pData, uint16_t Size) {
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Receive_IT(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size) {
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_IT(SPI_HandleTypeDef *hspi, const uint8_t *pTxData, uint8_t *pRxData, uint16_t Size) {
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi) {
+    return HAL_OK;
+}
+
+uint32_t HAL_CRC_Accumulate(CRC_HandleTypeDef *hcrc, uint32_t pBuffer[], uint32_t BufferLength) {
+    return 0;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState) {
+}
+
+uint32_t HAL_GetTick(void) {
+    return now;
+}
+
+void HAL_Delay(uint32_t Delay) {
+}
+
+void Error_Handler(void) {
+    printf("    Error_Handler() called\n");
+    exit(1);
+}
+
+
+/* Run the switch thread until end */
+static void run_switch_thread(uint32_t end) {
+
+    hspi2.Instance = &fake_spi;
+    hcrc.Instance  = &fake_crc;
+    current_thread = &switch_thread;
+    end_time       = end;
+
+    if (setjmp(end_jump) == 0) switch_thread_entry(0);
+}
+
+static bool read_at(uint32_t time) {
+    for (uint32_t i = 0; (i < read_count) && (i < TEST_MAX_READS); i++) {
+        if (read_times[i] == time) return true;
+    }
+    return false;
+}
+
+/* Table reads that weren't made by the verify job */
+static uint32_t unverified_reads(void) {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < read_count; i++) {
+        if ((read_times[i] % SWITCH_TABLE_VERIFY_INTERVAL) != (SWITCH_MAINTENANCE_INTERVAL * 3 / 4)) count++;
+    }
+    return count;
+}
+
+static uint32_t verify_runs(uint32_t end) {
+    return ((end - (SWITCH_MAINTENANCE_INTERVAL * 3 / 4) - 1) / SWITCH_TABLE_VERIFY_INTERVAL) + 1;
+}
+
+
+/* Nothing but the switch thread's own housekeeping. The tables are read once at start up and then only by the verify
+ * job, the reads and management route frees don't make the tables look dirty */
+static void test_steady_state(void) {
+
+    run_switch_thread(30000);
+
+    CHECK(read_count == 1 + verify_runs(30000));
+    CHECK(unverified_reads() == 1);
+    CHECK(read_at(0));
+    CHECK(!sja1105_tables_dirty);
+}
+
+/* Another thread reconfigures a port, the tables job picks it up on its next run and only then */
+static void test_table_write(void) {
+
+    add_event(5100, TEST_LOG(mac_config_write_log));
+    run_switch_thread(30000);
+
+    CHECK(read_count == 2 + verify_runs(30000));
+    CHECK(unverified_reads() == 2);
+    CHECK(read_at(5500));
+    CHECK(!sja1105_tables_dirty);
+}
+
+/* Writes outside the tables are ignored */
+static void test_other_write(void) {
+
+    add_event(5100, TEST_LOG(ptp_clock_write_log));
+    add_event(12100, TEST_LOG(ptp_clock_write_log));
+    run_switch_thread(30000);
+
+    CHECK(read_count == 1 + verify_runs(30000));
+    CHECK(unverified_reads() == 1);
+}
+
+/* Another thread writes a table while the switch thread is part way through the first verify read. Only the switch
+ * thread's own transactions are untracked so the write isn't lost, the tables job reads them again on its next run */
+static void test_write_during_read(void) {
+
+    during_read = (test_event_t) {.time = SWITCH_MAINTENANCE_INTERVAL * 3 / 4, .log = mac_config_write_log, .length = sizeof(mac_config_write_log) / sizeof(mac_config_write_log[0])};
+    run_switch_thread(2000);
+
+    CHECK(read_count == 3);
+    CHECK(read_at(0));
+    CHECK(read_at(SWITCH_MAINTENANCE_INTERVAL * 3 / 4));
+    CHECK(read_at(SWITCH_MAINTENANCE_INTERVAL));
+    CHECK(!sja1105_tables_dirty);
+}
+
+/* The switch thread's own writes still count outside of a table read or management route free */
+static void test_switch_thread_write(void) {
+
+    current_thread = &switch_thread;
+    sja1105_tables_dirty = false;
+    spi_replay(TEST_LOG(mac_config_write_log));
+    CHECK(sja1105_tables_dirty);
+
+    sja1105_tables_dirty = false;
+    spi_replay(TEST_LOG(read_temperature_log));
+    CHECK(!sja1105_tables_dirty);
+}
+
+
+static void switch_initialised(void) {
+    hsja1105.initialised = true;
+}
+
+static void switch_uninitialised(void) {
+    hsja1105.initialised = false;
+}
+
+/* The NetX link thread is woken when the switch initialised flag changes, and only then */
+static void test_link_events(void) {
+
+    hsja1105.initialised = true;
+    add_action(5100, switch_uninitialised);
+    add_action(7300, switch_initialised);
+    run_switch_thread(30000);
+
+    CHECK(link_event_count == 3);
+    CHECK(link_event_times[0] == 0);
+    CHECK(link_event_times[1] == 5125);
+    CHECK(link_event_times[2] == 7500);
+}
+
+
+int main(void) {
+    struct {
+        const char *name;
+        void (*function)(void);
+    } tests[] = {
+        {"steady state", test_steady_state},
+        {"table write", test_table_write},
+        {"other write", test_other_write},
+        {"write during read", test_write_during_read},
+        {"switch thread write", test_switch_thread_write},
+        {"link events", test_link_events},
+    };
+
+    uint32_t failed = 0;
+    int      status;
+
+    for (uint32_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+        fflush(stdout);
+        if (fork() == 0) {
+            tests[i].function();
+            exit((test_failures == 0) ? 0 : 1);
+        }
+        wait(&status);
+
+        bool passed = WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+        printf("%s: %s\n", tests[i].name, passed ? "ok" : "FAILED");
+        if (!passed) failed++;
+    }
+
+    return (failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,22 @@
+/*
+ * comms_thread.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+/* Host stand-in for the comms thread header, without Zenoh Pico. The test owns the Zenoh byte pool */
+
+#ifndef INC_COMMS_THREAD_H_
+#define INC_COMMS_THREAD_H_
+
+#include "stdint.h"
+#include "tx_api.h"
+
+#include "config.h"
+#include "tx_app.h"
+
+extern uint8_t      zenoh_byte_pool_buffer[ZENOH_MEM_POOL_SIZE];
+extern TX_BYTE_POOL zenoh_byte_pool;
+
+#endif /* INC_COMMS_THREAD_H_ */
@@ -0,0 +1,15 @@
+/*
+ * main.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+/* Host stand-in for the CubeMX main header */
+
+#ifndef __MAIN_H
+#define __MAIN_H
+
+void Error_Handler(void);
+
+#endif /* __MAIN_H */
@@ -0,0 +1,446 @@
+/*
+ * zenoh_memory_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+/* Host test for the Zenoh Pico allocator in zenoh_memory.c, built against the real ThreadX byte and block pools. Checks
+ * the usable size and in place resize agree for both kinds of allocation, and that a long run of Zenoh-like allocations
+ * fragments the byte pool less than the same run made straight from a byte pool, and leaves none behind.
+ *
+ * The trace given on the command line, logged by the target with ZENOH_MEM_TRACE enabled, is also replayed against the
+ * configured block classes and pool size. Every allocation in it has to succeed without waiting, and the high
+ * watermarks and spills it reaches are printed for sizing ZENOH_MEM_BLOCK_COUNTS. Lines that don't contain a trace
+ * record are skipped, so whole logs can be replayed.
+ *
+ * Each test runs in its own process so it starts from fresh pools. Built and run with make in this directory. Usage:
+ * zenoh_memory_test [trace] */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "stdint.h"
+#include "stdbool.h"
+#include "string.h"
+#include "unistd.h"
+#include "sys/wait.h"
+
+#include "tx_api.h"
+#include "tx_thread.h"
+
+#include "config.h"
+#include "comms_thread.h"
+#include "zenoh_memory.h"
+
+
+#define TEST_CHURN_SLOTS      (64)
+#define TEST_CHURN_LONG_LIVED (8)     /* Slots that hold long lived allocations, freed only rarely */
+#define TEST_CHURN_STEPS      (50000)
+#define TEST_SEED             (0x2545F491UL)
+#define TEST_TRACE_TAG        "Zenoh memory trace:"
+#define TEST_TRACE_LIVE       (1024)  /* Most allocations a replayed trace can hold at once */
+
+
+#define CHECK(condition)                                                      \
+    do {                                                                      \
+        if (!(condition)) {                                                   \
+            printf("    FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            test_failures++;                                                  \
+        }                                                                     \
+    } while (0)
+
+
+/* The pools Zenoh Pico allocates from, and one to compare against */
+uint8_t      zenoh_byte_pool_buffer[ZENOH_MEM_POOL_SIZE] __attribute__((aligned(32)));
+TX_BYTE_POOL zenoh_byte_pool;
+
+static uint8_t      control_buffer[ZENOH_MEM_POOL_SIZE] __attribute__((aligned(32)));
+static TX_BYTE_POOL control_pool;
+
+static uint32_t    random_state;
+static UINT        test_failures;
+static const char *trace_path = NULL;
+
+
+/* ThreadX, the test is the only thread and memory is never waited for */
+TX_THREAD    *_tx_thread_current_ptr;
+volatile UINT _tx_thread_preempt_disable;
+
+VOID _tx_thread_system_preempt_check(VOID) {
+}
+
+VOID _tx_thread_system_resume(TX_THREAD *thread_ptr) {
+}
+
+VOID _tx_thread_system_suspend(TX_THREAD *thread_ptr) {
+    printf("    A pool allocation would have waited\n");
+    exit(1);
+}
+
+VOID _tx_byte_pool_cleanup(TX_THREAD *thread_ptr, ULONG suspension_sequence) {
+}
+
+VOID _tx_block_pool_cleanup(TX_THREAD *thread_ptr, ULONG suspension_sequence) {
+}
+
+void Error_Handler(void) {
+    printf("    Error_Handler() called\n");
+    exit(1);
+}
+
+
+static void setup(void) {
+    if (tx_byte_pool_create(&zenoh_byte_pool, "Zenoh Pico byte pool", zenoh_byte_pool_buffer, ZENOH_MEM_POOL_SIZE) != TX_SUCCESS) Error_Handler();
+    zenoh_memory_init();
+    random_state = TEST_SEED;
+}
+
+static uint32_t random_next(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+/* Largest allocation the byte pool can make right now */
+static ULONG largest_free(TX_BYTE_POOL *pool) {
+    ULONG low  = 0;
+    ULONG high = pool->tx_byte_pool_available;
+    ULONG middle;
+    VOID *ptr;
+
+    while (low < high) {
+        middle = (low + high + 1) / 2;
+        if (tx_byte_allocate(pool, &ptr, middle, TX_NO_WAIT) == TX_SUCCESS) {
+            tx_byte_release(ptr);
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
+
+/* The same steps z_realloc() takes */
+static void *test_realloc(void *ptr, size_t size) {
+    void  *new_ptr;
+    size_t old_size;
+
+    if (zenoh_memory_resize(ptr, size)) return ptr;
+    old_size = zenoh_memory_usable_size(ptr);
+    new_ptr  = zenoh_memory_allocate(size);
+    if (new_ptr == NULL) return NULL;
+    memcpy(new_ptr, ptr, (old_size < size) ? old_size : size);
+    zenoh_memory_release(ptr);
+    return new_ptr;
+}
+
+/* Start a new session the way comms_thread does, from a fresh byte pool */
+static void restart(void) {
+    zenoh_memory_deinit();
+    if (tx_byte_pool_delete(&zenoh_byte_pool) != TX_SUCCESS) Error_Handler();
+    if (tx_byte_pool_create(&zenoh_byte_pool, "Zenoh Pico byte pool", zenoh_byte_pool_buffer, ZENOH_MEM_POOL_SIZE) != TX_SUCCESS) Error_Handler();
+    zenoh_memory_init();
+}
+
+/* Mostly slices, strings and vector entries, now and then a batch sized buffer */
+static size_t churn_size(void) {
+    uint32_t choice = random_next() % 100;
+
+    if (choice < 70) return 8 + (random_next() % 57);
+    if (choice < 90) return 65 + (random_next() % 192);
+    if (choice < 98) return 257 + (random_next() % 344);
+    return 601 + (random_next() % 900);
+}
+
+
+/* Tests */
+
+/* Blocks can use their whole class, byte pool allocations exactly what was asked for, and resize agrees with both */
+static void test_usable_size(void) {
+    void *block;
+    void *bytes;
+
+    setup();
+
+    block = zenoh_memory_allocate(20);
+    CHECK(block != NULL);
+    CHECK(zenoh_memory_usable_size(block) == 32);
+    CHECK(zenoh_memory_resize(block, 32));
+    CHECK(!zenoh_memory_resize(block, 33));
+
+    bytes = zenoh_memory_allocate(300);
+    CHECK(bytes != NULL);
+    CHECK(((uintptr_t) bytes % sizeof(ALIGN_TYPE)) == 0);
+    CHECK(zenoh_memory_usable_size(bytes) == 300);
+    CHECK(zenoh_memory_resize(bytes, 300));
+    CHECK(!zenoh_memory_resize(bytes, 301));
+
+    /* Shrinking keeps the memory, so growing back to the original size stays in place too */
+    CHECK(zenoh_memory_resize(bytes, 100));
+    CHECK(zenoh_memory_usable_size(bytes) == 300);
+    CHECK(zenoh_memory_resize(bytes, 300));
+
+    zenoh_memory_release(block);
+    zenoh_memory_release(bytes);
+    CHECK(zenoh_memory_stats.byte_pool_allocations == 1);
+}
+
+/* Releasing a byte pool allocation gives back everything it took, header included */
+static void test_release(void) {
+    ULONG available;
+    ULONG largest;
+    void *ptrs[8];
+
+    setup();
+    available = zenoh_byte_pool.tx_byte_pool_available;
+    largest   = largest_free(&zenoh_byte_pool);
+
+    for (uint32_t i = 0; i < 8; i++) {
+        ptrs[i] = zenoh_memory_allocate(400 + (i * 100));
+        CHECK(ptrs[i] != NULL);
+        memset(ptrs[i], 0xA5, 400 + (i * 100));
+    }
+    for (uint32_t i = 0; i < 8; i += 2) zenoh_memory_release(ptrs[i]);
+    for (uint32_t i = 1; i < 8; i += 2) zenoh_memory_release(ptrs[i]);
+
+    CHECK(zenoh_byte_pool.tx_byte_pool_available == available);
+    CHECK(largest_free(&zenoh_byte_pool) == largest);
+}
+
+/* A vector grown one entry at a time keeps its contents through every move, from the block classes into the byte pool */
+static void test_realloc_growth(void) {
+    uint8_t *vector;
+    ULONG    available;
+    bool     intact = true;
+
+    setup();
+    available = zenoh_byte_pool.tx_byte_pool_available;
+
+    vector = zenoh_memory_allocate(8);
+    for (uint32_t length = 8; length <= 2048; length += 8) {
+        vector = test_realloc(vector, length);
+        CHECK(vector != NULL);
+        if (vector == NULL) return;
+        memset(vector + length - 8, (int) (length / 8), 8);
+    }
+    for (uint32_t i = 0; i < 2048; i++) {
+        if (vector[i] != (uint8_t) ((i / 8) + 1)) intact = false;
+    }
+    CHECK(intact);
+    CHECK(zenoh_memory_usable_size(vector) == 2048);
+
+    /* Shrinking back down never moves it */
+    CHECK(test_realloc(vector, 100) == vector);
+
+    zenoh_memory_release(vector);
+    CHECK(zenoh_byte_pool.tx_byte_pool_available == available);
+}
+
+/* A long run of Zenoh-like allocations, and the same run made straight from a byte pool the same size. With the small
+ * allocations in the block classes the byte pool holds fewer fragments, and once everything is freed it is back to
+ * one free block as big as it started */
+static void test_fragmentation(void) {
+    void    *slots[TEST_CHURN_SLOTS]         = {0};
+    void    *control_slots[TEST_CHURN_SLOTS] = {0};
+    uint32_t slot;
+    size_t   size;
+    ULONG    largest;
+    UINT     fragments_max         = 0;
+    UINT     control_fragments_max = 0;
+    uint32_t control_failures      = 0;
+    uint32_t large                 = 0;
+    uint32_t spills                = 0;
+
+    setup();
+    if (tx_byte_pool_create(&control_pool, "Control byte pool", control_buffer, ZENOH_MEM_POOL_SIZE) != TX_SUCCESS) Error_Handler();
+    largest = largest_free(&zenoh_byte_pool);
+
+    for (uint32_t step = 0; step < TEST_CHURN_STEPS; step++) {
+
+        slot = random_next() % TEST_CHURN_SLOTS;
+        if ((slot < TEST_CHURN_LONG_LIVED) && (slots[slot] != NULL) && ((random_next() % 50) != 0)) continue;
+
+        if (slots[slot] != NULL) {
+            zenoh_memory_release(slots[slot]);
+            slots[slot] = NULL;
+            if (control_slots[slot] != NULL) tx_byte_release(control_slots[slot]);
+            control_slots[slot] = NULL;
+        } else {
+            size        = churn_size();
+            slots[slot] = zenoh_memory_allocate(size);
+            CHECK(slots[slot] != NULL);
+            if (size > 256) large++;
+            if (tx_byte_allocate(&control_pool, &control_slots[slot], size, TX_NO_WAIT) != TX_SUCCESS) {
+                control_slots[slot] = NULL;
+                control_failures++;
+            }
+        }
+
+        if (zenoh_byte_pool.tx_byte_pool_fragments > fragments_max) fragments_max = zenoh_byte_pool.tx_byte_pool_fragments;
+        if (control_pool.tx_byte_pool_fragments > control_fragments_max) control_fragments_max = control_pool.tx_byte_pool_fragments;
+    }
+
+    for (uint32_t i = 0; i < ZENOH_MEM_BLOCK_CLASSES; i++) spills += zenoh_memory_stats.classes[i].failures;
+    printf("    %lu fragments at most (%lu straight from a byte pool), %lu byte pool allocations for %lu large and %lu spilled\n", (unsigned long) fragments_max, (unsigned long) control_fragments_max, (unsigned long) zenoh_memory_stats.byte_pool_allocations, (unsigned long) large, (unsigned long) spills);
+
+    CHECK(control_failures == 0);
+    CHECK(fragments_max < control_fragments_max);
+    CHECK(zenoh_memory_stats.byte_pool_allocations <= large + spills);
+
+    for (uint32_t i = 0; i < TEST_CHURN_SLOTS; i++) {
+        if (slots[i] != NULL) zenoh_memory_release(slots[i]);
+    }
+    for (uint32_t i = 0; i < ZENOH_MEM_BLOCK_CLASSES; i++) {
+        CHECK(zenoh_memory_stats.classes[i].high_watermark <= zenoh_memory_stats.classes[i].total);
+    }
+    CHECK(largest_free(&zenoh_byte_pool) == largest);
+}
+
+
+/* Replays the trace at trace_path. Recorded pointers are matched to the replayed ones, so the same address can be
+ * allocated again once released just as on the target. After records were lost the allocations they held are unknown,
+ * so releases that don't match are only counted until the next session starts */
+static void test_trace_replay(void) {
+    FILE         *file;
+    char          line[256];
+    const char   *record;
+    char          kind[8];
+    unsigned long address;
+    unsigned long size;
+    uint32_t      recorded[TEST_TRACE_LIVE];
+    void         *replayed[TEST_TRACE_LIVE];
+    uint32_t      live              = 0;
+    uint32_t      live_max          = 0;
+    uint32_t      sessions          = 0;
+    uint32_t      allocations       = 0;
+    uint32_t      unmatched         = 0;
+    uint32_t      lost              = 0;
+    bool          lost_this_session = false;
+    UINT          fragments_max     = 0;
+    ULONG         largest;
+    uint32_t      i;
+
+    if (trace_path == NULL) {
+        printf("    No trace given\n");
+        return;
+    }
+    file = fopen(trace_path, "r");
+    if (file == NULL) {
+        perror(trace_path);
+        test_failures++;
+        return;
+    }
+
+    setup();
+    largest = largest_free(&zenoh_byte_pool);
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+
+        /* Bare records without the tag are accepted too */
+        record = strstr(line, TEST_TRACE_TAG);
+        record = (record != NULL) ? record + strlen(TEST_TRACE_TAG) : line;
+        if (sscanf(record, "%7s", kind) != 1) continue;
+
+        /* The target deleted the pools and everything in them */
+        if (strcmp(kind, "init") == 0) {
+            if (sessions > 0) restart();
+            sessions++;
+            live              = 0;
+            lost_this_session = false;
+        }
+
+        else if ((strcmp(kind, "a") == 0) && (sscanf(record, "%*s %lx %lu", &address, &size) == 2)) {
+            CHECK(live < TEST_TRACE_LIVE);
+            if (live >= TEST_TRACE_LIVE) break;
+            for (i = 0; (i < live) && (recorded[i] != address); i++);
+            if ((i < live) && !lost_this_session) {
+                printf("    %08lx allocated again before it was released\n", address);
+                test_failures++;
+            }
+            recorded[live] = (uint32_t) address;
+            replayed[live] = zenoh_memory_allocate(size);
+            CHECK(replayed[live] != NULL);
+            if (replayed[live] == NULL) break;
+            memset(replayed[live], 0xA5, size);
+            live++;
+            allocations++;
+            if (live > live_max) live_max = live;
+        }
+
+        /* Search from the newest, the same address may also be held by an allocation whose release was lost */
+        else if ((strcmp(kind, "f") == 0) && (sscanf(record, "%*s %lx", &address) == 1)) {
+            for (i = live; (i > 0) && (recorded[i - 1] != address); i--);
+            if (i == 0) {
+                if (!lost_this_session) {
+                    printf("    %08lx released but never allocated\n", address);
+                    test_failures++;
+                }
+                unmatched++;
+                continue;
+            }
+            zenoh_memory_release(replayed[i - 1]);
+            recorded[i - 1] = recorded[live - 1];
+            replayed[i - 1] = replayed[live - 1];
+            live--;
+        }
+
+        else if ((strcmp(kind, "lost") == 0) && (sscanf(record, "%*s %lu", &size) == 1)) {
+            lost              += (uint32_t) size;
+            lost_this_session  = true;
+        }
+
+        if (zenoh_byte_pool.tx_byte_pool_fragments > fragments_max) fragments_max = zenoh_byte_pool.tx_byte_pool_fragments;
+    }
+    fclose(file);
+
+    printf("    %lu sessions, %lu allocations, %lu live at most", (unsigned long) sessions, (unsigned long) allocations, (unsigned long) live_max);
+    if (lost > 0) printf(", %lu records lost and %lu releases unmatched", (unsigned long) lost, (unsigned long) unmatched);
+    printf("\n");
+    for (i = 0; i < ZENOH_MEM_BLOCK_CLASSES; i++) {
+        printf("    %3lu byte class: %lu of %lu blocks at most, %lu spilled\n", (unsigned long) zenoh_memory_stats.classes[i].block_size, (unsigned long) zenoh_memory_stats.classes[i].high_watermark, (unsigned long) zenoh_memory_stats.classes[i].total, (unsigned long) zenoh_memory_stats.classes[i].failures);
+    }
+    printf("    Byte pool: %lu allocations, %lu of %lu bytes free at least, %lu fragments at most\n", (unsigned long) zenoh_memory_stats.byte_pool_allocations, (unsigned long) zenoh_memory_stats.byte_pool_low_watermark, (unsigned long) ZENOH_MEM_POOL_SIZE, (unsigned long) fragments_max);
+
+    CHECK(sessions > 0);
+    CHECK(allocations > 0);
+
+    /* Every session starts from the same pools, so once whatever the last one still held is released the byte pool is
+     * back to one free block as big as it started */
+    for (i = 0; i < live; i++) zenoh_memory_release(replayed[i]);
+    CHECK(largest_free(&zenoh_byte_pool) == largest);
+}
+
+
+int main(int argc, char **argv) {
+    struct {
+        const char *name;
+        void (*function)(void);
+    } tests[] = {
+        {"usable size", test_usable_size},
+        {"release", test_release},
+        {"realloc growth", test_realloc_growth},
+        {"fragmentation", test_fragmentation},
+        {"trace replay", test_trace_replay},
+    };
+
+    uint32_t failed = 0;
+    int      status;
+
+    if (argc > 1) trace_path = argv[1];
+
+    for (uint32_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+        fflush(stdout);
+        if (fork() == 0) {
+            tests[i].function();
+            exit((test_failures == 0) ? 0 : 1);
+        }
+        wait(&status);
+
+        bool passed = WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+        printf("%s: %s\n", tests[i].name, passed ? "ok" : "FAILED");
+        if (!passed) failed++;
+    }
+
+    return (failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,17 @@
+/*
+ * secure_nsc.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+/* Host stand-in for the secure gateway, the test supplies the hardware randomness */
+
+#ifndef SECURE_NSC_H
+#define SECURE_NSC_H
+
+#include "stdint.h"
+
+void s_random_fill(uint32_t *buf, uint32_t words);
+
+#endif /* SECURE_NSC_H */
@@ -0,0 +1,17 @@
+/*
+ * tx_api.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+/* Host stand-in for the ThreadX API. The test is the only thread, so the interrupt lock does nothing */
+
+#ifndef TX_API_H
+#define TX_API_H
+
+#define TX_INTERRUPT_SAVE_AREA
+#define TX_DISABLE
+#define TX_RESTORE
+
+#endif /* TX_API_H */
@@ -0,0 +1,187 @@
+/*
+ * zenoh_random_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: bens1
+ */
+
+/* Host known answer test for the ChaCha20 generator in zenoh_random.c, against the test vectors of RFC 8439. The
+ * generator keeps a 64-bit block counter in words 12-13 and a 64-bit nonce in words 14-15, where RFC 8439 has a 32-bit
+ * counter and a 96-bit nonce. The two agree whenever the first word of the RFC nonce is zero, which it is in the
+ * vectors used here. The key and nonce are loaded through zenoh_random_seed() with the test standing in for the
+ * hardware RNG, and the keystream read back through zenoh_random_fill() in uneven pieces so block boundaries fall in
+ * the middle of a read.
+ *
+ * Each test runs in its own process so it starts from the generator's power on state. Built and run with make in this
+ * directory */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "stdint.h"
+#include "stdbool.h"
+#include "string.h"
+#include "unistd.h"
+#include "sys/wait.h"
+
+#include "secure_nsc.h"
+#include "zenoh_random.h"
+
+
+#define TEST_SEED_WORDS (10) /* 256 bit key then 64 bit nonce, as zenoh_random_seed() reads them */
+
+
+#define CHECK(condition)                                                      \
+    do {                                                                      \
+        if (!(condition)) {                                                   \
+            printf("    FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            test_failures++;                                                  \
+        }                                                                     \
+    } while (0)
+
+
+/* RFC 8439 A.1 test vectors 1 and 2, the keystream of an all zero key and nonce for block counters 0 and 1 */
+static const uint8_t zero_key_keystream[128] = {
+    0x76, 0xb8, 0xe0, 0xad, 0xa0, 0xf1, 0x3d, 0x90, 0x40, 0x5d, 0x6a, 0xe5, 0x53, 0x86, 0xbd, 0x28,
+    0xbd, 0xd2, 0x19, 0xb8, 0xa0, 0x8d, 0xed, 0x1a, 0xa8, 0x36, 0xef, 0xcc, 0x8b, 0x77, 0x0d, 0xc7,
+    0xda, 0x41, 0x59, 0x7c, 0x51, 0x57, 0x48, 0x8d, 0x77, 0x24, 0xe0, 0x3f, 0xb8, 0xd8, 0x4a, 0x37,
+    0x6a, 0x43, 0xb8, 0xf4, 0x15, 0x18, 0xa1, 0x1c, 0xc3, 0x87, 0xb6, 0x69, 0xb2, 0xee, 0x65, 0x86,
+    0x9f, 0x07, 0xe7, 0xbe, 0x55, 0x51, 0x38, 0x7a, 0x98, 0xba, 0x97, 0x7c, 0x73, 0x2d, 0x08, 0x0d,
+    0xcb, 0x0f, 0x29, 0xa0, 0x48, 0xe3, 0x65, 0x69, 0x12, 0xc6, 0x53, 0x3e, 0x32, 0xee, 0x7a, 0xed,
+    0x29, 0xb7, 0x21, 0x76, 0x9c, 0xe6, 0x4e, 0x43, 0xd5, 0x71, 0x33, 0xb0, 0x74, 0xd8, 0x39, 0xd5,
+    0x31, 0xed, 0x1f, 0x28, 0x51, 0x0a, 0xfb, 0x45, 0xac, 0xe1, 0x0a, 0x1f, 0x4b, 0x79, 0x4d, 0x6f,
+};
+
+/* RFC 8439 2.4.2, key 00:01:02:...:1f and nonce 00:00:00:00:00:00:00:4a:00:00:00:00 starting from block counter 1 */
+static const uint32_t sunscreen_seed[TEST_SEED_WORDS] = {
+    0x03020100, 0x07060504, 0x0b0a0908, 0x0f0e0d0c, 0x13121110, 0x17161514, 0x1b1a1918, 0x1f1e1d1c,
+    0x4a000000, 0x00000000,
+};
+
+static const char sunscreen_plaintext[] = "Ladies and Gentlemen of the class of '99: If I could offer you only one tip for the future, sunscreen would be it.";
+
+static const uint8_t sunscreen_ciphertext[114] = {
+    0x6e, 0x2e, 0x35, 0x9a, 0x25, 0x68, 0xf9, 0x80, 0x41, 0xba, 0x07, 0x28, 0xdd, 0x0d, 0x69, 0x81,
+    0xe9, 0x7e, 0x7a, 0xec, 0x1d, 0x43, 0x60, 0xc2, 0x0a, 0x27, 0xaf, 0xcc, 0xfd, 0x9f, 0xae, 0x0b,
+    0xf9, 0x1b, 0x65, 0xc5, 0x52, 0x47, 0x33, 0xab, 0x8f, 0x59, 0x3d, 0xab, 0xcd, 0x62, 0xb3, 0x57,
+    0x16, 0x39, 0xd6, 0x24, 0xe6, 0x51, 0x52, 0xab, 0x8f, 0x53, 0x0c, 0x35, 0x9f, 0x08, 0x61, 0xd8,
+    0x07, 0xca, 0x0d, 0xbf, 0x50, 0x0d, 0x6a, 0x61, 0x56, 0xa3, 0x8e, 0x08, 0x8a, 0x22, 0xb6, 0x5e,
+    0x52, 0xbc, 0x51, 0x4d, 0x16, 0xcc, 0xf8, 0x06, 0x81, 0x8c, 0xe9, 0x1a, 0xb7, 0x79, 0x37, 0x36,
+    0x5a, 0xf9, 0x0b, 0xbf, 0x74, 0xa3, 0x5b, 0xe6, 0xb4, 0x0b, 0x8e, 0xed, 0xf2, 0x78, 0x5e, 0x42,
+    0x87, 0x4d,
+};
+
+_Static_assert(sizeof(sunscreen_plaintext) - 1 == sizeof(sunscreen_ciphertext), "Plaintext and ciphertext lengths differ");
+
+
+static uint32_t test_seed[TEST_SEED_WORDS]; /* What the hardware RNG hands zenoh_random_seed() */
+static uint32_t test_failures;
+
+
+/* The hardware RNG */
+void s_random_fill(uint32_t *buf, uint32_t words) {
+    if (words != TEST_SEED_WORDS) {
+        printf("    Asked for %u words of seed\n", words);
+        exit(1);
+    }
+    memcpy(buf, test_seed, sizeof(test_seed));
+}
+
+
+/* Read len bytes of keystream in pieces of the given sizes, repeated until len is reached */
+static void fill_in_pieces(uint8_t *buf, size_t len, const size_t *pieces, size_t count) {
+    size_t n;
+
+    for (size_t i = 0; len > 0; i = (i + 1) % count) {
+        n = (pieces[i] < len) ? pieces[i] : len;
+        zenoh_random_fill(buf, n);
+        buf += n;
+        len -= n;
+    }
+}
+
+
+/* Tests */
+
+/* The generator powers on with an all zero key, so an all zero seed leaves it there and the first two blocks are the
+ * zero key vectors. Read whole, then again in pieces that straddle the block boundary */
+static void test_zero_key(void) {
+    uint8_t      keystream[128];
+    const size_t pieces[] = {1, 7, 50, 13};
+
+    memset(test_seed, 0, sizeof(test_seed));
+
+    zenoh_random_seed();
+    zenoh_random_fill(keystream, sizeof(keystream));
+    CHECK(memcmp(keystream, zero_key_keystream, sizeof(keystream)) == 0);
+
+    zenoh_random_seed();
+    memset(keystream, 0, sizeof(keystream));
+    fill_in_pieces(keystream, sizeof(keystream), pieces, sizeof(pieces) / sizeof(pieces[0]));
+    CHECK(memcmp(keystream, zero_key_keystream, sizeof(keystream)) == 0);
+}
+
+/* The RFC 8439 encryption example. Its keystream starts at block counter 1, so block 0 is read and thrown away first */
+static void test_sunscreen(void) {
+    uint8_t      discard[64];
+    uint8_t      keystream[sizeof(sunscreen_ciphertext)];
+    const size_t pieces[] = {3, 64, 29};
+    bool         match    = true;
+
+    memcpy(test_seed, sunscreen_seed, sizeof(test_seed));
+
+    zenoh_random_seed();
+    zenoh_random_fill(discard, sizeof(discard));
+    fill_in_pieces(keystream, sizeof(keystream), pieces, sizeof(pieces) / sizeof(pieces[0]));
+
+    for (size_t i = 0; i < sizeof(sunscreen_ciphertext); i++) {
+        if ((uint8_t) (sunscreen_plaintext[i] ^ keystream[i]) != sunscreen_ciphertext[i]) match = false;
+    }
+    CHECK(match);
+}
+
+/* Reseeding mixes the new seed into the key and nonce, restarts the block counter and drops whatever was left of the
+ * current block. Seeding with the same words twice undoes the first, back to the zero key from block 0 */
+static void test_reseed(void) {
+    uint8_t keystream[128];
+    uint8_t partial[10];
+
+    memcpy(test_seed, sunscreen_seed, sizeof(test_seed));
+
+    zenoh_random_seed();
+    zenoh_random_fill(partial, sizeof(partial));
+    CHECK(memcmp(partial, zero_key_keystream, sizeof(partial)) != 0);
+
+    zenoh_random_seed();
+    zenoh_random_fill(keystream, sizeof(keystream));
+    CHECK(memcmp(keystream, zero_key_keystream, sizeof(keystream)) == 0);
+}
+
+
+int main(void) {
+    struct {
+        const char *name;
+        void (*function)(void);
+    } tests[] = {
+        {"zero key", test_zero_key},
+        {"sunscreen", test_sunscreen},
+        {"reseed", test_reseed},
+    };
+
+    uint32_t failed = 0;
+    int      status;
+
+    for (uint32_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+        fflush(stdout);
+        if (fork() == 0) {
+            tests[i].function();
+            exit((test_failures == 0) ? 0 : 1);
+        }
+        wait(&status);
+
+        bool passed = WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+        printf("%s: %s\n", tests[i].name, passed ? "ok" : "FAILED");
+        if (!passed) failed++;
+    }
+
+    return (failed == 0) ? 0 : 1;
+}